@@ -12,6 +12,10 @@
 #include "OptionsMenu.hpp"
 #include "KeyBinding.hpp"
 #include "Mutex.hpp"
+#include "Reactor.hpp"
+#include "TickScheduler.hpp"
+#include "Snapshot.hpp"
+#include "InputHistory.hpp"
 
 #include <string>
 #include <vector>
@@ -69,16 +73,27 @@ private:
     Configuration& player_config;
     bool logged_in;
     Player *me;
-    ns_t updatecnt;
+    StringTable strings;
     TournamentFactory factory;
     player_id_t my_id;
     bool login_sent;
     bool throw_exception;
     std::string exception_msg;
-    bool force_send;
     FILE *fhnd;
     bool running;
     bool reload_resources;
+    TickScheduler tick_scheduler;
+    SnapshotHistory snapshots;
+    bool snapshot_applied;
+    uint16_t snapshot_applied_no;
+    bool snapshot_acked;
+    uint16_t snapshot_ack_no;
+    bool snapshot_ack_pending;
+    InputHistory inputs;
+    gametime_t clock_origin;
+    bool server_clock_valid;
+    double server_clock_offset;     /* ns */
+    double interpolation_delay;     /* ns */
 
     gametime_t now;
     gametime_t last;
@@ -98,6 +113,7 @@ private:
     std::string xfer_filename;
     char buffer[128];
     Mutex mtx;
+    Reactor reactor;
     ServerEvents server_events;
     std::string current_download_filename;
 
@@ -120,6 +136,17 @@ private:
     void stop_thread();
     void sevt_login(ServerEvent& evt);
     void sevt_data(ServerEvent& evt);
+    void sevt_snapshot(GTransport *t);
+    void update_snapshot_record(const SnapshotRecord& rec, double time);
+    void update_player_state(const GPTAllStates& state, double time);
+    void update_object_state(const GObjectState& state, double time);
+    void update_animation_state(const GAnimationState& state);
+    void update_npc_state(const GNPCState& state, double time);
+    void record_input();
+    void reconcile(const GPlayerInputAck& ack);
+    double get_local_clock() const;
+    double get_server_clock() const;
+    void sync_server_clock(uint32_t server_time);
 
     /* gui funcs */
     void set_key(MappedKey::Device dev, int param);
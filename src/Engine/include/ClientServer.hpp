@@ -7,13 +7,16 @@
 #include "TournamentTDM.hpp"
 #include "Player.hpp"
 #include "GameProtocol.hpp"
+#include "PacketBuilder.hpp"
 
 #include <string>
+#include <map>
 
 class ClientServer : public MessageSequencer {
 public:
     ClientServer(hostport_t port, pico_size_t num_players,
-        const std::string& server_name, const std::string& password);
+        const std::string& server_name, const std::string& password,
+        size_t num_receivers = 0);
     ClientServer(hostaddr_t host, hostport_t port);
     virtual ~ClientServer();
 
@@ -34,18 +37,18 @@ protected:
 
     Players players;
 
+    /* stacked data is collected per connection and channel (reliable */
+    /* or not, by flags) until it is flushed, once per round. synced  */
+    /* broadcasts are stacked once and shared by all out queues.      */
     void stacked_send_data(const Connection *c, unsigned char tournament_id, command_t cmd, flags_t flags,
         data_len_t len, const void *data) throw (Exception);
 
-    void stacked_broadcast_data(unsigned char tournament_id, command_t cmd, flags_t flags,
-        data_len_t len, const void *data) throw (Exception);
-
     void stacked_broadcast_data_synced(unsigned char tournament_id, command_t cmd, flags_t flags,
         data_len_t len, const void *data) throw (Exception);
 
-    void flush_stacked_send_data(const Connection *c, flags_t flags) throw (Exception);
-    void flush_stacked_broadcast_data(flags_t flags) throw (Exception);
-    void flush_stacked_broadcast_data_synced(flags_t flags) throw (Exception);
+    void flush_stacked_send_data(const Connection *c) throw (Exception);
+    void flush_stacked_data() throw (Exception);
+    void discard_stacked_data(const Connection *c);
 
     void send_data(const Connection *c, unsigned char tournament_id, command_t cmd, flags_t flags,
         data_len_t len, const void *data) throw (Exception);
@@ -58,13 +61,31 @@ protected:
 
     hostport_t get_port() const;
 
+    /* largest stacked message or snapshot part, PacketMaxSize */
+    /* up to PacketSizeLimit, other values are clamped         */
+    void set_packet_size(int size);
+    int get_packet_size() const;
+
 private:
+    struct OutgoingPackets {
+        PacketBuilder reliable;
+        PacketBuilder unreliable;
+    };
+
+    typedef std::map<const Connection *, OutgoingPackets *> Outgoing;
+
     char buffer[1024];
-    GTransport *pb;
-    int packet_len;
     hostport_t port;
-
-    void stack_data(unsigned char tournament_id, command_t cmd, data_len_t len, const void *data);
+    int packet_size;
+    Outgoing outgoing;
+    OutgoingPackets outgoing_synced;
+
+    OutgoingPackets *get_outgoing(const Connection *c);
+    void flush_packet(const Connection *c, PacketBuilder& builder, flags_t flags) throw (Exception);
+    void flush_synced_packet(PacketBuilder& builder, flags_t flags) throw (Exception);
+    void flush_reliable(const Connection *c) throw (Exception);
+    void flush_all_reliable() throw (Exception);
+    void push_synced(flags_t flags, data_len_t len, const void *data) throw (Exception);
 };
 
 #endif // CLIENTSERVER_HPP
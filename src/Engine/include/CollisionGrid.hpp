@@ -0,0 +1,70 @@
+#ifndef COLLISIONGRID_HPP
+#define COLLISIONGRID_HPP
+
+#include "Tileset.hpp"
+
+#include <vector>
+
+/* a cell is one byte:
+ *
+ * bits 0-3    tile type, CollisionCellEmpty without a tile
+ * bits 4-6    friction class
+ * bit  7      light blocking
+ */
+const unsigned char CollisionCellTypeMask = 0x0f;
+const unsigned char CollisionCellEmpty = 0x0f;
+const int CollisionCellFrictionShift = 4;
+const unsigned char CollisionCellFrictionMask = 0x07;
+const unsigned char CollisionCellLightBlocking = 0x80;
+
+/* the last class is for tilesets with too many different */
+/* frictions, their friction is read from the tile itself */
+const int CollisionFrictionClasses = 8;
+const int CollisionFrictionOfTile = CollisionFrictionClasses - 1;
+
+/* flat copy of what the physics need from the map and its tileset, */
+/* built once per tournament. outside of the map, cells are empty.  */
+class CollisionGrid {
+private:
+    CollisionGrid(const CollisionGrid&);
+    CollisionGrid& operator=(const CollisionGrid&);
+
+public:
+    CollisionGrid();
+    virtual ~CollisionGrid();
+
+    void build(Tileset *tileset, short **map_array, int width, int height);
+
+    inline unsigned char get(int x, int y) const {
+        if (static_cast<unsigned int>(x) >= static_cast<unsigned int>(width) ||
+            static_cast<unsigned int>(y) >= static_cast<unsigned int>(height))
+        {
+            return CollisionCellEmpty;
+        }
+
+        return cells[y * width + x];
+    }
+
+    inline static Tile::TileType get_type(unsigned char cell) {
+        return static_cast<Tile::TileType>(cell & CollisionCellTypeMask);
+    }
+
+    inline static bool is_light_blocking(unsigned char cell) {
+        return ((cell & CollisionCellLightBlocking) != 0);
+    }
+
+    double get_friction(unsigned char cell, int x, int y) const;
+
+private:
+    Tileset *tileset;
+    short **map_array;
+    int width;
+    int height;
+    std::vector<unsigned char> cells;
+    double frictions[CollisionFrictionClasses];
+    int friction_classes;
+
+    int get_friction_class(double friction);
+};
+
+#endif // COLLISIONGRID_HPP
@@ -6,6 +6,9 @@
 #include "Resources.hpp"
 #include "Configuration.hpp"
 
+#include <string>
+#include <vector>
+
 class GameException : public Exception {
 public:
     GameException(const char *msg) : Exception(msg) { }
@@ -21,12 +24,18 @@ public:
     Game(Resources& resources, Subsystem& subsystem);
     virtual ~Game();
 
-    void run(const std::string& parm);
+    typedef std::vector<std::string> Parameters;
+
+    void run(const Parameters& parms);
 
 private:
     Resources& resources;
     Subsystem& subsystem;
     Configuration config;
+
+#ifdef DEDICATED_SERVER
+    void run_shards(const Parameters& config_files);
+#endif
 };
 
 #endif // GAME_HPP
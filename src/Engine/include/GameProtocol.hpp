@@ -3,6 +3,8 @@
 
 #include "Protocol.hpp"
 
+#include <cmath>
+
 typedef int32_t pos_t;
 typedef pico_size_t player_id_t;
 typedef unsigned char gamestate_t;
@@ -17,6 +19,7 @@ typedef int16_t sscore_t;
 typedef uint16_t playerflags_t;
 typedef uint32_t sr_milliseconds_t;
 typedef uint32_t datasize_t;
+typedef uint16_t stringid_t;
 
 const int NameLength = 32;
 const int TextLength = 64;
@@ -32,6 +35,84 @@ const int PlayerKeyStateDrop1 = 64;
 const int PlayerKeyStateDrop2 = 128;
 const int PlayerKeyStateDrop3 = 256;
 
+/* velocity bounds of the player physics */
+const double XMaxAccel = 1.75f;
+const double YMaxAccel = 4.5f;
+
+/* msb first bit packing, see GPlayerClientServerStatePacked */
+class BitWriter {
+public:
+    BitWriter(data_t *data) : data(data), acc(0), acc_bits(0) { }
+
+    inline void write(uint32_t value, int bits) {
+        acc = (acc << bits) | (value & ((static_cast<uint64_t>(1) << bits) - 1));
+        acc_bits += bits;
+        while (acc_bits >= 8) {
+            acc_bits -= 8;
+            *data++ = static_cast<data_t>(acc >> acc_bits);
+        }
+    }
+
+    inline void flush() {
+        if (acc_bits) {
+            *data++ = static_cast<data_t>(acc << (8 - acc_bits));
+            acc_bits = 0;
+        }
+    }
+
+private:
+    data_t *data;
+    uint64_t acc;
+    int acc_bits;
+};
+
+class BitReader {
+public:
+    BitReader(const data_t *data) : data(data), acc(0), acc_bits(0) { }
+
+    inline uint32_t read(int bits) {
+        while (acc_bits < bits) {
+            acc = (acc << 8) | *data++;
+            acc_bits += 8;
+        }
+        acc_bits -= bits;
+
+        return static_cast<uint32_t>((acc >> acc_bits) & ((static_cast<uint64_t>(1) << bits) - 1));
+    }
+
+    inline int32_t read_signed(int bits) {
+        uint32_t v = read(bits);
+        uint32_t sign = static_cast<uint32_t>(1) << (bits - 1);
+
+        return static_cast<int32_t>(v ^ sign) - static_cast<int32_t>(sign);
+    }
+
+private:
+    const data_t *data;
+    uint64_t acc;
+    int acc_bits;
+};
+
+/* fixed point with the given fraction, saturating at the bit width */
+inline int32_t quantize_fixed(double v, int fraction, int bits) {
+    double max = static_cast<double>((1 << (bits - 1)) - 1);
+    double q = floor(v * fraction + 0.5);
+
+    return static_cast<int32_t>(q < -max - 1 ? -max - 1 : (q > max ? max : q));
+}
+
+/* -range..range mapped onto a symmetric signed integer, 0 stays exact */
+inline int32_t quantize_range(double v, double range, int bits) {
+    double max = static_cast<double>((1 << (bits - 1)) - 1);
+    double q = floor(v / range * max + 0.5);
+
+    return static_cast<int32_t>(q < -max ? -max : (q > max ? max : q));
+}
+
+inline double dequantize_range(int32_t q, double range, int bits) {
+    return q * range / ((1 << (bits - 1)) - 1);
+}
+
 
 /* current game state */
 enum ServerState {
@@ -83,12 +164,15 @@ enum GPC {
     GPCXferDataChunk,
     GPCGenericData,
     GPCPakHash,
-    GPCServerQuit
+    GPCServerQuit,
+    GPCSnapshot,
+    GPCStringTable,
+    GPCPlayerInputAck
 };
 
 /* game protocol client to server */
 enum GPS {
-    GPSUpdatePlayerClientServerState = 0,
+    GPSPlayerInput = 0,
     GPSRespawnRequest,
     GPSJoinRequest,
     GPSChatMessage,
@@ -100,7 +184,8 @@ enum GPS {
     GPSRoundFinished,
     GPSPakSyncHash,
     GPSPakSyncHashFinished,
-    GPSPakSyncAck
+    GPSPakSyncAck,
+    GPSSnapshotAck
 };
 
 const int TransportFlagMorePackets = 1;
@@ -265,6 +350,48 @@ struct GPlayerClientServerState {
 };
 #pragma pack()
 
+/* GPlayerClientServerState as it goes over the wire in the frequent */
+/* updates: positions in 1/16 pixel, velocities quantized within     */
+/* their physical bounds, 96 bits in total.                          */
+const int PackedPositionFraction = 16;
+const int PackedPositionBits = 22;
+const int PackedAccelXBits = 11;
+const int PackedAccelYBits = 12;
+const int PackedJumpAccelYBits = 11;
+
+#pragma pack(1)
+struct GPlayerClientServerStatePacked {
+    data_t data[12];
+
+    inline void pack(const GPlayerClientServerState& state) {
+        BitWriter w(data);
+        w.write(state.key_states, 9);
+        w.write(state.jaxis, 4);
+        w.write(state.direction, 1);
+        w.write(state.flags, 4);
+        w.write(quantize_fixed(state.x, PackedPositionFraction, PackedPositionBits), PackedPositionBits);
+        w.write(quantize_fixed(state.y, PackedPositionFraction, PackedPositionBits), PackedPositionBits);
+        w.write(quantize_range(state.accel_x, XMaxAccel, PackedAccelXBits), PackedAccelXBits);
+        w.write(quantize_range(state.accel_y, YMaxAccel, PackedAccelYBits), PackedAccelYBits);
+        w.write(quantize_range(state.jump_accel_y, YMaxAccel, PackedJumpAccelYBits), PackedJumpAccelYBits);
+        w.flush();
+    }
+
+    inline void unpack(GPlayerClientServerState& state) const {
+        BitReader r(data);
+        state.key_states = static_cast<keystates_t>(r.read(9));
+        state.jaxis = static_cast<joyaxis_t>(r.read(4));
+        state.direction = static_cast<unsigned char>(r.read(1));
+        state.flags = static_cast<playerflags_t>(r.read(4));
+        state.x = static_cast<double>(r.read_signed(PackedPositionBits)) / PackedPositionFraction;
+        state.y = static_cast<double>(r.read_signed(PackedPositionBits)) / PackedPositionFraction;
+        state.accel_x = dequantize_range(r.read_signed(PackedAccelXBits), XMaxAccel, PackedAccelXBits);
+        state.accel_y = dequantize_range(r.read_signed(PackedAccelYBits), YMaxAccel, PackedAccelYBits);
+        state.jump_accel_y = dequantize_range(r.read_signed(PackedJumpAccelYBits), YMaxAccel, PackedJumpAccelYBits);
+    }
+};
+#pragma pack()
+
 #pragma pack(1)
 struct GPlayerState {
     player_id_t id;              // 2
@@ -293,18 +420,16 @@ struct GPlayerState {
 struct GPTAllStates {
     identifier_t id;
     GPlayerServerState server_state;
-    GPlayerClientServerState client_server_state;
+    GPlayerClientServerStatePacked client_server_state;
 
     inline void from_net() {
         id = ntohs(id);
         server_state.from_net();
-        client_server_state.from_net();
     }
 
     inline void to_net() {
         id = htons(id);
         server_state.to_net();
-        client_server_state.to_net();
     }
 };
 #pragma pack()
@@ -315,13 +440,16 @@ struct GPlayerDescription {
     player_id_t id;
     char player_name[NameLength];
     char characterset_name[NameLength];
+    uint16_t interpolation_delay;   /* ms, login only */
 
     inline void from_net() {
         id = ntohs(id);
+        interpolation_delay = ntohs(interpolation_delay);
     }
 
     inline void to_net() {
         id = htons(id);
+        interpolation_delay = htons(interpolation_delay);
     }
 };
 #pragma pack()
@@ -358,8 +486,8 @@ struct GPlayerInfo {
 
 #pragma pack(1)
 struct GAnimation {
-    char animation_name[NameLength];
-    char sound_name[NameLength];
+    stringid_t animation_name_id;
+    stringid_t sound_name_id;
     identifier_t id;            // 2
     scounter_t duration;        // 2
     identifier_t owner;         // 2
@@ -368,6 +496,8 @@ struct GAnimation {
     double accel_x;             // 8
     double accel_y;             // 8
     inline void from_net() {
+        animation_name_id = ntohs(animation_name_id);
+        sound_name_id = ntohs(sound_name_id);
         id = ntohs(id);
         duration = ntohs(duration);
         owner = ntohs(owner);
@@ -378,6 +508,8 @@ struct GAnimation {
     }
 
     inline void to_net() {
+        animation_name_id = htons(animation_name_id);
+        sound_name_id = htons(sound_name_id);
         id = htons(id);
         duration = htons(duration);
         owner = htons(owner);
@@ -393,7 +525,7 @@ const int GTextAnimationFlagCenterScreen = 1;
 
 #pragma pack(1)
 struct GTextAnimation {
-    char font_name[NameLength];
+    stringid_t font_name_id;
     char display_text[TextLength];
     double x;
     double y;
@@ -401,12 +533,14 @@ struct GTextAnimation {
     flags_t flags;
 
     inline void from_net() {
+        font_name_id = ntohs(font_name_id);
         byte_swap<double>(x);
         byte_swap<double>(y);
         max_counter = ntohs(max_counter);
     }
 
     inline void to_net() {
+        font_name_id = htons(font_name_id);
         byte_swap<double>(x);
         byte_swap<double>(y);
         max_counter = htons(max_counter);
@@ -457,19 +591,21 @@ struct GPlaceObject {
 
 #pragma pack(1)
 struct GSpawnObject {
-    char object_name[NameLength];
+    stringid_t object_name_id;
     identifier_t id;
     flags_t flags;
     pos_t x;
     pos_t y;
 
     inline void from_net() {
+        object_name_id = ntohs(object_name_id);
         id = ntohs(id);
         x = ntohl(x);
         y = ntohl(y);
     }
 
     inline void to_net() {
+        object_name_id = htons(object_name_id);
         id = htons(id);
         x = htonl(x);
         y = htonl(y);
@@ -505,8 +641,8 @@ struct GObjectState {
 
 #pragma pack(1)
 struct GSpawnNPC {
-    char npc_name[NameLength];
-    char sound_name[NameLength];
+    stringid_t npc_name_id;
+    stringid_t sound_name_id;
     identifier_t id;
     identifier_t owner;
     unsigned char direction;
@@ -517,6 +653,8 @@ struct GSpawnNPC {
     double accel_y;
 
     inline void from_net() {
+        npc_name_id = ntohs(npc_name_id);
+        sound_name_id = ntohs(sound_name_id);
         id = ntohs(id);
         owner = ntohs(owner);
         byte_swap<double>(x);
@@ -526,6 +664,8 @@ struct GSpawnNPC {
     }
 
     inline void to_net() {
+        npc_name_id = htons(npc_name_id);
+        sound_name_id = htons(sound_name_id);
         id = htons(id);
         owner = htons(owner);
         byte_swap<double>(x);
@@ -786,6 +926,120 @@ struct GPakHash {
 };
 #pragma pack()
 
+/* entity records, delta encoded against the baseline snapshot */
+/* the client acknowledged last, see Snapshot.hpp               */
+const int SnapshotFlagDelta = 1;
+
+#pragma pack(1)
+struct GSnapshot {
+    uint16_t snapshot_no;
+    uint16_t baseline_no;
+    uint32_t server_time;       /* ms, the server's tick clock */
+    flags_t flags;
+    unsigned char part;
+    unsigned char parts;
+    data_t data[1];
+
+    inline void from_net() {
+        snapshot_no = ntohs(snapshot_no);
+        baseline_no = ntohs(baseline_no);
+        server_time = ntohl(server_time);
+    }
+
+    inline void to_net() {
+        snapshot_no = htons(snapshot_no);
+        baseline_no = htons(baseline_no);
+        server_time = htonl(server_time);
+    }
+};
+#pragma pack()
+
+#pragma pack(1)
+struct GSnapshotAck {
+    uint16_t snapshot_no;
+
+    inline void from_net() {
+        snapshot_no = ntohs(snapshot_no);
+    }
+
+    inline void to_net() {
+        snapshot_no = htons(snapshot_no);
+    }
+};
+#pragma pack()
+
+/* resource names are numbered by the server and sent once at */
+/* sync time, events refer to them by id, see StringTable.hpp  */
+const stringid_t StringIdNone = 0xffff;
+
+#pragma pack(1)
+struct GStringTableEntry {
+    unsigned char kind;
+    stringid_t id;
+    char name[NameLength];
+
+    inline void from_net() {
+        id = ntohs(id);
+    }
+
+    inline void to_net() {
+        id = htons(id);
+    }
+};
+#pragma pack()
+
+/* the movement of a player is simulated by the server. clients */
+/* send the keys of every tick, numbered, and predict their own  */
+/* movement until the server acknowledges the input with the     */
+/* state it ended up with.                                       */
+const int PlayerInputsPerPacket = 8;
+
+#pragma pack(1)
+struct GPlayerInput {
+    uint16_t input_no;
+    keystates_t key_states;
+    joyaxis_t jaxis;
+    playerflags_t flags;         /* PlayerClientServerFlagWriting   */
+    unsigned char spawn_no;      /* counts the spawns of the client */
+    unsigned char spawn_index;   /* spawn point of the last one     */
+
+    inline void from_net() {
+        input_no = ntohs(input_no);
+        key_states = ntohs(key_states);
+        flags = ntohs(flags);
+    }
+
+    inline void to_net() {
+        input_no = htons(input_no);
+        key_states = htons(key_states);
+        flags = htons(flags);
+    }
+};
+#pragma pack()
+
+#pragma pack(1)
+struct GPlayerInputAck {
+    uint16_t input_no;
+    playerflags_t client_flags;
+    pos_t last_falling_y_pos;
+    GPlayerClientServerState client_server_state;
+
+    inline void from_net() {
+        input_no = ntohs(input_no);
+        client_flags = ntohs(client_flags);
+        last_falling_y_pos = ntohl(last_falling_y_pos);
+        client_server_state.from_net();
+    }
+
+    inline void to_net() {
+        input_no = htons(input_no);
+        client_flags = htons(client_flags);
+        last_falling_y_pos = htonl(last_falling_y_pos);
+        client_server_state.to_net();
+    }
+};
+#pragma pack()
+
 const int GTransportLen = sizeof(GTransport) - 1;
 const int GPlayerInfoLen = sizeof(GPlayerInfo);
 const int GTournamentLen = sizeof(GTournament);
@@ -793,6 +1047,7 @@ const int GPlayerStateLen = sizeof(GPlayerState);
 const int GPTAllStatesLen = sizeof(GPTAllStates);
 const int GPlayerClientStateLen = sizeof(GPlayerClientState);
 const int GPlayerClientServerStateLen = sizeof(GPlayerClientServerState);
+const int GPlayerClientServerStatePackedLen = sizeof(GPlayerClientServerStatePacked);
 const int GPlayerServerStateLen = sizeof(GPlayerServerState);
 const int GGameStateLen = sizeof(GGameState);
 const int GPlayerDescriptionLen = sizeof(GPlayerDescription);
@@ -816,5 +1071,10 @@ const int GXferHeaderLen = sizeof(GXferHeader);
 const int GXferDataChunkLen = sizeof(GXferDataChunk) - 1;
 const int GHillCounterLen = sizeof(GHillCounter);
 const int GPakHashLen = sizeof(GPakHash);
+const int GSnapshotLen = sizeof(GSnapshot) - 1;
+const int GSnapshotAckLen = sizeof(GSnapshotAck);
+const int GStringTableEntryLen = sizeof(GStringTableEntry);
+const int GPlayerInputLen = sizeof(GPlayerInput);
+const int GPlayerInputAckLen = sizeof(GPlayerInputAck);
 
 #endif // GAMEPROTOCOL_HPP
@@ -0,0 +1,41 @@
+#ifndef HITBOXHISTORY_HPP
+#define HITBOXHISTORY_HPP
+
+/* where a player stood at the end of a server tick */
+struct HitboxSample {
+    double time;                /* ns, the tournament's simulation time */
+    double x;
+    double y;
+};
+
+/* shots are rewound at most that far, in ns */
+const double HitboxHistoryDuration = 500000000.0f;
+
+/* enough for HitboxHistoryDuration at 60 ticks per second */
+const int HitboxHistorySize = 32;
+
+/* server side, the recent positions of a player. hits of shots */
+/* are tested against the position the shooter saw on screen.   */
+class HitboxHistory {
+public:
+    HitboxHistory();
+    virtual ~HitboxHistory();
+
+    void clear();
+    void add(double time, double x, double y);
+
+    /* false and x, y untouched, if there is no sample yet */
+    bool get(double time, double& x, double& y) const;
+
+    /* false, if there is no sample yet */
+    bool get_bounds(double& min_x, double& min_y, double& max_x, double& max_y) const;
+
+private:
+    HitboxSample samples[HitboxHistorySize];
+    int head;
+    int count;
+
+    const HitboxSample& at(int index) const;
+};
+
+#endif // HITBOXHISTORY_HPP
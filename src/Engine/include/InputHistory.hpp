@@ -0,0 +1,54 @@
+#ifndef INPUTHISTORY_HPP
+#define INPUTHISTORY_HPP
+
+#include "GameProtocol.hpp"
+
+#include <deque>
+
+/* one tick of own input and where it moved the player to */
+struct PredictedInput {
+    GPlayerInput input;         /* host byte order */
+    double x;
+    double y;
+};
+
+/* at most that many ticks are predicted ahead of the server */
+const size_t InputHistorySize = 120;
+
+/* smaller differences to the server are no misprediction, in pixels */
+const double PredictionTolerance = 1.0f;
+
+/* client side prediction, the inputs the server has not */
+/* acknowledged yet, oldest first.                       */
+class InputHistory {
+private:
+    InputHistory(const InputHistory&);
+    InputHistory& operator=(const InputHistory&);
+
+public:
+    InputHistory();
+    virtual ~InputHistory();
+
+    void clear();
+
+    /* numbers the input and keeps it */
+    void add(GPlayerInput& input, double x, double y);
+
+    /* drops input_no and everything before, false, if it is not */
+    /* in the history anymore (duplicate, reordered or too old)  */
+    bool acknowledge(uint16_t input_no, PredictedInput& acked);
+
+    size_t get_count() const;
+    PredictedInput& get(size_t index);
+
+    /* the newest max inputs in network byte order, oldest first */
+    size_t get_newest(GPlayerInput *out, size_t max) const;
+
+private:
+    typedef std::deque<PredictedInput> Inputs;
+
+    Inputs inputs;
+    uint16_t input_no;
+};
+
+#endif // INPUTHISTORY_HPP
@@ -5,6 +5,7 @@
 #include "MessageSequencer.hpp"
 #include "Thread.hpp"
 #include "Mutex.hpp"
+#include "Reactor.hpp"
 #include "GameserverInformation.hpp"
 
 class LANBroadcasterException : public Exception {
@@ -30,6 +31,7 @@ private:
     bool running;
 
     Mutex mtx;
+    Reactor reactor;
 
     virtual void event_status(hostaddr_t host, hostport_t port, const std::string& name,
         int max_clients, int cur_clients, ms_t ping_time, bool secured,
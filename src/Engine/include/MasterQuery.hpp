@@ -6,6 +6,7 @@
 #include "Timing.hpp"
 #include "Thread.hpp"
 #include "Mutex.hpp"
+#include "Reactor.hpp"
 
 #include <vector>
 
@@ -35,8 +36,12 @@ private:
     bool running;
 
     Mutex mtx;
+    Reactor reactor;
+    Hosts unwatched;    /* new clients, not yet known to the reactor */
+    Hosts retired;      /* old clients, the thread unwatches and deletes them */
 
     void cleanup();
+    void update_watches();
 
     virtual void thread();
 };
@@ -3,29 +3,56 @@
 
 #include "Protocol.hpp"
 #include "UDPSocket.hpp"
+#include "NetReceiver.hpp"
+#include "Reactor.hpp"
+#include "Deflater.hpp"
+#include "Inflater.hpp"
 
-#include <deque>
 #include <vector>
+#include <deque>
 #include <time.h>
 
-/* we start to resend after 50ms,                       */
-/* then doubling the resend interval after each resend. */
+/* a payload slot is large enough for everything fitting into a datagram */
+const int MessageSlotSize = 1024;
+
+/* arena of fixed size payload slots. memory is carved in blocks */
+/* and only handed back when the slab dies, so acquiring and     */
+/* releasing slots is allocation-free in steady state. slots are */
+/* reference counted, so one payload can sit in many queues.     */
+class MessageSlab {
+private:
+    MessageSlab(const MessageSlab&);
+    MessageSlab& operator=(const MessageSlab&);
+
+public:
+    MessageSlab();
+    ~MessageSlab();
+
+    data_t *acquire();
+    void retain(data_t *slot);
+    void release(data_t *slot);
+
+private:
+    typedef std::vector<data_t *> Slots;
+
+    Slots blocks;
+    Slots free_slots;
+};
+
+/* the first resend timeout is the connection's resend_timeout, */
+/* then doubling the resend interval after each resend.          */
 struct QueueMessage {
-    QueueMessage() { }
-    QueueMessage(sequence_no_t seq_no, flags_t flags, command_t cmd, data_len_t len, data_t *data)
-        : resends(0), last_resend_ms(50), seq_no(seq_no), flags(flags), cmd(cmd), len(len), data(data)
+    QueueMessage()
+        : used(false), resends(0), last_resend_ms(50), seq_no(0), flags(0), cmd(0), len(0), data(0)
     {
         touch.tv_nsec = 0;
         touch.tv_sec = 0;
+        first_touch = touch;
     }
 
-    ~QueueMessage() {
-        if (data) {
-            delete[] data;
-        }
-    }
-
+    bool used;
     gametime_t touch;
+    gametime_t first_touch;
     pico_size_t resends;
     int last_resend_ms;
     sequence_no_t seq_no;
@@ -35,39 +62,119 @@ struct QueueMessage {
     data_t *data;
 };
 
+/* the receiving ring starts with this many slots, so a send */
+/* window larger than that would only produce dropped data  */
+const size_t MaxSendWindow = 64;
+
+/* ring buffer of reliable messages, indexed by sequence number. */
+/* base is the oldest sequence number the ring is waiting for.   */
+class MessageQueue {
+private:
+    MessageQueue(const MessageQueue&);
+    MessageQueue& operator=(const MessageQueue&);
+
+public:
+    MessageQueue(MessageSlab& slab);
+    ~MessageQueue();
+
+    bool put(sequence_no_t seq_no, flags_t flags, command_t cmd, data_len_t len, const void *data);
+    void push_back(sequence_no_t seq_no, flags_t flags, command_t cmd, data_len_t len, const void *data);
+    void push_back_shared(sequence_no_t seq_no, flags_t flags, command_t cmd, data_len_t len, data_t *shared);
+    QueueMessage *get(sequence_no_t seq_no);
+    QueueMessage *front();
+    sequence_no_t front_seq_no() const;
+    void pop_front();
+    void remove(sequence_no_t seq_no);
+    void clear(sequence_no_t new_base);
+    size_t size() const;
+
+private:
+    typedef std::vector<QueueMessage> Ring;
+
+    MessageSlab& slab;
+    Ring ring;
+    size_t mask;
+    sequence_no_t base;
+    size_t count;
+
+    QueueMessage *claim(sequence_no_t seq_no, flags_t flags, command_t cmd, data_len_t len);
+    void grow();
+};
+
+/* link quality, estimated like tcp does (rfc 6298) */
+const ms_t InitialResendTimeout = 100;
+
 struct Connection {
     Connection(hostaddr_t host, hostport_t port)
-        : host(host), port(port), ping_time(0) { }
+        : host(host), port(port), ping_time(0), ping_jitter(0),
+          resend_timeout(InitialResendTimeout), packet_loss(0.0f) { }
 
     hostaddr_t host;
     hostport_t port;
-    ms_t ping_time;
+    ms_t ping_time;         /* smoothed round trip time */
+    ms_t ping_jitter;       /* mean deviation of the round trip time */
+    ms_t resend_timeout;    /* first resend of a reliable message */
+    float packet_loss;      /* smoothed fraction of lost packets, 0..1 */
 };
 
 struct SequencerHeap : public Connection {
-    typedef std::deque<QueueMessage *> QueuedMessages;
-
-    SequencerHeap(hostaddr_t host, hostport_t port)
-        : Connection(host, port), sent_pings(0), active(true),
+    SequencerHeap(MessageSlab& slab, hostaddr_t host, hostport_t port)
+        : Connection(host, port), slot(0), active(true), ack_pending(false), peer_inflates(false),
+          peer_stamp_valid(false), peer_stamp(0), rtt_valid(false), srtt(0.0f), rttvar(0.0f),
           last_send_unrel_seq_no(0), last_send_rel_seq_no(0),
-          last_recv_unrel_seq_no(0), last_recv_rel_seq_no(0)
+          last_recv_unrel_seq_no(0), last_recv_rel_seq_no(0),
+          in_queue(slab), out_queue(slab)
     {
-        last_ping.tv_sec = 0;
-        last_ping.tv_nsec = 0;
+        get_now(last_recv);
+        last_send = ack_since = peer_stamp_touch = retired = last_recv;
     }
 
-    int sent_pings;
+    void reset(hostaddr_t host, hostport_t port) {
+        this->host = host;
+        this->port = port;
+        ping_time = 0;
+        ping_jitter = 0;
+        resend_timeout = InitialResendTimeout;
+        packet_loss = 0.0f;
+        rtt_valid = false;
+        srtt = 0.0f;
+        rttvar = 0.0f;
+        active = true;
+        ack_pending = false;
+        peer_inflates = false;
+        peer_stamp_valid = false;
+        peer_stamp = 0;
+        last_send_unrel_seq_no = 0;
+        last_send_rel_seq_no = 0;
+        last_recv_unrel_seq_no = 0;
+        last_recv_rel_seq_no = 0;
+        get_now(last_recv);
+        last_send = ack_since = peer_stamp_touch = last_recv;
+    }
+
+    size_t slot;    /* position in the active heap list */
     bool active;
+    bool ack_pending;
+    bool peer_inflates;     /* peer announced NetFlagsInflates */
+    bool peer_stamp_valid;
+    uint16_t peer_stamp;
+    bool rtt_valid;
+    float srtt;
+    float rttvar;
 
     sequence_no_t last_send_unrel_seq_no;
     sequence_no_t last_send_rel_seq_no;
     sequence_no_t last_recv_unrel_seq_no;
     sequence_no_t last_recv_rel_seq_no;
 
-    gametime_t last_ping;
+    gametime_t last_recv;           /* anything heard from the peer */
+    gametime_t last_send;           /* anything sent to the peer    */
+    gametime_t ack_since;           /* oldest unsent ack            */
+    gametime_t peer_stamp_touch;    /* when peer_stamp arrived      */
+    gametime_t retired;             /* when the connection ended    */
 
-    QueuedMessages in_queue;
-    QueuedMessages out_queue;
+    MessageQueue in_queue;
+    MessageQueue out_queue;
 };
 
 class MessageSequencer {
@@ -84,7 +191,8 @@ public:
         RefusalReasonWrongPassword
     };
 
-    MessageSequencer(hostport_t port, pico_size_t num_heaps, const std::string& name, const std::string& password) throw (Exception);
+    MessageSequencer(hostport_t port, pico_size_t num_heaps, const std::string& name, const std::string& password,
+        size_t num_receivers = 0) throw (Exception);
     MessageSequencer(hostaddr_t server_host, hostport_t server_port) throw (Exception);
     virtual ~MessageSequencer();
 
@@ -98,9 +206,21 @@ public:
     void push(flags_t flags, command_t cmd, data_len_t len, const void *data) throw (Exception);
     void push(const Connection *c, flags_t flags, data_len_t len, const void *data) throw (Exception);
     void push(const Connection *c, command_t cmd, flags_t flags, data_len_t len, const void *data) throw (Exception);
+
+    /* encode once, send to many: share() copies the payload into a   */
+    /* reference counted slot, push_shared() queues it without copy. */
+    data_t *share(data_len_t len, const void *data) throw (Exception);
+    void push_shared(const Connection *c, flags_t flags, data_len_t len, data_t *shared) throw (Exception);
+    void unshare(data_t *shared);
     bool cycle() throw (Exception);
+    void flush() throw (Exception);
     void kill(const Connection *c) throw (Exception);
 
+    /* lets the reactor wake up on incoming datagrams, */
+    /* unwatch before the reactor dies                 */
+    void watch(Reactor& reactor) throw (Exception);
+    void unwatch(Reactor& reactor);
+
     virtual void event_status(hostaddr_t host, hostport_t port, const std::string& name,
         int max_clients, int cur_clients, ms_t ping_time, bool secured,
         int protocol_version) throw (Exception) { }
@@ -109,29 +229,68 @@ public:
     virtual void event_data(const Connection *c, data_len_t len, void *data) throw (Exception) { }
     virtual void event_logout(const Connection *c, LogoutReason reason) throw (Exception) { }
 
+protected:
+    void set_io_batch_size(size_t count) throw (Exception);
+    void set_send_window(size_t count);
+
 private:
     typedef std::vector<SequencerHeap *> SequencerHeaps;
+    typedef std::deque<SequencerHeap *> RetiredHeaps;
+    typedef std::vector<NetReceiver *> NetReceivers;
 
     pico_size_t max_heaps;
     bool is_client;
+    size_t send_window;
     std::string name;
     std::string password;
     UDPSocket socket;
     NetMessage *pmsg;
     NetMessageData *pdata;
+    NetReceivers receivers;
+    size_t next_receiver;
+
+    MessageSlab slab;
+    SequencerHeaps heaps;       /* active connections, heap->slot is its index */
+    RetiredHeaps free_heaps;    /* retired heaps, recycled after quarantine */
+    SequencerHeaps heap_index;  /* open addressed (host, port) lookup table */
+    char buffer[MessageSlotSize + 1];   /* full slot and the terminator of event_data */
 
-    SequencerHeaps heaps;
-    char buffer[1024];
+    std::string dictionary;
+    Deflater deflater;
+    Inflater inflater;
+    data_t *deflate_source;     /* shared slot of the last deflated broadcast */
+    data_t *deflated;           /* and its deflated copy, 0 if incompressible */
+    data_len_t deflated_len;
+    data_t deflate_buffer[MessageSlotSize];
 
-    void ack(SequencerHeap *heap, sequence_no_t seq_no) throw (Exception);
+    ssize_t receive(hostaddr_t *host, hostport_t *port, bool *decoded) throw (Exception);
+    void start_receivers(hostport_t port, size_t count) throw (Exception);
+    void stop_receivers();
+    void ack(SequencerHeap *heap) throw (Exception);
+    void process_header(SequencerHeap *heap, const NetMessage& header, const gametime_t& now) throw (Exception);
+    void acknowledged(SequencerHeap *heap, QueueMessage *msg) throw (Exception);
+    uint32_t selective_acks(SequencerHeap *heap);
+    bool send_out_queue(SequencerHeap *heap, const gametime_t& now, bool& sent) throw (Exception);
+    void update_rtt(SequencerHeap *heap, ms_t sample);
+    void update_loss(SequencerHeap *heap, sequence_no_t lost);
+    size_t loss_window(const SequencerHeap *heap) const;
     void process_incoming(SequencerHeap *heap, NetMessage *msg) throw (Exception);
-    void sorted_insert(SequencerHeap::QueuedMessages& msg_queue, QueueMessage *smsg);
+    bool deflatable(SequencerHeap *heap, command_t cmd, data_len_t len) const;
+    data_len_t deflate(data_len_t len, const void *data, void *out);
+    SequencerHeap *create_heap(hostaddr_t host, hostport_t port);
     SequencerHeap *find_heap(hostaddr_t host, hostport_t port);
     SequencerHeap *find_heap(const Connection *c);
+    size_t index_position(hostaddr_t host, hostport_t port) const;
+    void index_heap(SequencerHeap *heap);
+    void unindex_heap(SequencerHeap *heap);
     void delete_heap(SequencerHeap *heap);
     void flush_queues(SequencerHeap *heap);
     void slack_send(hostaddr_t host, hostport_t port, sequence_no_t seq_no,
         flags_t flags, command_t cmd, data_len_t len, const void *data) throw (Exception);
+    void slack_send(SequencerHeap *heap, sequence_no_t seq_no,
+        flags_t flags, command_t cmd, data_len_t len, const void *data) throw (Exception);
+    void send_message(hostaddr_t host, hostport_t port, sequence_no_t seq_no,
+        flags_t flags, command_t cmd, data_len_t len, const void *data) throw (Exception);
     void delete_all_heaps();
 };
 
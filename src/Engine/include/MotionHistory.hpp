@@ -0,0 +1,47 @@
+#ifndef MOTIONHISTORY_HPP
+#define MOTIONHISTORY_HPP
+
+/* server states of a remote entity, on the server's timeline */
+struct MotionSample {
+    double time;                /* ns */
+    double x;
+    double y;
+    double accel_x;             /* per MotionVelocityPeriod, like the physics */
+    double accel_y;
+};
+
+const int MotionHistorySize = 16;
+const double MotionVelocityPeriod = 10000000.0f;    /* ns, see Tournament::ns_fc */
+const double MotionMaxExtrapolation = 50000000.0f;  /* ns */
+const double MotionSnapDistance = 128.0f;           /* larger jumps are teleports */
+
+/* the client renders remote entities a little in the past, */
+/* hermite interpolated between the states it got for them. */
+class MotionHistory {
+public:
+    MotionHistory();
+    virtual ~MotionHistory();
+
+    void clear();
+    void add(double time, double x, double y, double accel_x, double accel_y);
+
+    /* false, if there is no sample yet */
+    bool sample(double time, double& x, double& y, double& accel_x, double& accel_y) const;
+
+    /* true, if the motion stopped or turned after moving faster */
+    /* than velocity, somewhere in the period (from, to]         */
+    bool bumped(double from, double to, double velocity) const;
+
+    /* the same, but only falling down counts */
+    bool landed(double from, double to, double velocity) const;
+
+private:
+    MotionSample samples[MotionHistorySize];
+    int head;
+    int count;
+
+    const MotionSample& at(int index) const;
+    bool stopped(double from, double to, double velocity, bool any_direction) const;
+};
+
+#endif // MOTIONHISTORY_HPP
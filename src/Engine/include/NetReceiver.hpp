@@ -0,0 +1,56 @@
+#ifndef NETRECEIVER_HPP
+#define NETRECEIVER_HPP
+
+#include "Protocol.hpp"
+#include "UDPSocket.hpp"
+#include "Thread.hpp"
+#include "Mutex.hpp"
+#include "SPSCQueue.hpp"
+#include "Reactor.hpp"
+
+/* a datagram with NetMessage and NetMessageData already in host order */
+struct ReceivedDatagram {
+    hostaddr_t host;
+    hostport_t port;
+    size_t len;
+    char data[UDPDatagramMaxSize];
+};
+
+/* receive front-end: owns an SO_REUSEPORT socket on the server port, */
+/* drains it in its own thread and hands the decoded datagrams over   */
+/* to the sequencer through a lock-free queue.                        */
+class NetReceiver : public Thread {
+private:
+    NetReceiver(const NetReceiver&);
+    NetReceiver& operator=(const NetReceiver&);
+
+public:
+    NetReceiver(hostport_t port) throw (Exception);
+    virtual ~NetReceiver();
+
+    void start() throw (Exception);
+    void stop();
+
+    UDPSocket& get_socket();
+
+    /* woken up after each burst of received datagrams. once */
+    /* set_reactor(0) returned, the old one is not touched   */
+    void set_reactor(Reactor *reactor);
+
+    /* consumer side, sequencer thread only */
+    const ReceivedDatagram *front();
+    void pop();
+
+private:
+    UDPSocket socket;
+    SPSCQueue<ReceivedDatagram> queue;
+    volatile bool running;
+    Mutex reactor_mtx;
+    Reactor *reactor;           /* guarded by reactor_mtx */
+    char scratch[UDPDatagramMaxSize];
+
+    /* implements Thread */
+    virtual void thread();
+};
+
+#endif // NETRECEIVER_HPP
@@ -0,0 +1,37 @@
+#ifndef PACKETBUILDER_HPP
+#define PACKETBUILDER_HPP
+
+#include "GameProtocol.hpp"
+#include "MessageSequencer.hpp"
+
+/* upper bound of the configurable packet size, a message of this */
+/* size fills a receive slot. whether it passes the path mtu is up */
+/* to the server admin, the default is the safe PacketMaxSize.     */
+const int PacketSizeLimit = MessageSlotSize - NetMessageHeaderLength;
+
+/* accumulates GTransport records into one message */
+class PacketBuilder {
+private:
+    PacketBuilder(const PacketBuilder&);
+    PacketBuilder& operator=(const PacketBuilder&);
+
+public:
+    PacketBuilder();
+    ~PacketBuilder();
+
+    void set_max_size(int max_size);
+    bool is_empty() const;
+    bool fits(data_len_t len) const;
+    void append(unsigned char tournament_id, command_t cmd, data_len_t len, const void *data);
+    data_len_t get_size() const;
+    const void *get_data() const;
+    void clear();
+
+private:
+    data_t buffer[PacketSizeLimit];
+    int max_size;
+    int size;
+    GTransport *last;
+};
+
+#endif // PACKETBUILDER_HPP
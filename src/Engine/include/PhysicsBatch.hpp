@@ -0,0 +1,69 @@
+#ifndef PHYSICSBATCH_HPP
+#define PHYSICSBATCH_HPP
+
+#include "AABB.hpp"
+#include "CollisionGrid.hpp"
+#include "EntityPool.hpp"
+
+#include <vector>
+#include <cstddef>
+
+/* advances the flying entities of a step at once, two lanes per   */
+/* SSE2 instruction where available. a lane is free, if its move   */
+/* neither touches a tile nor the map border, all others are left  */
+/* to the scalar collision resolver.                               */
+class PhysicsBatch {
+private:
+    PhysicsBatch(const PhysicsBatch&);
+    PhysicsBatch& operator=(const PhysicsBatch&);
+
+public:
+    PhysicsBatch();
+    virtual ~PhysicsBatch();
+
+    void clear();
+    void add(const EntityHandle& entity, double x, double y, double accel_x, double accel_y,
+        const CollisionBox& colbox, int width, int height, bool gravity);
+
+    void integrate(double period_f, double accel_gravity, double max_accel_y,
+        const CollisionGrid& grid, int tile_width, int tile_height, int map_width);
+
+    /* false, if the lane does not belong to the entity or is not free */
+    bool is_free(size_t lane, const EntityHandle& entity) const;
+    void get_move(size_t lane, double& x, double& y, double& accel_y) const;
+
+private:
+    typedef std::vector<double> Lanes;
+    typedef std::vector<int> Cells;
+
+    std::vector<EntityHandle> entities;
+
+    /* input */
+    Lanes pos_x;
+    Lanes pos_y;
+    Lanes accel_x;
+    Lanes accel_y;
+    Lanes gravity;              /* 1.0, if the lane falls */
+    Lanes box_left;             /* colbox relative to the position */
+    Lanes box_width;
+    Lanes box_bottom;
+    Lanes box_height;
+
+    /* output */
+    Lanes new_x;
+    Lanes new_y;
+    Lanes new_accel_y;
+    Cells border;
+    Cells cell_left;            /* tiles, that the sweeps might visit */
+    Cells cell_top;
+    Cells cell_right;
+    Cells cell_bottom;
+    std::vector<char> free_lanes;
+
+    void integrate_lane(size_t i, double period_f, double gravity_step,
+        double max_accel_y, int tile_width, int tile_height, int map_width);
+
+    static bool is_empty(const CollisionGrid& grid, int left, int top, int right, int bottom);
+};
+
+#endif // PHYSICSBATCH_HPP
@@ -3,10 +3,16 @@
 
 #include "MessageSequencer.hpp"
 #include "GameProtocol.hpp"
+#include "Snapshot.hpp"
+#include "MotionHistory.hpp"
+#include "HitboxHistory.hpp"
 #include "Resources.hpp"
 
 #include <string>
 #include <vector>
+#include <deque>
+
+typedef std::deque<GPlayerInput> PlayerInputs;
 
 class Player {
 public:
@@ -24,6 +30,7 @@ public:
     void mark_as_me();
     bool marked_as_me() const;
     void spawn(int x, int y);
+    void place(int x, int y);
     bool is_alive_and_playing() const;
     void clear();
     void reset();
@@ -37,6 +44,7 @@ private:
     Characterset *characterset;
 
     void clean_states();
+    void clean_motion();
     void reset_states();
 
 public:
@@ -48,13 +56,29 @@ public:
     bool its_me;
     bool respawning;
     bool joining;
-    bool force_broadcast;
     double flag_pick_refused_counter;
     bool flag_pick_refused;
     bool client_synced;
     bool server_force_quit_client;
     int server_force_quit_client_counter;
     int last_falling_y_pos;
+    bool snapshot_acked;
+    uint16_t snapshot_ack_no;
+    bool snapshot_trimmed;      /* server side, the last one exceeded the parts */
+    SnapshotHistory snapshots;  /* server side, what this client has seen */
+    unsigned char spawn_no;     /* client side own spawns, server side the applied ones */
+    unsigned char spawn_index;
+    PlayerInputs inputs;        /* server side, queued until their tick */
+    bool input_received;
+    uint16_t input_no;          /* newest queued */
+    bool input_acked;
+    GPlayerInput input;         /* server side, the one of this tick */
+    bool input_stalled;
+    int input_extrapolated;     /* ticks run again with the last input */
+    bool input_spawned;
+    MotionHistory motion;       /* client side, remote players */
+    HitboxHistory hitboxes;     /* server side, for lag compensation */
+    double interpolation_delay; /* server side, ns, the client's view delay */
 };
 
 typedef std::vector<Player *> Players;
@@ -15,7 +15,7 @@
 
 
 /* increase, if protocol changes */
-const int ProtocolVersion = 2;
+const int ProtocolVersion = 12;
 
 /* --- */
 typedef uint32_t hostaddr_t;
@@ -28,9 +28,15 @@ typedef unsigned char command_t;
 typedef uint16_t data_len_t;
 typedef uint8_t data_t;
 
-const int PacketMaxSize = 500; /* safe packet size */
+const int PacketMaxSize = 500; /* safe packet size, the default of the packet_size option */
 
 const int NetFlagsReliable = 1;
+const int NetFlagsEcho = 2;     /* echo and echo_delay in the header are valid */
+const int NetFlagsDeflate = 4;  /* reliable payload is deflated against the preset dictionary */
+const int NetFlagsInflates = 8; /* sender accepts deflated payloads */
+
+/* bit i of ack_bits set means ack + 2 + i already arrived */
+const int NetAckSelectiveBits = 32;
 
 enum NetCommand {
     NetCommandStatReq = 0,
@@ -49,19 +55,35 @@ enum NetCommand {
 #pragma pack(1)
 struct NetMessage {
     NetMessage(sequence_no_t seq_no, flags_t flags, command_t cmd)
-        : seq_no(seq_no), flags(flags), cmd(cmd) { }
+        : seq_no(seq_no), flags(flags), cmd(cmd), ack(0), ack_bits(0),
+          stamp(0), echo(0), echo_delay(0) { }
 
     sequence_no_t seq_no;
     flags_t flags;
     command_t cmd;
+    sequence_no_t ack;      /* last reliable message received in order */
+    uint32_t ack_bits;      /* reliable messages received beyond ack */
+    uint16_t stamp;         /* sender's clock in ms, wrapping */
+    uint16_t echo;          /* last stamp received from the peer */
+    uint16_t echo_delay;    /* ms the echoed stamp was held */
     data_t data[1];     /* good old struct hack (must be 1, pedantic c++) */
 
     inline void from_net() {
         seq_no = ntohl(seq_no);
+        ack = ntohl(ack);
+        ack_bits = ntohl(ack_bits);
+        stamp = ntohs(stamp);
+        echo = ntohs(echo);
+        echo_delay = ntohs(echo_delay);
     }
 
     inline void to_net() {
         seq_no = htonl(seq_no);
+        ack = htonl(ack);
+        ack_bits = htonl(ack_bits);
+        stamp = htons(stamp);
+        echo = htons(echo);
+        echo_delay = htons(echo_delay);
     }
 };
 #pragma pack()
@@ -87,6 +109,9 @@ struct NetMessageData {
 };
 #pragma pack()
 
+/* subtract 1 of the data[1] -> c++ forbids zero arrays eg. data[0] */
+const int NetMessageHeaderLength = sizeof(NetMessage) - 1 + sizeof(NetMessageData) - 1;
+
 const int ServerStatusFlagNeedPassword = 1;
 
 #pragma pack(1)
@@ -9,6 +9,9 @@
 #include "ClientServer.hpp"
 #include "TournamentFactory.hpp"
 #include "ServerLogger.hpp"
+#include "Reactor.hpp"
+#include "TickScheduler.hpp"
+#include "Snapshot.hpp"
 
 #include <vector>
 #include <fstream>
@@ -32,6 +35,8 @@ public:
     virtual ~Server();
 
     void start() throw (ServerException);
+    void start_threaded() throw (ServerException);
+    void join();
     void stop();
 
 private:
@@ -71,6 +76,7 @@ private:
     /* in ctor */
     Resources& resources;
     Subsystem& subsystem;
+    StringTable strings;
     TournamentFactory factory;
 
     int nbr_logout_msg;
@@ -84,11 +90,19 @@ private:
     hostaddr_t master_server;
     int ms_counter;
     UDPSocket master_socket;
+    Reactor reactor;
     size_t rotation_current_index;
     std::string team_red_name;
     std::string team_blue_name;
     std::ofstream *log_file;
     ServerLogger logger;
+    TickScheduler tick_scheduler;
+    int tick_statistics;    /* seconds between cost reports, 0 is off */
+    Snapshot snapshot;
+    uint16_t snapshot_no;
+    uint32_t snapshot_time;
+    std::vector<data_t> snapshot_buffer;
+    std::vector<size_t> snapshot_parts;
 
     MapConfigurations map_configs;
     HeldPlayerStats held_player_stats;
@@ -107,6 +121,13 @@ private:
     ClientPak *get_unsynced_client_pak(PlayerClientPak *pcpak);
     void destroy_paks(Player *p);
 
+    void broadcast_snapshot() throw (Exception);
+    void send_snapshot(Player *p) throw (Exception);
+    bool append_snapshot_part(size_t& pos, size_t sz, size_t max_part_size);
+    void next_input(Player *p);
+    void input_spawn(Player *p);
+    void send_input_ack(Player *p) throw (Exception);
+
     std::ostream& create_log_stream();
 
     /* implements Thread */
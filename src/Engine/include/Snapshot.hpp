@@ -0,0 +1,113 @@
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+#include "GameProtocol.hpp"
+
+#include <vector>
+
+/* entity records replicated by snapshots, in wire order */
+enum SnapshotKind {
+    SnapshotKindPlayer = 0,     /* GPTAllStates */
+    SnapshotKindObject,         /* GObjectState */
+    SnapshotKindAnimation,      /* GAnimationState */
+    SnapshotKindNPC,            /* GNPCState */
+    _SnapshotKindMAX
+};
+
+/* set in the kind byte of a record, that left the baseline */
+const unsigned char SnapshotKindRemoved = 0x80;
+
+/* large enough for the biggest state struct */
+const size_t SnapshotRecordSize = 64;
+
+/* a state struct in network byte order, starting with its 16 bit id */
+struct SnapshotRecord {
+    unsigned char kind;
+    uint16_t id;
+    int tile_x;                 /* server side only, for interest management */
+    int tile_y;
+    data_t data[SnapshotRecordSize];
+
+    bool operator<(const SnapshotRecord& rhs) const {
+        return (kind < rhs.kind || (kind == rhs.kind && id < rhs.id));
+    }
+};
+
+/* records of one broadcast, sorted by kind and id, once complete */
+class Snapshot {
+public:
+    typedef std::vector<SnapshotRecord> Records;
+
+    Snapshot();
+    virtual ~Snapshot();
+
+    void start(uint16_t snapshot_no, unsigned char parts);
+    void reset();
+    void add(SnapshotKind kind, const void *net_data, int tile_x, int tile_y);
+    void add(const SnapshotRecord& rec);
+    void remove(unsigned char kind, uint16_t id);
+
+    /* false, if the part is a duplicate or out of range */
+    bool add_part(unsigned char part);
+    bool has_all_parts() const;
+
+    /* sorts the records and, for delta snapshots, carries over */
+    /* the unchanged and not removed ones from the baseline     */
+    void finish(const Snapshot *baseline);
+
+    bool is_valid(uint16_t snapshot_no) const;
+    bool is_complete() const;
+    uint16_t get_snapshot_no() const;
+    const Records& get_records() const;
+    const SnapshotRecord *find(unsigned char kind, uint16_t id) const;
+
+    /* the delta of rec against base (or everything, if base is 0) */
+    /* is appended to out, returns the size or 0, if unchanged.    */
+    static size_t encode(const SnapshotRecord& rec, const SnapshotRecord *base, data_t *out);
+    static size_t encode_removed(const SnapshotRecord& base, data_t *out);
+
+    /* returns the consumed size or 0, if the data is malformed. */
+    /* removed records only come with their kind and id.         */
+    static size_t decode(const data_t *in, size_t len, const Snapshot *baseline,
+        SnapshotRecord& rec, bool& removed);
+
+    static size_t get_record_size(unsigned char kind);
+    static size_t get_max_encoded_size();
+
+private:
+    bool valid;
+    bool complete;
+    uint16_t snapshot_no;
+    unsigned char parts;
+    uint32_t parts_received[256 / 32];
+    Records records;
+    Records removed_records;    /* kind and id only */
+};
+
+/* the last SnapshotHistorySize snapshots, by number */
+const int SnapshotHistorySize = 32;
+
+class SnapshotHistory {
+private:
+    SnapshotHistory(const SnapshotHistory&);
+    SnapshotHistory& operator=(const SnapshotHistory&);
+
+public:
+    SnapshotHistory();
+    virtual ~SnapshotHistory();
+
+    Snapshot& slot(uint16_t snapshot_no);
+    Snapshot *get(uint16_t snapshot_no);
+    Snapshot *get_complete(uint16_t snapshot_no);
+    void clear();
+
+private:
+    Snapshot snapshots[SnapshotHistorySize];
+};
+
+/* sequence number arithmetic, wrapping at 16 bit */
+inline bool snapshot_newer(uint16_t lhs, uint16_t rhs) {
+    return (static_cast<int16_t>(lhs - rhs) > 0);
+}
+
+#endif // SNAPSHOT_HPP
@@ -0,0 +1,51 @@
+#ifndef SPATIALHASH_HPP
+#define SPATIALHASH_HPP
+
+#include "AABB.hpp"
+#include "EntityPool.hpp"
+
+#include <vector>
+
+/* broadphase for the entity tests. boxes are registered into */
+/* uniform cells, queries return each object once, in the     */
+/* order of insertion, whose box may touch the query box.     */
+/* pooled objects keep their handle, so that the owner can    */
+/* drop entries whose slot was recycled after the rebuild.    */
+class SpatialHash {
+private:
+    SpatialHash(const SpatialHash&);
+    SpatialHash& operator=(const SpatialHash&);
+
+public:
+    typedef std::vector<void *> Candidates;
+    typedef std::vector<EntityHandle> Handles;
+
+    SpatialHash(int cell_width, int cell_height);
+    virtual ~SpatialHash();
+
+    void clear();
+    void insert(void *object, const CollisionBox& box,
+        const EntityHandle& handle = EntityHandle());
+    void query(const CollisionBox& box, Candidates& candidates, Handles *handles = 0);
+
+private:
+    struct Node {
+        int entry;
+        int next;
+    };
+
+    int cell_width;
+    int cell_height;
+    std::vector<int> buckets;
+    std::vector<Node> nodes;
+    std::vector<void *> entries;
+    Handles entry_handles;
+    std::vector<unsigned int> marks;
+    std::vector<int> found;
+    unsigned int query_no;
+
+    int get_bucket(int cx, int cy) const;
+    static int get_cell(int v, int size);
+};
+
+#endif // SPATIALHASH_HPP
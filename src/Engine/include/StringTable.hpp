@@ -0,0 +1,71 @@
+#ifndef STRINGTABLE_HPP
+#define STRINGTABLE_HPP
+
+#include "GameProtocol.hpp"
+#include "Resources.hpp"
+
+#include <string>
+#include <vector>
+#include <map>
+
+/* resource kinds, whose names are sent as ids */
+enum StringTableKind {
+    StringTableAnimation = 0,
+    StringTableSound,
+    StringTableObject,
+    StringTableNPC,
+    StringTableFont,
+    _StringTableMAX
+};
+
+/* per session numbering of resource names. the server numbers */
+/* all names of its resources once and sends the table at sync */
+/* time, the client resolves each id to its resource only once. */
+class StringTable {
+private:
+    StringTable(const StringTable&);
+    StringTable& operator=(const StringTable&);
+
+public:
+    StringTable(Resources& resources);
+    virtual ~StringTable();
+
+    /* server side */
+    void build();
+
+    /* client side, resolve after the resources were reloaded */
+    void clear();
+    void add(StringTableKind kind, stringid_t id, const std::string& name);
+    void resolve();
+
+    /* StringIdNone, if the name is empty or unknown */
+    stringid_t get_id(StringTableKind kind, const std::string& name) const;
+    size_t get_count(StringTableKind kind) const;
+    const std::string& get_name(StringTableKind kind, stringid_t id) const;
+
+    Animation *get_animation(stringid_t id) const throw (ResourcesException);
+    Sound *get_sound(stringid_t id) const throw (ResourcesException);
+    Object *get_object(stringid_t id) const throw (ResourcesException);
+    NPC *get_npc(stringid_t id) const throw (ResourcesException);
+    Font *get_font(stringid_t id) const throw (ResourcesException);
+
+private:
+    struct Entry {
+        Entry() : resource(0) { }
+
+        std::string name;
+        void *resource;
+    };
+
+    typedef std::vector<Entry> Entries;
+    typedef std::map<std::string, stringid_t> Ids;
+
+    Resources& resources;
+    Entries entries[_StringTableMAX];
+    Ids ids[_StringTableMAX];
+
+    void *lookup(StringTableKind kind, const std::string& name);
+    void *get(StringTableKind kind, stringid_t id) const throw (ResourcesException);
+};
+
+#endif // STRINGTABLE_HPP
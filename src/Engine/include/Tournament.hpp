@@ -15,6 +15,11 @@
 #include "Gui.hpp"
 #include "Globals.hpp"
 #include "ServerLogger.hpp"
+#include "StringTable.hpp"
+#include "CollisionGrid.hpp"
+#include "SpatialHash.hpp"
+#include "EntityPool.hpp"
+#include "PhysicsBatch.hpp"
 
 #include <vector>
 #include <deque>
@@ -35,20 +40,23 @@ const double AnimationMultiplier = 3.0f;
 const double TextAnimationSpeed = 5.0f;
 const double XAccel = 0.055f;
 const double XDecel = 0.01f;
-const double XMaxAccel = 1.75f;
 const double YAccelGravity = 0.075f;
-const double YMaxAccel = 4.5f;
 const double YVeloLanding = 2.25f;
 const double YDecelJumpNormal = 0.075f;
 const double YDecelJump = 0.005f;
+const double BumpSoundVelocity = 0.35f;
+const int MaxInterpolationDelay = 300;  /* ms, clients report theirs at login */
 
 struct GameAnimation {
-    GameAnimation() : animation(0), animation_counter(0.0f),
-        index(0), falling(false),
+    GameAnimation() : animation(0), tilegraphic(0), width(0), height(0),
+        animation_counter(0.0f), index(0), falling(false),
         last_falling_y_pos(Player::PlayerFallingTestMaxY),
         delete_me(false) { }
 
     Animation *animation;
+    TileGraphic *tilegraphic;   /* of the animation, with its size */
+    int width;
+    int height;
     GAnimationState state;
     double animation_counter;
     int index;
@@ -80,11 +88,15 @@ struct GameTextMessage {
 };
 
 struct GameObject {
-    GameObject() : picked(false), spawn_counter(0.0f),
+    GameObject() : object(0), tilegraphic(0), width(0), height(0),
+        picked(false), spawn_counter(0.0f),
         falling(false), last_falling_y_pos(Player::PlayerFallingTestMaxY),
         spawned_object(false), delete_me(false) { }
 
     Object *object;
+    TileGraphic *tilegraphic;   /* of the object, with its size */
+    int width;
+    int height;
     GObjectState state;
     int origin_x;
     int origin_y;
@@ -94,15 +106,18 @@ struct GameObject {
     int last_falling_y_pos;
     bool spawned_object;
     bool delete_me;
+    MotionHistory motion;
 };
 
 struct SpawnableNPC {
-    SpawnableNPC() : npc(0), init_owner(0), move_counter(0.0f), in_idle(false),
-        idle_counter(0.0f), idle_counter_init(0.0f), ignore_owner_counter(0.0f),
-        falling(false), last_falling_y_pos(Player::PlayerFallingTestMaxY),
-        delete_me(false) { }
+    SpawnableNPC() : npc(0), width(0), height(0), init_owner(0), move_counter(0.0f),
+        in_idle(false), idle_counter(0.0f), idle_counter_init(0.0f),
+        ignore_owner_counter(0.0f), falling(false),
+        last_falling_y_pos(Player::PlayerFallingTestMaxY), delete_me(false) { }
 
     NPC *npc;
+    int width;                  /* of the standing tile, for the physics */
+    int height;
     GNPCState state;
     NPCAnimation icon;
     int iconindex;
@@ -115,6 +130,18 @@ struct SpawnableNPC {
     bool falling;
     int last_falling_y_pos;
     bool delete_me;
+    MotionHistory motion;
+};
+
+/* first blocking tiles of a swept move */
+struct TileContact {
+    double time;                /* 0..1, share of the move until the contact */
+    int normal_x;               /* pointing away from the tiles */
+    int normal_y;
+    int tile_x;
+    int tile_y;
+    double edge;                /* where the leading edge stops */
+    double friction;            /* the highest of the touched tiles */
 };
 
 struct StateResponse {
@@ -146,8 +173,8 @@ public:
     typedef std::vector<SpawnableNPC *> SpawnableNPCs;
     typedef std::vector<GameAnimation *> GameAnimations;
 
-    Tournament(Resources& resources, Subsystem& subsystem, Gui *gui, ServerLogger *logger,
-        const std::string& game_file, bool server,
+    Tournament(Resources& resources, StringTable& strings, Subsystem& subsystem, Gui *gui,
+        ServerLogger *logger, const std::string& game_file, bool server,
         const std::string& map_name, Players& players, int duration, bool warmup)
         throw (TournamentException, ResourcesException);
     virtual ~Tournament();
@@ -169,6 +196,10 @@ public:
     bool is_ready() const;
     void show_stats(bool state);
     void update_states(ns_t ns);
+    void replay_player(Player *p, ns_t ns);
+    void interpolate(double time);
+    void blend(double alpha);
+    void unblend();
 
     void add_animation(GAnimation *animation);
     void add_spawnable_npc(GSpawnNPC *npc);
@@ -197,6 +228,8 @@ public:
     virtual void player_added(Player *p);
     virtual void player_removed(Player *p);
     virtual void spawn_player(Player *p);
+    virtual bool spawn_player_at(Player *p, size_t index);
+    virtual bool spawn_allowed(Player *p);
     virtual void add_team_score(GTeamScore *ts);
     virtual void retrieve_states();
     virtual bool player_joins(Player *p, playerflags_t flags);
@@ -225,6 +258,7 @@ protected:
     static const ns_t ns_sec = 1000000000;
 
     Resources& resources;
+    StringTable& strings;
     Subsystem& subsystem;
     Properties& properties;
     Gui *gui;
@@ -233,6 +267,7 @@ protected:
     Tileset *tileset;
     short **map_array;
     short **decoration_array;
+    CollisionGrid collision_grid;
     Lightmap *lightmap;
     int map_width;
     int map_height;
@@ -288,6 +323,16 @@ protected:
     bool game_over;
     ServerLogger *logger;
     bool gui_is_destroyed;
+    bool interpolated;
+    double interpolation_time;
+    double simulation_time;
+    double tick_start_x;        /* client side, own player and view at */
+    double tick_start_y;        /* the start of the last tick, drawing */
+    double tick_start_view_x;   /* blends from there to its end        */
+    double tick_start_view_y;
+    bool blended;
+    double blend_saved_x;
+    double blend_saved_y;
 
     int tilex;
     int tiley;
@@ -298,6 +343,21 @@ protected:
     SpawnPoints spawn_points;
     FrogSpawnPoints frog_spawn_points;
     SpawnableNPCs spawnable_npcs;
+    EntityPool<GameAnimation> animation_pool;
+    EntityPool<GameObject> object_pool;
+    EntityPool<SpawnableNPC> npc_pool;
+
+    /* broadphase, rebuilt on demand when invalidated */
+    SpatialHash player_hash;
+    SpatialHash npc_hash;
+    SpatialHash object_hash;
+    bool player_hash_valid;
+    bool npc_hash_valid;
+    bool object_hash_valid;
+    SpatialHash::Handles hash_handles;
+
+    /* flying animations and objects of the current step */
+    PhysicsBatch physics_batch;
 
     bool has_frogs;
     double frog_respawn_counter;
@@ -312,9 +372,14 @@ protected:
     };
 
     void integrate(ns_t ns);
+    void set_view(double x, double y);
+    bool move_player(Player *p, double period_f, bool replay);
 
     bool collide_with_tile(TestType type, Player *p, int last_falling_y_pos,
-        double x, double y, double *friction, bool *killing);
+        int x, int y, double *friction, bool *killing);
+    bool sweep_tiles(TestType type, Player *p, int last_falling_y_pos,
+        double left, double top, double right, double bottom, int dir_x, int dir_y,
+        double distance, TileContact& contact, bool *killing);
 
     void add_state_response(int action, data_len_t len, const void *data);
     void add_msg_response(const char *msg);
@@ -333,6 +398,15 @@ protected:
         double friction_factor, bool play_bump, bool& falling,
         int& last_falling_y_pos, bool *killing, const std::string& weapon);
 
+    bool projectile_hit(int damage, double recoil, identifier_t owner,
+        const CollisionBox& colbox, double x, double y, double accel_x, int height,
+        const std::string& weapon);
+
+    void batch_animations(double period_f);
+    void batch_objects(double period_f);
+    void apply_free_move(size_t lane, double& x, double& y, double& accel_y,
+        int height, bool& falling, int& last_falling_y_pos);
+
     void play_ground_bump_sound();
     void check_attack(Player *p, const CollisionBox& colbox, bool move_up,
         bool move_down, Player *following_player);
@@ -345,12 +419,21 @@ protected:
         const std::string& start_sound, int yoffset, unsigned char direction,
         unsigned char *mun);
 
+    void query_players(const CollisionBox& box, SpatialHash::Candidates& candidates);
+    void query_npcs(const CollisionBox& box, SpatialHash::Candidates& candidates);
+    void query_objects(const CollisionBox& box, SpatialHash::Candidates& candidates);
+
+    void record_hitboxes();
+    double get_rewind(identifier_t owner) const;
+    void get_rewound_position(const Player *p, double rewind, double& x, double& y) const;
     void check_killing_animation(int x, int y, Animation *ani,
         identifier_t owner, bool preserve_npc, NPC *npc);
 
     void player_damage(identifier_t owner, Player *p, NPC *npc, int damage, const std::string& weapon);
 
     void spawn_player_base(Player *p, SpawnPoints& spawn_points);
+    bool spawn_player_at_base(Player *p, SpawnPoints& spawn_points, size_t index);
+    void get_spawn_position(Player *p, GameObject *obj, int& x, int& y);
 
     void control_spectator(Player *me, double period_f);
 
@@ -389,7 +472,7 @@ protected:
     virtual void draw_enemies_on_hud();
     virtual bool pick_item(Player *p, GameObject *obj);
     virtual bool tile_collision(TestType type, Player *p,
-        int last_falling_y_pos, Tile *t, bool *killing);
+        int last_falling_y_pos, Tile::TileType tt, bool *killing);
     virtual bool fire_enabled(Player *p);
     virtual void frag_point(Player *pfrag, Player *pkill) = 0;
     virtual void player_join_request(Player *p);
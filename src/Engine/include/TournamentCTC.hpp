@@ -5,8 +5,8 @@
 
 class TournamentCTC : public Tournament {
 public:
-    TournamentCTC(Resources& resources, Subsystem& subsystem, Gui *gui, ServerLogger *logger,
-        const std::string& game_file, bool server,
+    TournamentCTC(Resources& resources, StringTable& strings, Subsystem& subsystem, Gui *gui,
+        ServerLogger *logger, const std::string& game_file, bool server,
         const std::string& map_name, Players& players, int duration, bool warmup)
         throw (TournamentException, ResourcesException);
     virtual ~TournamentCTC();
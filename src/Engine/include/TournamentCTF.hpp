@@ -13,8 +13,8 @@
 
 class TournamentCTF : public TournamentTeam {
 public:
-    TournamentCTF(Resources& resources, Subsystem& subsystem, Gui *gui, ServerLogger *logger,
-        const std::string& game_file, bool server,
+    TournamentCTF(Resources& resources, StringTable& strings, Subsystem& subsystem, Gui *gui,
+        ServerLogger *logger, const std::string& game_file, bool server,
         const std::string& map_name, Players& players, int duration, bool warmup)
         throw (TournamentException, ResourcesException);
     virtual ~TournamentCTF();
@@ -33,7 +33,7 @@ private:
     virtual bool pick_item(Player *p, GameObject *obj);
 
     virtual bool tile_collision(TestType type, Player *p, int last_falling_y_pos,
-        Tile *t, bool *killing);
+        Tile::TileType tt, bool *killing);
 
     virtual bool fire_enabled(Player *p);
     virtual void player_removed(Player *p);
@@ -12,8 +12,8 @@
 
 class TournamentDM : public Tournament {
 public:
-    TournamentDM(Resources& resources, Subsystem& subsystem, Gui *gui, ServerLogger *logger,
-        const std::string& game_file, bool server,
+    TournamentDM(Resources& resources, StringTable& strings, Subsystem& subsystem, Gui *gui,
+        ServerLogger *logger, const std::string& game_file, bool server,
         const std::string& map_name, Players& players, int duration, bool warmup)
         throw (TournamentException, ResourcesException);
     virtual ~TournamentDM();
@@ -8,6 +8,7 @@
 #include "Gui.hpp"
 #include "ServerLogger.hpp"
 #include "Configuration.hpp"
+#include "StringTable.hpp"
 
 #include <string>
 
@@ -31,7 +32,7 @@ struct MapConfiguration {
 
 class TournamentFactory {
 public:
-    TournamentFactory(Resources& resources, Subsystem& subsystem, Gui *gui)
+    TournamentFactory(Resources& resources, StringTable& strings, Subsystem& subsystem, Gui *gui)
         throw (TournamentFactoryException);
     virtual ~TournamentFactory();
 
@@ -43,6 +44,7 @@ public:
 
 private:
     Resources& resources;
+    StringTable& strings;
     Subsystem& subsystem;
     Gui *gui;
     unsigned char tournament_id;
@@ -11,8 +11,8 @@
 
 class TournamentGOH : public TournamentTeam {
 public:
-    TournamentGOH(Resources& resources, Subsystem& subsystem, Gui *gui, ServerLogger *logger,
-        const std::string& game_file, bool server,
+    TournamentGOH(Resources& resources, StringTable& strings, Subsystem& subsystem, Gui *gui,
+        ServerLogger *logger, const std::string& game_file, bool server,
         const std::string& map_name, Players& players, int duration, bool warmup)
         throw (TournamentException, ResourcesException);
     virtual ~TournamentGOH();
@@ -5,14 +5,15 @@
 
 class TournamentSR : public Tournament {
 public:
-    TournamentSR(Resources& resources, Subsystem& subsystem, Gui *gui, ServerLogger *logger,
-        const std::string& game_file, bool server,
+    TournamentSR(Resources& resources, StringTable& strings, Subsystem& subsystem, Gui *gui,
+        ServerLogger *logger, const std::string& game_file, bool server,
         const std::string& map_name, Players& players, int duration, bool warmup)
         throw (TournamentException, ResourcesException);
     virtual ~TournamentSR();
 
     virtual const char *tournament_type();
     virtual void write_stats_in_server_log();
+    virtual bool spawn_allowed(Player *p);
 
 private:
     typedef std::vector<float> Times;
@@ -21,7 +22,7 @@ private:
     struct TimesOfPlayer {
         TimesOfPlayer(Player *player)
             : player(player), best(-1.0f), last(-1.0f),
-              running(false), finished(false)
+              running(false), finished(false), returning(false)
         {
             get_now(start_time);
         }
@@ -31,6 +32,7 @@ private:
         float last;
         bool running;
         bool finished;
+        bool returning;     /* server side, reached the finish */
 
         gametime_t start_time;
         Times times;
@@ -58,7 +60,7 @@ private:
 
     virtual void frag_point(Player *pfrag, Player *pkill);
     virtual bool tile_collision(TestType type, Player *p, int last_falling_y_pos,
-        Tile *t, bool *killing);
+        Tile::TileType tt, bool *killing);
 
     virtual void player_added(Player *p);
     virtual void player_removed(Player *p);
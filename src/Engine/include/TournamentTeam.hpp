@@ -14,8 +14,8 @@
 
 class TournamentTeam : public Tournament {
 public:
-    TournamentTeam(Resources& resources, Subsystem& subsystem, Gui *gui, ServerLogger *logger,
-        const std::string& game_file, bool server,
+    TournamentTeam(Resources& resources, StringTable& strings, Subsystem& subsystem, Gui *gui,
+        ServerLogger *logger, const std::string& game_file, bool server,
         const std::string& map_name, Players& players, int duration, bool warmup)
         throw (TournamentException, ResourcesException);
     virtual ~TournamentTeam();
@@ -45,6 +45,7 @@ protected:
     virtual void draw_team_colours();
     virtual void draw_statistics();
     virtual void spawn_player(Player *p);
+    virtual bool spawn_player_at(Player *p, size_t index);
     virtual void retrieve_states();
     virtual void add_team_score(GTeamScore *ts);
     virtual void frag_point(Player *pfrag, Player *pkill);
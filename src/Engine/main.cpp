@@ -47,7 +47,7 @@ int main(int argc, char *argv[]) {
         Resources resources(subsystem, STRINGIZE_VALUE_OF(DATA_DIRECTORY));
 #endif
         Game game(resources, subsystem);
-        game.run(argc > 1 ? argv[1] : "");
+        game.run(Game::Parameters(argv + 1, argv + argc));
     } catch (const Exception& e) {
         stream << e.what() << std::endl;
     }
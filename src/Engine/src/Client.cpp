@@ -3,13 +3,16 @@
 
 #include <iostream>
 #include <algorithm>
+#include <cmath>
 
 static double TextMessageDuration = 7500.0f;
 static double TextMessageFadeOutAt = 6000.0f;
 
-const ns_t CycleS = 1000000000;
-const int BroadcastsPerS = 15; //20;
-const ns_t UpdatePeriod = CycleS / BroadcastsPerS;
+const int TicksPerS = 60;
+const int MaxCatchUpTicks = 5;
+const double ServerClockSmoothing = 0.05f;
+const double ServerClockMaxError = 250000000.0f;   /* ns */
+const ns_t NetIdleWaitNS = 5000000; /* reliable pushes of the game thread wait at most that long */
 
 template <class T> static bool erase_element(T *elem) {
     if (elem->delete_me) {
@@ -27,27 +30,44 @@ Client::Client(Resources& resources, Subsystem& subsystem, hostaddr_t host,
       Gui(resources, subsystem, resources.get_font("normal")),
       OptionsMenu(*this, resources, subsystem, config, true),
       resources(resources), subsystem(subsystem), player_config(config),
-      logged_in(false), me(0), updatecnt(0),
-      factory(resources, subsystem, this), my_id(0), login_sent(false),
-      throw_exception(false), exception_msg(), force_send(false),
-      fhnd(0), running(true), reload_resources(true)
+      logged_in(false), me(0),
+      strings(resources), factory(resources, strings, subsystem, this), my_id(0), login_sent(false),
+      throw_exception(false), exception_msg(),
+      fhnd(0), running(true), reload_resources(true),
+      tick_scheduler(TicksPerS, MaxCatchUpTicks), snapshot_applied(false),
+      snapshot_applied_no(0), snapshot_acked(false), snapshot_ack_no(0),
+      snapshot_ack_pending(false), server_clock_valid(false), server_clock_offset(0.0f),
+      interpolation_delay(0.0f)
 {
     conn = 0;
     get_now(last);
+    clock_origin = last;
 
     /* start data receiver thread */
     if (!thread_start()) {
         throw ClientException("Starting client thread failed.");
     }
 
+    /* the server rewinds our shots by the same delay */
+    int delay = config.get_int("interpolation_delay");
+    if (delay < 0) {
+        delay = 0;
+    } else if (delay > MaxInterpolationDelay) {
+        delay = MaxInterpolationDelay;
+    }
+    interpolation_delay = delay * 1000000.0f;
+
     /* login */
     memset(gplayerdesc, 0, sizeof(GPlayerDescription));
     strncpy(gplayerdesc->player_name, player_config.get_player_name().c_str(), NameLength - 1);
     strncpy(gplayerdesc->characterset_name, player_config.get_player_skin().c_str(), NameLength - 1);
+    gplayerdesc->interpolation_delay = static_cast<uint16_t>(delay);
+    gplayerdesc->to_net();
     {
         ScopeMutex lock(mtx);
         login(password, GPlayerDescriptionLen, gplayerdesc);
     }
+    reactor.wake();
     binding.extract_from_config(player_config);
 }
 
@@ -86,6 +106,11 @@ Client::~Client() {
     if (current_download_filename.length()) {
         remove(current_download_filename.c_str());
     }
+
+    /* simulation costs of this session */
+    if (tick_scheduler.get_statistics().ticks) {
+        subsystem << "tick statistics: " << tick_scheduler.get_statistics().to_string() << std::endl;
+    }
 }
 
 void Client::idle() throw (Exception) {
@@ -148,6 +173,18 @@ void Client::idle() throw (Exception) {
         throw ClientException(exception_msg);
     }
 
+    /* acknowledge the newest complete snapshot (unreliable) */
+    if (snapshot_ack_pending && conn) {
+        GSnapshotAck ack;
+        ack.snapshot_no = snapshot_ack_no;
+        ack.to_net();
+        {
+            ScopeMutex lock(mtx);
+            send_data(conn, factory.get_tournament_id(), GPSSnapshotAck, 0, GSnapshotAckLen, &ack);
+        }
+        snapshot_ack_pending = false;
+    }
+
     /* interpolate movements */
     get_now(now);
     ns_t diff = diff_ns(last, now);
@@ -155,7 +192,22 @@ void Client::idle() throw (Exception) {
     last = now;
 
     if (tournament) {
-        tournament->update_states(diff);
+        /* fixed ticks, like the server */
+        bool input_recorded = false;
+        while (tick_scheduler.next_tick()) {
+            tournament->update_states(tick_scheduler.get_tick_ns());
+            if (me && tournament->is_ready()) {
+                record_input();
+                input_recorded = true;
+            }
+            tick_scheduler.tick_done();
+        }
+
+        /* remote entities are shown a little in the past */
+        if (server_clock_valid) {
+            tournament->interpolate(get_server_clock() - interpolation_delay);
+        }
+
         if (conn) {
             tournament->set_ping_time(conn->ping_time);
             Tournament::StateResponses& responses = tournament->get_state_responses();
@@ -166,32 +218,24 @@ void Client::idle() throw (Exception) {
                     StateResponse *resp = responses[i];
                     stacked_send_data(conn, factory.get_tournament_id(), resp->action, 0, resp->len, resp->data);
                 }
-                flush_stacked_send_data(conn, 0);
+                flush_stacked_send_data(conn);
+            }
+            if (sz) {
+                reactor.wake();
             }
-        }
-        tournament->delete_responses();
 
-        /* send player position (unreliable) */
-        updatecnt += diff;
-        bool player_force = false;
-        if (me && me->force_broadcast) {
-            player_force = true;
-            me->force_broadcast = false;
-            me->state.client_server_state.flags |= PlayerClientServerFlagForceBroadcast;
-        }
-        if (updatecnt >= UpdatePeriod || force_send || player_force) {
-            updatecnt = 0;
-            if (conn && me && tournament->is_ready()) {
-                GPlayerClientServerState state;
-                state = me->state.client_server_state;
-                state.to_net();
+            /* send own inputs, the unacknowledged ones again (unreliable) */
+            if (input_recorded) {
+                GPlayerInput newest[PlayerInputsPerPacket];
+                size_t n = inputs.get_newest(newest, PlayerInputsPerPacket);
                 {
                     ScopeMutex lock(mtx);
-                    send_data(conn, factory.get_tournament_id(), GPSUpdatePlayerClientServerState, 0, GPlayerClientServerStateLen, &state);
+                    send_data(conn, factory.get_tournament_id(), GPSPlayerInput, 0,
+                        static_cast<data_len_t>(n * GPlayerInputLen), newest);
                 }
-                me->state.client_server_state.flags &= ~PlayerClientServerFlagForceBroadcast;
             }
         }
+        tournament->delete_responses();
     }
 
     /* interpolate messages */
@@ -217,9 +261,15 @@ void Client::idle() throw (Exception) {
         }
     }
 
-    /* draw map */
+    /* draw map, the own player and the view between the last two ticks */
     if (tournament) {
+        gametime_t draw_time;
+        get_now(draw_time);
+        tournament->blend(tick_scheduler.get_tick_fraction(draw_time));
         tournament->draw();
+        tournament->unblend();
+    } else {
+        tick_scheduler.reset(now);
     }
 
     /* draw messages */
@@ -253,6 +303,39 @@ void Client::idle() throw (Exception) {
     }
 }
 
+void Client::record_input() {
+    GPlayerInput input;
+    input.key_states = me->state.client_server_state.key_states;
+    input.jaxis = me->state.client_server_state.jaxis;
+    input.flags = me->state.client_server_state.flags & PlayerClientServerFlagWriting;
+    input.spawn_no = me->spawn_no;
+    input.spawn_index = me->spawn_index;
+    inputs.add(input, me->state.client_server_state.x, me->state.client_server_state.y);
+}
+
+double Client::get_local_clock() const {
+    gametime_t t;
+    get_now(t);
+
+    return static_cast<double>(t.tv_sec - clock_origin.tv_sec) * 1000000000.0f +
+        static_cast<double>(t.tv_nsec - clock_origin.tv_nsec);
+}
+
+double Client::get_server_clock() const {
+    return get_local_clock() + server_clock_offset;
+}
+
+void Client::sync_server_clock(uint32_t server_time) {
+    /* the snapshots arrive with jitter, follow them smoothly */
+    double offset = server_time * 1000000.0f - get_local_clock();
+    if (!server_clock_valid || std::fabs(offset - server_clock_offset) > ServerClockMaxError) {
+        server_clock_offset = offset;
+        server_clock_valid = true;
+    } else {
+        server_clock_offset += (offset - server_clock_offset) * ServerClockSmoothing;
+    }
+}
+
 void Client::set_key(MappedKey::Device dev, int param) {
     set_key(dev, param, binding.left, PlayerKeyStateLeft);
     set_key(dev, param, binding.right, PlayerKeyStateRight);
@@ -303,7 +386,6 @@ void Client::set_key(MappedKey::Device dev, int param, MappedKey& key, int flag)
     if (key.device == dev && key.param == param) {
         if (me) {
             me->state.client_server_state.key_states |= flag;
-            force_send = true;
         }
     }
 }
@@ -332,7 +414,6 @@ void Client::reset_key(MappedKey::Device dev, int param, MappedKey& key, int fla
     if (key.device == dev && key.param == param) {
         if (me) {
             me->state.client_server_state.key_states &= ~flag;
-            force_send = true;
         }
     }
 }
@@ -480,13 +561,23 @@ void Client::show_options_menu() {
 }
 
 void Client::thread() {
+    try {
+        watch(reactor);
+    } catch (const Exception&) {
+        /* fall back to polling */
+    }
+
     /* net loop */
     while (running) {
         {
             ScopeMutex lock(mtx);
             while(cycle());
         }
-        wait_ns(1000000);
+        try {
+            reactor.wait(NetIdleWaitNS);
+        } catch (const Exception&) {
+            wait_ns(1000000);
+        }
     }
 
     /* gracefully logout */
@@ -495,9 +586,11 @@ void Client::thread() {
         logout();
         while(cycle());
     }
+    unwatch(reactor);
 }
 
 void Client::stop_thread() {
     running = false;
+    reactor.wake();
     thread_join();
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "Client.hpp"
 
 #include <cerrno>
+#include <cmath>
 
 void Client::event_status(hostaddr_t host, hostport_t port, const std::string& name,
     int max_clients, int cur_clients, ms_t ping_time, bool secured,
@@ -99,7 +100,7 @@ void Client::sevt_login(ServerEvent& evt) {
         stacked_send_data(evt.c, 0, GPSPakSyncHash, NetFlagsReliable, GPakHashLen, &gph);
     }
     stacked_send_data(evt.c, 0, GPSPakSyncHashFinished, NetFlagsReliable, 0, 0);
-    flush_stacked_send_data(evt.c, 0);
+    flush_stacked_send_data(evt.c);
 }
 
 void Client::sevt_data(ServerEvent& evt) {
@@ -166,6 +167,7 @@ void Client::sevt_data(ServerEvent& evt) {
                 if (reload_resources) {
                     resources.reload_resources();
                     load_resources();
+                    strings.resolve();
                     reload_resources = false;
                 }
 
@@ -178,6 +180,7 @@ void Client::sevt_data(ServerEvent& evt) {
                 tournament->set_following_id(my_id);
                 tournament->set_player_configuration(&player_config);
                 tournament->set_team_names(team_red_name, team_blue_name);
+                inputs.clear();
 
                 /* reopen, if join request window is already open */
                 if (me && me->joining) {
@@ -187,6 +190,17 @@ void Client::sevt_data(ServerEvent& evt) {
                 break;
             }
 
+            case GPCStringTable:
+            {
+                GStringTableEntry *entry = reinterpret_cast<GStringTableEntry *>(t->data);
+                entry->from_net();
+                if (entry->kind < _StringTableMAX) {
+                    entry->name[NameLength - 1] = 0;
+                    strings.add(static_cast<StringTableKind>(entry->kind), entry->id, entry->name);
+                }
+                break;
+            }
+
             case GPCIdentifyPlayer:
             {
                 player_id_t *nid = reinterpret_cast<player_id_t *>(t->data);
@@ -246,6 +260,7 @@ void Client::sevt_data(ServerEvent& evt) {
                         p->state.server_state = info->server_state;
                         p->state.client_server_state = info->client_server_state;
                         p->state.client_state = info->client_state;
+                        p->motion.clear();
                         if (tournament) {
                             tournament->reset_player(p);
                         }
@@ -293,6 +308,7 @@ void Client::sevt_data(ServerEvent& evt) {
                             p->state.server_state = state->server_state;
                         } else {
                             p->state = *state;
+                            p->motion.clear();
                         }
                         p->respawning = false;
                         if (tournament) {
@@ -321,81 +337,54 @@ void Client::sevt_data(ServerEvent& evt) {
                 if (t->tournament_id== factory.get_tournament_id()) {
                     GPTAllStates *state = reinterpret_cast<GPTAllStates *>(t->data);
                     state->from_net();
-
-                    for (Players::iterator it = players.begin();
-                        it != players.end(); it++)
-                    {
-                        Player *p = *it;
-                        if (p->state.id == state->id) {
-                            p->state.server_state = state->server_state;
-                            if (p != me) {
-                                p->state.client_server_state = state->client_server_state;
-                            }
-                            break;
-                        }
-                    }
+                    update_player_state(*state, get_server_clock());
                 }
                 break;
             }
 
             case GPCUpdateObject:
             {
-                if (tournament) {
-                    if (t->tournament_id == factory.get_tournament_id()) {
-                        GObjectState *state = reinterpret_cast<GObjectState *>(t->data);
-                        state->from_net();
-                        Tournament::GameObjects& objects = tournament->get_game_objects();
-                        for (Tournament::GameObjects::iterator it = objects.begin();
-                            it != objects.end(); it++)
-                        {
-                            GameObject *obj = *it;
-                            if (obj->state.id == state->id) {
-                                obj->state = *state;
-                                break;
-                            }
-                        }
-                    }
+                if (t->tournament_id == factory.get_tournament_id()) {
+                    GObjectState *state = reinterpret_cast<GObjectState *>(t->data);
+                    state->from_net();
+                    update_object_state(*state, get_server_clock());
                 }
                 break;
             }
 
             case GPCUpdateAnimation:
             {
-                if (tournament) {
-                    if (t->tournament_id == factory.get_tournament_id()) {
-                        GAnimationState *state = reinterpret_cast<GAnimationState *>(t->data);
-                        state->from_net();
-                        Tournament::GameAnimations& animations = tournament->get_game_animations();
-                        for (Tournament::GameAnimations::iterator it = animations.begin();
-                            it != animations.end(); it++)
-                        {
-                            GameAnimation *ani = *it;
-                            if (ani->state.id == state->id) {
-                                ani->state = *state;
-                                break;
-                            }
-                        }
-                    }
+                if (t->tournament_id == factory.get_tournament_id()) {
+                    GAnimationState *state = reinterpret_cast<GAnimationState *>(t->data);
+                    state->from_net();
+                    update_animation_state(*state);
                 }
                 break;
             }
 
             case GPCUpdateSpawnableNPC:
             {
-                if (tournament) {
+                if (t->tournament_id == factory.get_tournament_id()) {
+                    GNPCState *state = reinterpret_cast<GNPCState *>(t->data);
+                    state->from_net();
+                    update_npc_state(*state, get_server_clock());
+                }
+                break;
+            }
+
+            case GPCSnapshot:
+            {
+                sevt_snapshot(t);
+                break;
+            }
+
+            case GPCPlayerInputAck:
+            {
+                if (tournament && me) {
                     if (t->tournament_id == factory.get_tournament_id()) {
-                        GNPCState *state = reinterpret_cast<GNPCState *>(t->data);
-                        state->from_net();
-                        Tournament::SpawnableNPCs& spawnable_npcs = tournament->get_spawnable_npcs();
-                        for (Tournament::SpawnableNPCs::iterator it = spawnable_npcs.begin();
-                            it != spawnable_npcs.end(); it++)
-                        {
-                            SpawnableNPC *npc = *it;
-                            if (npc->state.id == state->id) {
-                                npc->state = *state;
-                                break;
-                            }
-                        }
+                        GPlayerInputAck *ack = reinterpret_cast<GPlayerInputAck *>(t->data);
+                        ack->from_net();
+                        reconcile(*ack);
                     }
                 }
                 break;
@@ -754,4 +743,234 @@ void Client::sevt_data(ServerEvent& evt) {
             break;
         }
     }
-}
\ No newline at end of file
+}
+void Client::sevt_snapshot(GTransport *t) {
+    if (t->len < GSnapshotLen) {
+        return;
+    }
+    GSnapshot *gs = reinterpret_cast<GSnapshot *>(t->data);
+    gs->from_net();
+
+    /* a delta is only usable, if we still have its baseline */
+    const Snapshot *baseline = 0;
+    if (gs->flags & SnapshotFlagDelta) {
+        baseline = snapshots.get_complete(gs->baseline_no);
+        if (!baseline) {
+            return;
+        }
+    }
+
+    Snapshot& snapshot = snapshots.slot(gs->snapshot_no);
+    if (!snapshot.is_valid(gs->snapshot_no)) {
+        snapshot.start(gs->snapshot_no, gs->parts);
+    }
+    if (snapshot.is_complete() || !snapshot.add_part(gs->part)) {
+        return;
+    }
+
+    /* never step back to an older state */
+    bool apply = (t->tournament_id == factory.get_tournament_id() &&
+        (!snapshot_applied || !snapshot_newer(snapshot_applied_no, gs->snapshot_no)));
+    double time = gs->server_time * 1000000.0f;
+    if (apply) {
+        sync_server_clock(gs->server_time);
+    }
+
+    const data_t *p = gs->data;
+    size_t len = t->len - GSnapshotLen;
+    SnapshotRecord rec;
+    bool removed;
+    while (len) {
+        size_t sz = Snapshot::decode(p, len, baseline, rec, removed);
+        if (!sz) {
+            snapshot.reset();
+            return;
+        }
+        if (removed) {
+            snapshot.remove(rec.kind, rec.id);
+        } else {
+            snapshot.add(rec);
+            if (apply) {
+                update_snapshot_record(rec, time);
+            }
+        }
+        p += sz;
+        len -= sz;
+    }
+
+    if (apply) {
+        snapshot_applied = true;
+        snapshot_applied_no = gs->snapshot_no;
+    }
+
+    /* complete, becomes a baseline as soon as the server knows */
+    if (snapshot.has_all_parts()) {
+        snapshot.finish(baseline);
+        if (!snapshot_acked || snapshot_newer(gs->snapshot_no, snapshot_ack_no)) {
+            snapshot_acked = true;
+            snapshot_ack_no = gs->snapshot_no;
+            snapshot_ack_pending = true;
+        }
+    }
+}
+
+void Client::update_snapshot_record(const SnapshotRecord& rec, double time) {
+    switch (rec.kind) {
+        case SnapshotKindPlayer:
+        {
+            GPTAllStates state;
+            memcpy(&state, rec.data, GPTAllStatesLen);
+            state.from_net();
+            update_player_state(state, time);
+            break;
+        }
+
+        case SnapshotKindObject:
+        {
+            GObjectState state;
+            memcpy(&state, rec.data, GObjectStateLen);
+            state.from_net();
+            update_object_state(state, time);
+            break;
+        }
+
+        case SnapshotKindAnimation:
+        {
+            GAnimationState state;
+            memcpy(&state, rec.data, GAnimationStateLen);
+            state.from_net();
+            update_animation_state(state);
+            break;
+        }
+
+        case SnapshotKindNPC:
+        {
+            GNPCState state;
+            memcpy(&state, rec.data, GNPCStateLen);
+            state.from_net();
+            update_npc_state(state, time);
+            break;
+        }
+    }
+}
+
+void Client::update_player_state(const GPTAllStates& state, double time) {
+    for (Players::iterator it = players.begin(); it != players.end(); it++) {
+        Player *p = *it;
+        if (p->state.id == state.id) {
+            p->state.server_state = state.server_state;
+            if (p != me) {
+                /* the position follows by interpolation */
+                GPlayerClientServerState& cs = p->state.client_server_state;
+                double x = cs.x;
+                double y = cs.y;
+                state.client_server_state.unpack(cs);
+                if (server_clock_valid) {
+                    p->motion.add(time, cs.x, cs.y, cs.accel_x, cs.accel_y + cs.jump_accel_y);
+                    cs.x = x;
+                    cs.y = y;
+                }
+            }
+            break;
+        }
+    }
+}
+
+void Client::update_object_state(const GObjectState& state, double time) {
+    if (tournament) {
+        Tournament::GameObjects& objects = tournament->get_game_objects();
+        for (Tournament::GameObjects::iterator it = objects.begin(); it != objects.end(); it++) {
+            GameObject *obj = *it;
+            if (obj->state.id == state.id) {
+                if (server_clock_valid && obj->object->get_physics()) {
+                    obj->motion.add(time, state.x, state.y, state.accel_x, state.accel_y);
+                } else {
+                    obj->state = state;
+                }
+                break;
+            }
+        }
+    }
+}
+
+void Client::update_animation_state(const GAnimationState& state) {
+    if (tournament) {
+        Tournament::GameAnimations& animations = tournament->get_game_animations();
+        for (Tournament::GameAnimations::iterator it = animations.begin(); it != animations.end(); it++) {
+            GameAnimation *ani = *it;
+            if (ani->state.id == state.id) {
+                ani->state = state;
+                break;
+            }
+        }
+    }
+}
+
+void Client::update_npc_state(const GNPCState& state, double time) {
+    if (tournament) {
+        Tournament::SpawnableNPCs& spawnable_npcs = tournament->get_spawnable_npcs();
+        for (Tournament::SpawnableNPCs::iterator it = spawnable_npcs.begin(); it != spawnable_npcs.end(); it++) {
+            SpawnableNPC *npc = *it;
+            if (npc->state.id == state.id) {
+                double x = npc->state.x;
+                double y = npc->state.y;
+                npc->state = state;
+                if (server_clock_valid) {
+                    npc->motion.add(time, state.x, state.y, state.accel_x, state.accel_y);
+                    npc->state.x = x;
+                    npc->state.y = y;
+                }
+                break;
+            }
+        }
+    }
+}
+
+void Client::reconcile(const GPlayerInputAck& ack) {
+    PredictedInput acked;
+    if (!inputs.acknowledge(ack.input_no, acked)) {
+        return;
+    }
+
+    /* predicted right? */
+    const GPlayerClientServerState& server_state = ack.client_server_state;
+    if (std::fabs(acked.x - server_state.x) <= PredictionTolerance &&
+        std::fabs(acked.y - server_state.y) <= PredictionTolerance)
+    {
+        return;
+    }
+
+    /* no, continue from the server state and replay all inputs */
+    /* the server has not run yet, spawns in between included    */
+    GPlayerClientServerState& state = me->state.client_server_state;
+    keystates_t key_states = state.key_states;
+    joyaxis_t jaxis = state.jaxis;
+
+    state.x = server_state.x;
+    state.y = server_state.y;
+    state.accel_x = server_state.accel_x;
+    state.accel_y = server_state.accel_y;
+    state.jump_accel_y = server_state.jump_accel_y;
+    const playerflags_t flags = PlayerClientFlagFalling | PlayerClientFlagJumpReleased;
+    me->state.client_state.flags = (me->state.client_state.flags & ~flags) | (ack.client_flags & flags);
+    me->last_falling_y_pos = ack.last_falling_y_pos;
+
+    unsigned char spawn_no = acked.input.spawn_no;
+    ns_t tick_ns = tick_scheduler.get_tick_ns();
+    size_t sz = inputs.get_count();
+    for (size_t i = 0; i < sz; i++) {
+        PredictedInput& predicted = inputs.get(i);
+        state.key_states = predicted.input.key_states;
+        state.jaxis = predicted.input.jaxis;
+        tournament->replay_player(me, tick_ns);
+        if (predicted.input.spawn_no != spawn_no) {
+            spawn_no = predicted.input.spawn_no;
+            tournament->spawn_player_at(me, predicted.input.spawn_index);
+        }
+        predicted.x = state.x;
+        predicted.y = state.y;
+    }
+
+    state.key_states = key_states;
+    state.jaxis = jaxis;
+}
@@ -1,17 +1,15 @@
 #include "ClientServer.hpp"
 
-#include <cassert>
-
 ClientServer::ClientServer(hostport_t port, pico_size_t num_players,
-    const std::string& server_name, const std::string& password)
-    : MessageSequencer(port, num_players, server_name, password), tournament(0),
+    const std::string& server_name, const std::string& password, size_t num_receivers)
+    : MessageSequencer(port, num_players, server_name, password, num_receivers), tournament(0),
       gtrans(reinterpret_cast<GTransport *>(buffer)),
       ggamestat(reinterpret_cast<GGameState *>(gtrans->data)),
       gplayerstat(reinterpret_cast<GPlayerState *>(gtrans->data)),
       gplayerinfo(reinterpret_cast<GPlayerInfo *>(gtrans->data)),
       gplayerdesc(reinterpret_cast<GPlayerDescription *>(gtrans->data)),
       gplaceobject(reinterpret_cast<GPlaceObject *>(gtrans->data)),
-      pb(gtrans), packet_len(0), port(port) { }
+      port(port), packet_size(PacketMaxSize) { }
 
 ClientServer::ClientServer(hostaddr_t host, hostport_t port)
     : MessageSequencer(host, port), tournament(0),
@@ -21,71 +19,76 @@ ClientServer::ClientServer(hostaddr_t host, hostport_t port)
       gplayerinfo(reinterpret_cast<GPlayerInfo *>(gtrans->data)),
       gplayerdesc(reinterpret_cast<GPlayerDescription *>(gtrans->data)),
       gplaceobject(reinterpret_cast<GPlaceObject *>(gtrans->data)),
-      pb(gtrans), packet_len(0), port(port) { }
+      port(port), packet_size(PacketMaxSize) { }
 
 ClientServer::~ClientServer() {
     if (tournament) {
         tournament->set_gui_is_destroyed(true);
         delete tournament;
     }
-}
 
-void ClientServer::stacked_send_data(const Connection *c, unsigned char tournament_id, command_t cmd,
-    flags_t flags, data_len_t len, const void *data) throw (Exception)
-{
-    int sz = packet_len + GTransportLen + len;
-    if (sz > PacketMaxSize) {
-        flush_stacked_send_data(c, flags);
+    for (Outgoing::iterator it = outgoing.begin(); it != outgoing.end(); it++) {
+        delete it->second;
     }
-    stack_data(tournament_id, cmd, len, data);
 }
 
-void ClientServer::stacked_broadcast_data(unsigned char tournament_id, command_t cmd, flags_t flags,
-    data_len_t len, const void *data) throw (Exception)
+void ClientServer::stacked_send_data(const Connection *c, unsigned char tournament_id, command_t cmd,
+    flags_t flags, data_len_t len, const void *data) throw (Exception)
 {
-    int sz = packet_len + GTransportLen + len;
-    if (sz > PacketMaxSize) {
-        flush_stacked_broadcast_data(flags);
+    if (c) {
+        OutgoingPackets *op = get_outgoing(c);
+        bool reliable = ((flags & NetFlagsReliable) != 0);
+        PacketBuilder& builder = (reliable ? op->reliable : op->unreliable);
+        if (reliable) {
+            /* keep the order on the reliable channel */
+            flush_synced_packet(outgoing_synced.reliable, NetFlagsReliable);
+        }
+        if (!builder.fits(len)) {
+            flush_packet(c, builder, (reliable ? NetFlagsReliable : 0));
+        }
+        builder.append(tournament_id, cmd, len, data);
     }
-    stack_data(tournament_id, cmd, len, data);
 }
 
 void ClientServer::stacked_broadcast_data_synced(unsigned char tournament_id, command_t cmd, flags_t flags,
     data_len_t len, const void *data) throw (Exception)
 {
-    int sz = packet_len + GTransportLen + len;
-    if (sz > PacketMaxSize) {
-        flush_stacked_broadcast_data_synced(flags);
+    bool reliable = ((flags & NetFlagsReliable) != 0);
+    PacketBuilder& builder = (reliable ? outgoing_synced.reliable : outgoing_synced.unreliable);
+    if (reliable) {
+        /* keep the order on the reliable channel */
+        for (Outgoing::iterator it = outgoing.begin(); it != outgoing.end(); it++) {
+            flush_packet(it->first, it->second->reliable, NetFlagsReliable);
+        }
+    }
+    if (!builder.fits(len)) {
+        flush_synced_packet(builder, (reliable ? NetFlagsReliable : 0));
     }
-    stack_data(tournament_id, cmd, len, data);
+    builder.append(tournament_id, cmd, len, data);
 }
 
-void ClientServer::flush_stacked_send_data(const Connection *c, flags_t flags) throw (Exception) {
-    if (packet_len) {
-        push(c, flags, packet_len, gtrans);
-        pb = gtrans;
-        packet_len = 0;
+void ClientServer::flush_stacked_send_data(const Connection *c) throw (Exception) {
+    Outgoing::iterator it = outgoing.find(c);
+    if (it != outgoing.end()) {
+        flush_packet(c, it->second->reliable, NetFlagsReliable);
+        flush_packet(c, it->second->unreliable, 0);
     }
 }
 
-void ClientServer::flush_stacked_broadcast_data(flags_t flags) throw (Exception) {
-    if (packet_len) {
-        broadcast(flags, packet_len, gtrans);
-        pb = gtrans;
-        packet_len = 0;
+void ClientServer::flush_stacked_data() throw (Exception) {
+    flush_synced_packet(outgoing_synced.reliable, NetFlagsReliable);
+    flush_synced_packet(outgoing_synced.unreliable, 0);
+    for (Outgoing::iterator it = outgoing.begin(); it != outgoing.end(); it++) {
+        flush_packet(it->first, it->second->reliable, NetFlagsReliable);
+        flush_packet(it->first, it->second->unreliable, 0);
     }
 }
 
-void ClientServer::flush_stacked_broadcast_data_synced(flags_t flags) throw (Exception) {
-    if (packet_len) {
-        for (Players::iterator it = players.begin(); it != players.end(); it++) {
-            Player *p = *it;
-            if (p->client_synced) {
-                push(p->get_connection(), flags, packet_len, gtrans);
-            }
-        }
-        pb = gtrans;
-        packet_len = 0;
+void ClientServer::discard_stacked_data(const Connection *c) {
+    Outgoing::iterator it = outgoing.find(c);
+    if (it != outgoing.end()) {
+        delete it->second;
+        outgoing.erase(it);
     }
 }
 
@@ -93,6 +96,10 @@ void ClientServer::send_data(const Connection *c, unsigned char tournament_id,
     command_t cmd, flags_t flags, data_len_t len, const void *data) throw (Exception)
 {
     if (c) {
+        /* keep the order on the reliable channel */
+        if (flags & NetFlagsReliable) {
+            flush_reliable(c);
+        }
         gtrans->cmd = cmd;
         gtrans->tournament_id = tournament_id;
         gtrans->flags = 0;
@@ -108,6 +115,9 @@ void ClientServer::send_data(const Connection *c, unsigned char tournament_id,
 void ClientServer::broadcast_data(unsigned char tournament_id, command_t cmd,
     flags_t flags, data_len_t len, const void *data) throw (Exception)
 {
+    if (flags & NetFlagsReliable) {
+        flush_all_reliable();
+    }
     gtrans->cmd = cmd;
     gtrans->tournament_id = tournament_id;
     gtrans->flags = 0;
@@ -122,6 +132,9 @@ void ClientServer::broadcast_data(unsigned char tournament_id, command_t cmd,
 void ClientServer::broadcast_data_synced(unsigned char tournament_id, command_t cmd,
     flags_t flags, data_len_t len, const void *data) throw (Exception)
 {
+    if (flags & NetFlagsReliable) {
+        flush_all_reliable();
+    }
     gtrans->cmd = cmd;
     gtrans->tournament_id = tournament_id;
     gtrans->flags = 0;
@@ -130,34 +143,90 @@ void ClientServer::broadcast_data_synced(unsigned char tournament_id, command_t
         memcpy(gtrans->data, data, len);
     }
     gtrans->to_net();
-    for (Players::iterator it = players.begin(); it != players.end(); it++) {
-        Player *p = *it;
-        if (p->client_synced) {
-            push(p->get_connection(), flags, GTransportLen + len, gtrans);
-        }
-    }
+    push_synced(flags, GTransportLen + len, gtrans);
 }
 
 hostport_t ClientServer::get_port() const {
     return port;
 }
 
-void ClientServer::stack_data(unsigned char tournament_id, command_t cmd, data_len_t len, const void *data) {
-    if (packet_len) {
-        pb->flags |= TransportFlagMorePackets;
-        unsigned char *tpb = reinterpret_cast<unsigned char *>(pb);
-        tpb += GTransportLen;
-        tpb += ntohs(pb->len);
-        pb = reinterpret_cast<GTransport *>(tpb);
+void ClientServer::set_packet_size(int size) {
+    if (size < PacketMaxSize) {
+        size = PacketMaxSize;
+    } else if (size > PacketSizeLimit) {
+        size = PacketSizeLimit;
+    }
+    packet_size = size;
+
+    outgoing_synced.reliable.set_max_size(size);
+    outgoing_synced.unreliable.set_max_size(size);
+    for (Outgoing::iterator it = outgoing.begin(); it != outgoing.end(); it++) {
+        it->second->reliable.set_max_size(size);
+        it->second->unreliable.set_max_size(size);
+    }
+}
+
+int ClientServer::get_packet_size() const {
+    return packet_size;
+}
+
+ClientServer::OutgoingPackets *ClientServer::get_outgoing(const Connection *c) {
+    Outgoing::iterator it = outgoing.find(c);
+    if (it != outgoing.end()) {
+        return it->second;
     }
 
-    pb->cmd = cmd;
-    pb->tournament_id = tournament_id;
-    pb->flags = 0;
-    pb->len = len;
-    assert(data != pb->data && "Source and destination buffer must not be the same in stacked sending");
-    memcpy(pb->data, data, len);
-    pb->to_net();
+    OutgoingPackets *op = new OutgoingPackets;
+    op->reliable.set_max_size(packet_size);
+    op->unreliable.set_max_size(packet_size);
+    outgoing[c] = op;
+
+    return op;
+}
+
+void ClientServer::flush_packet(const Connection *c, PacketBuilder& builder, flags_t flags) throw (Exception) {
+    if (!builder.is_empty()) {
+        data_len_t sz = builder.get_size();
+        builder.clear();
+        push(c, flags, sz, builder.get_data());
+    }
+}
+
+void ClientServer::flush_synced_packet(PacketBuilder& builder, flags_t flags) throw (Exception) {
+    if (!builder.is_empty()) {
+        data_len_t sz = builder.get_size();
+        builder.clear();
+        push_synced(flags, sz, builder.get_data());
+    }
+}
 
-    packet_len += GTransportLen + len;
+void ClientServer::flush_reliable(const Connection *c) throw (Exception) {
+    flush_synced_packet(outgoing_synced.reliable, NetFlagsReliable);
+    Outgoing::iterator it = outgoing.find(c);
+    if (it != outgoing.end()) {
+        flush_packet(c, it->second->reliable, NetFlagsReliable);
+    }
+}
+
+void ClientServer::flush_all_reliable() throw (Exception) {
+    flush_synced_packet(outgoing_synced.reliable, NetFlagsReliable);
+    for (Outgoing::iterator it = outgoing.begin(); it != outgoing.end(); it++) {
+        flush_packet(it->first, it->second->reliable, NetFlagsReliable);
+    }
+}
+
+void ClientServer::push_synced(flags_t flags, data_len_t len, const void *data) throw (Exception) {
+    data_t *shared = share(len, data);
+    try {
+        for (Players::iterator it = players.begin(); it != players.end(); it++) {
+            Player *p = *it;
+            if (p->client_synced) {
+                push_shared(p->get_connection(), flags, len, shared);
+            }
+        }
+    } catch (const Exception&) {
+        unshare(shared);
+        throw;
+    }
+    unshare(shared);
 }
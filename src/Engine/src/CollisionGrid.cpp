@@ -0,0 +1,59 @@
+#include "CollisionGrid.hpp"
+
+CollisionGrid::CollisionGrid()
+    : tileset(0), map_array(0), width(0), height(0), friction_classes(0)
+{
+    for (int i = 0; i < CollisionFrictionClasses; i++) {
+        frictions[i] = 0.0f;
+    }
+}
+
+CollisionGrid::~CollisionGrid() { }
+
+void CollisionGrid::build(Tileset *tileset, short **map_array, int width, int height) {
+    this->tileset = tileset;
+    this->map_array = map_array;
+    this->width = width;
+    this->height = height;
+    friction_classes = 0;
+
+    cells.assign(width * height, CollisionCellEmpty);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            int index = map_array[y][x];
+            if (index > -1) {
+                Tile *t = tileset->get_tile(index);
+                unsigned char cell = static_cast<unsigned char>(t->get_tile_type()) & CollisionCellTypeMask;
+                cell |= get_friction_class(t->get_friction()) << CollisionCellFrictionShift;
+                if (t->is_light_blocking()) {
+                    cell |= CollisionCellLightBlocking;
+                }
+                cells[y * width + x] = cell;
+            }
+        }
+    }
+}
+
+double CollisionGrid::get_friction(unsigned char cell, int x, int y) const {
+    int friction_class = (cell >> CollisionCellFrictionShift) & CollisionCellFrictionMask;
+    if (friction_class == CollisionFrictionOfTile) {
+        return tileset->get_tile(map_array[y][x])->get_friction();
+    }
+
+    return frictions[friction_class];
+}
+
+int CollisionGrid::get_friction_class(double friction) {
+    for (int i = 0; i < friction_classes; i++) {
+        if (frictions[i] == friction) {
+            return i;
+        }
+    }
+
+    if (friction_classes == CollisionFrictionOfTile) {
+        return CollisionFrictionOfTile;
+    }
+    frictions[friction_classes] = friction;
+
+    return friction_classes++;
+}
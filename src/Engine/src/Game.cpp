@@ -20,10 +20,14 @@ Game::Game(Resources& resources, Subsystem& subsystem)
 
 Game::~Game() { }
 
-void Game::run(const std::string& parm) {
+void Game::run(const Parameters& parms) {
 #ifdef DEDICATED_SERVER
-    Server server(resources, subsystem, parm);
-    server.start();
+    if (parms.size() > 1) {
+        run_shards(parms);
+    } else {
+        Server server(resources, subsystem, parms.size() ? parms[0] : "");
+        server.start();
+    }
 #else
     if (config.get_bool("fullscreen")) {
         subsystem.toggle_fullscreen();
@@ -39,3 +43,34 @@ void Game::run(const std::string& parm) {
     menu.run();
 #endif
 }
+
+#ifdef DEDICATED_SERVER
+void Game::run_shards(const Parameters& config_files) {
+    typedef std::vector<Server *> Servers;
+
+    /* one server per config file, all reading from the same resources */
+    Servers servers;
+    try {
+        for (Parameters::const_iterator it = config_files.begin(); it != config_files.end(); it++) {
+            subsystem << "starting shard " << *it << std::endl;
+            servers.push_back(new Server(resources, subsystem, *it));
+        }
+        for (Servers::iterator it = servers.begin(); it != servers.end(); it++) {
+            (*it)->start_threaded();
+        }
+        for (Servers::iterator it = servers.begin(); it != servers.end(); it++) {
+            (*it)->join();
+        }
+    } catch (...) {
+        for (Servers::iterator it = servers.begin(); it != servers.end(); it++) {
+            (*it)->stop();
+            delete *it;
+        }
+        throw;
+    }
+
+    for (Servers::iterator it = servers.begin(); it != servers.end(); it++) {
+        delete *it;
+    }
+}
+#endif
@@ -0,0 +1,78 @@
+#include "HitboxHistory.hpp"
+
+HitboxHistory::HitboxHistory() : head(0), count(0) { }
+
+HitboxHistory::~HitboxHistory() { }
+
+void HitboxHistory::clear() {
+    head = 0;
+    count = 0;
+}
+
+void HitboxHistory::add(double time, double x, double y) {
+    if (count == HitboxHistorySize) {
+        head = (head + 1) % HitboxHistorySize;
+        count--;
+    }
+
+    HitboxSample& s = samples[(head + count) % HitboxHistorySize];
+    s.time = time;
+    s.x = x;
+    s.y = y;
+    count++;
+}
+
+bool HitboxHistory::get(double time, double& x, double& y) const {
+    if (!count) {
+        return false;
+    }
+
+    const HitboxSample& newest = at(count - 1);
+    if (time >= newest.time) {
+        x = newest.x;
+        y = newest.y;
+        return true;
+    }
+
+    const HitboxSample& oldest = at(0);
+    if (time <= oldest.time) {
+        x = oldest.x;
+        y = oldest.y;
+        return true;
+    }
+
+    /* between two ticks, linear */
+    int i = count - 2;
+    while (i > 0 && at(i).time > time) {
+        i--;
+    }
+    const HitboxSample& a = at(i);
+    const HitboxSample& b = at(i + 1);
+    double s = (time - a.time) / (b.time - a.time);
+    x = a.x + (b.x - a.x) * s;
+    y = a.y + (b.y - a.y) * s;
+
+    return true;
+}
+
+bool HitboxHistory::get_bounds(double& min_x, double& min_y, double& max_x, double& max_y) const {
+    if (!count) {
+        return false;
+    }
+
+    min_x = max_x = at(0).x;
+    min_y = max_y = at(0).y;
+    for (int i = 1; i < count; i++) {
+        const HitboxSample& s = at(i);
+        if (s.x < min_x) min_x = s.x;
+        if (s.x > max_x) max_x = s.x;
+        if (s.y < min_y) min_y = s.y;
+        if (s.y > max_y) max_y = s.y;
+    }
+
+    return true;
+}
+
+const HitboxSample& HitboxHistory::at(int index) const {
+    return samples[(head + index) % HitboxHistorySize];
+}
@@ -0,0 +1,56 @@
+#include "InputHistory.hpp"
+#include "Snapshot.hpp"
+
+InputHistory::InputHistory() : input_no(0) { }
+
+InputHistory::~InputHistory() { }
+
+void InputHistory::clear() {
+    /* the numbering goes on, the server still knows the old ones */
+    inputs.clear();
+}
+
+void InputHistory::add(GPlayerInput& input, double x, double y) {
+    input.input_no = ++input_no;
+    if (inputs.size() >= InputHistorySize) {
+        inputs.pop_front();
+    }
+
+    PredictedInput predicted;
+    predicted.input = input;
+    predicted.x = x;
+    predicted.y = y;
+    inputs.push_back(predicted);
+}
+
+bool InputHistory::acknowledge(uint16_t input_no, PredictedInput& acked) {
+    bool found = false;
+    while (!inputs.empty() && !snapshot_newer(inputs.front().input.input_no, input_no)) {
+        if (inputs.front().input.input_no == input_no) {
+            acked = inputs.front();
+            found = true;
+        }
+        inputs.pop_front();
+    }
+
+    return found;
+}
+
+size_t InputHistory::get_count() const {
+    return inputs.size();
+}
+
+PredictedInput& InputHistory::get(size_t index) {
+    return inputs[index];
+}
+
+size_t InputHistory::get_newest(GPlayerInput *out, size_t max) const {
+    size_t sz = inputs.size();
+    size_t n = (sz < max ? sz : max);
+    for (size_t i = 0; i < n; i++) {
+        out[i] = inputs[sz - n + i].input;
+        out[i].to_net();
+    }
+
+    return n;
+}
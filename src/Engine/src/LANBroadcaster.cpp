@@ -2,6 +2,8 @@
 
 #include <iostream>
 
+static const ns_t NetIdleWaitNS = 10000000;
+
 LANBroadcaster::LANBroadcaster(hostport_t port) throw (LANBroadcasterException, UDPSocketException)
     : MessageSequencer(port, 0, "", ""), port(port), running(false)
 {
@@ -26,6 +28,7 @@ void LANBroadcaster::start() throw (LANBroadcasterException) {
 void LANBroadcaster::stop() {
     if (running) {
         running = false;
+        reactor.wake();
         thread_join();
     }
 }
@@ -83,11 +86,22 @@ void LANBroadcaster::cleanup() {
 }
 
 void LANBroadcaster::thread() {
+    try {
+        watch(reactor);
+    } catch (const Exception&) {
+        /* fall back to polling */
+    }
+
     while (running) {
         {
             ScopeMutex lock(mtx);
             while(cycle());
         }
-        wait_ns(1000000);
+        try {
+            reactor.wait(NetIdleWaitNS);
+        } catch (const Exception&) {
+            wait_ns(1000000);
+        }
     }
+    unwatch(reactor);
 }
@@ -3,6 +3,8 @@
 
 #include <cstdlib>
 
+static const ns_t NetIdleWaitNS = 10000000;
+
 MasterQuery::MasterQuery(const std::string& masterserver, hostport_t masterport)
     throw (MasterQueryException)
     : masterserver(masterserver), masterport(masterport), running(false)
@@ -14,6 +16,7 @@ MasterQuery::MasterQuery(const std::string& masterserver, hostport_t masterport)
 MasterQuery::~MasterQuery() {
     stop();
     cleanup();
+    update_watches();
 }
 
 void MasterQuery::start() throw (MasterQueryException) {
@@ -28,6 +31,7 @@ void MasterQuery::start() throw (MasterQueryException) {
 void MasterQuery::stop() {
     if (running) {
         running = false;
+        reactor.wake();
         thread_join();
     }
 }
@@ -81,6 +85,7 @@ void MasterQuery::refresh() throw (MasterQueryException) {
             hostport_t port = atoi(entry.substr(pos + 1).c_str());
             MasterQueryClient *mqc = new MasterQueryClient(*this, host, port);
             hosts.push_back(mqc);
+            unwatched.push_back(mqc);
         }
     }
 }
@@ -95,10 +100,29 @@ Mutex& MasterQuery::get_mutex(){
 }
 
 void MasterQuery::cleanup() {
-    for (Hosts::iterator it = hosts.begin(); it != hosts.end(); it++) {
-        delete *it;
-    }
+    /* the thread might sleep on their sockets right now */
+    retired.insert(retired.end(), hosts.begin(), hosts.end());
     hosts.clear();
+    unwatched.clear();
+}
+
+void MasterQuery::update_watches() {
+    for (Hosts::iterator it = retired.begin(); it != retired.end(); it++) {
+        MasterQueryClient *client = static_cast<MasterQueryClient *>(*it);
+        client->unwatch(reactor);
+        delete client;
+    }
+    retired.clear();
+
+    for (Hosts::iterator it = unwatched.begin(); it != unwatched.end(); it++) {
+        MasterQueryClient *client = static_cast<MasterQueryClient *>(*it);
+        try {
+            client->watch(reactor);
+        } catch (const Exception&) {
+            /* still polled every NetIdleWaitNS */
+        }
+    }
+    unwatched.clear();
 }
 
 void MasterQuery::thread() {
@@ -107,8 +131,13 @@ void MasterQuery::thread() {
         {
             get_now(now);
             ScopeMutex lock(mtx);
+            update_watches();
             cycle(&now);
         }
-        wait_ns(1000000);
+        try {
+            reactor.wait(NetIdleWaitNS);
+        } catch (const Exception&) {
+            wait_ns(1000000);
+        }
     }
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "MessageSequencer.hpp"
 
 #include <cstdlib>
+#include <cmath>
 #include <iostream>
 
 /* to simulate crappy net links:
@@ -12,37 +13,290 @@
 /* some consts to tweak */
 static const int PingTimeout = 5000; /* 5 seconds */
 static const int PingInterval = 500; /* 500 ms    */
-static const int MaxResends = 7;     /* 6250 ms   */
+static const int ResendGiveUp = 8000; /* 8 seconds */
+static const int AckDelay = 40;      /* wait for outgoing data to carry the ack */
+static const int HeapQuarantine = 10000; /* 10 seconds before a retired heap is reused */
+static const int MinResendTimeout = 50;
+static const int MaxResendTimeout = 2000;
+static const int ClockGranularity = 10; /* floor for the jitter term of the timeout */
+static const float LossGain = 1.0f / 64.0f;
+static const float LossBackoff = 10.0f; /* 10% loss halves the send window */
+static const size_t DefaultSendWindow = 32;
+static const size_t MinSendWindow = 4;
+static const size_t MaxReceivers = 8;
+static const data_len_t DeflateThreshold = 64; /* smaller payloads won't pay off */
 
 /* subtract 1 of the name[1] -> c++ forbids zero arrays eg. name[0] */
-static const int MsgHeaderLength = sizeof(NetMessage) - 1 + sizeof(NetMessageData) - 1;
+static const int MsgHeaderLength = NetMessageHeaderLength;
 static const int ServerStatusLength = sizeof(ServerStatusMsg) - 1;
 
+/* preset dictionary for reliable payloads, which are mostly zero  */
+/* padded names. the most common strings go last, closest to the  */
+/* data, followed by a run of zeros as long as the longest match. */
+static const char *DeflateStrings[] = {
+    "warm_up", "game_over", "respawn", "hurt", "chat", "player_afk",
+    "frog", "small", "big", "normal", "disappear", 0
+};
+static const size_t DeflateZeroRun = 258;
+
+static std::string deflate_dictionary() {
+    std::string dictionary;
+    for (const char **s = DeflateStrings; *s; s++) {
+        dictionary += *s;
+        dictionary += '\0';
+    }
+    dictionary.append(DeflateZeroRun, '\0');
+
+    return dictionary;
+}
+
+/* wrapping millisecond clock for the header stamps */
+static uint16_t stamp_ms(const gametime_t& time) {
+    return static_cast<uint16_t>(time.tv_sec * 1000 + time.tv_nsec / 1000000);
+}
+
+/* the lookup table is kept at most half full, so probe chains stay short */
+static size_t heap_index_capacity(pico_size_t max_heaps) {
+    size_t capacity = 4;
+    while (capacity < static_cast<size_t>(max_heaps) * 2) {
+        capacity <<= 1;
+    }
+
+    return capacity;
+}
+
+/* payload slab, each slot is prefixed with its reference count */
+static const int SlotsPerBlock = 64;
+static const int SlotHeaderSize = 8;
+static const int SlotStride = SlotHeaderSize + MessageSlotSize;
+
+static uint32_t& slot_refs(data_t *slot) {
+    return *reinterpret_cast<uint32_t *>(slot - SlotHeaderSize);
+}
+
+MessageSlab::MessageSlab() { }
+
+MessageSlab::~MessageSlab() {
+    for (Slots::iterator it = blocks.begin(); it != blocks.end(); it++) {
+        delete[] *it;
+    }
+}
+
+data_t *MessageSlab::acquire() {
+    if (free_slots.empty()) {
+        data_t *block = new data_t[SlotStride * SlotsPerBlock];
+        blocks.push_back(block);
+        for (int i = SlotsPerBlock - 1; i >= 0; i--) {
+            free_slots.push_back(block + i * SlotStride + SlotHeaderSize);
+        }
+    }
+    data_t *slot = free_slots.back();
+    free_slots.pop_back();
+    slot_refs(slot) = 1;
+
+    return slot;
+}
+
+void MessageSlab::retain(data_t *slot) {
+    if (slot) {
+        slot_refs(slot)++;
+    }
+}
+
+void MessageSlab::release(data_t *slot) {
+    if (slot && !--slot_refs(slot)) {
+        free_slots.push_back(slot);
+    }
+}
+
+/* reliable message ring */
+static const size_t InitialQueueCapacity = 64; /* must be a power of 2 */
+
+MessageQueue::MessageQueue(MessageSlab& slab)
+    : slab(slab), ring(InitialQueueCapacity), mask(InitialQueueCapacity - 1),
+      base(1), count(0) { }
+
+MessageQueue::~MessageQueue() {
+    clear(1);
+}
+
+bool MessageQueue::put(sequence_no_t seq_no, flags_t flags, command_t cmd,
+    data_len_t len, const void *data)
+{
+    QueueMessage *msg = claim(seq_no, flags, cmd, len);
+    if (!msg) {
+        return false;
+    }
+
+    if (len) {
+        msg->data = slab.acquire();
+        memcpy(msg->data, data, len);
+    }
+
+    return true;
+}
+
+void MessageQueue::push_back(sequence_no_t seq_no, flags_t flags, command_t cmd,
+    data_len_t len, const void *data)
+{
+    while (seq_no - base > mask) {
+        grow();
+    }
+    put(seq_no, flags, cmd, len, data);
+}
+
+void MessageQueue::push_back_shared(sequence_no_t seq_no, flags_t flags, command_t cmd,
+    data_len_t len, data_t *shared)
+{
+    while (seq_no - base > mask) {
+        grow();
+    }
+
+    QueueMessage *msg = claim(seq_no, flags, cmd, len);
+    if (msg && len) {
+        slab.retain(shared);
+        msg->data = shared;
+    }
+}
+
+QueueMessage *MessageQueue::get(sequence_no_t seq_no) {
+    if (seq_no - base > mask) {
+        return 0;
+    }
+
+    QueueMessage& msg = ring[seq_no & mask];
+    if (!msg.used || msg.seq_no != seq_no) {
+        return 0;
+    }
+
+    return &msg;
+}
+
+QueueMessage *MessageQueue::front() {
+    return get(base);
+}
+
+sequence_no_t MessageQueue::front_seq_no() const {
+    return base;
+}
+
+void MessageQueue::pop_front() {
+    QueueMessage& msg = ring[base & mask];
+    if (msg.used && msg.seq_no == base) {
+        slab.release(msg.data);
+        msg.data = 0;
+        msg.used = false;
+        count--;
+    }
+    base++;
+}
+
+void MessageQueue::remove(sequence_no_t seq_no) {
+    QueueMessage *msg = get(seq_no);
+    if (msg) {
+        slab.release(msg->data);
+        msg->data = 0;
+        msg->used = false;
+        count--;
+    }
+}
+
+void MessageQueue::clear(sequence_no_t new_base) {
+    for (Ring::iterator it = ring.begin(); it != ring.end(); it++) {
+        QueueMessage& msg = *it;
+        if (msg.used) {
+            slab.release(msg.data);
+            msg.data = 0;
+            msg.used = false;
+        }
+    }
+    count = 0;
+    base = new_base;
+}
+
+size_t MessageQueue::size() const {
+    return count;
+}
+
+QueueMessage *MessageQueue::claim(sequence_no_t seq_no, flags_t flags, command_t cmd, data_len_t len) {
+    sequence_no_t diff = seq_no - base;
+    if (diff > mask) {
+        return 0;
+    }
+
+    QueueMessage& msg = ring[seq_no & mask];
+    if (msg.used) {
+        return 0;
+    }
+
+    msg.used = true;
+    msg.touch.tv_sec = 0;
+    msg.touch.tv_nsec = 0;
+    msg.resends = 0;
+    msg.last_resend_ms = 50;
+    msg.seq_no = seq_no;
+    msg.flags = flags;
+    msg.cmd = cmd;
+    msg.len = len;
+    msg.data = 0;
+    count++;
+
+    return &msg;
+}
+
+void MessageQueue::grow() {
+    Ring bigger(ring.size() * 2);
+    size_t bigger_mask = bigger.size() - 1;
+    for (Ring::iterator it = ring.begin(); it != ring.end(); it++) {
+        QueueMessage& msg = *it;
+        if (msg.used) {
+            bigger[msg.seq_no & bigger_mask] = msg;
+        }
+    }
+    ring.swap(bigger);
+    mask = bigger_mask;
+}
+
+/* sequencer */
 MessageSequencer::MessageSequencer(hostport_t port, pico_size_t max_heaps,
-    const std::string& name, const std::string& password) throw (Exception)
-    : max_heaps(max_heaps), is_client(false), name(name), password(password), socket(port),
+    const std::string& name, const std::string& password, size_t num_receivers) throw (Exception)
+    : max_heaps(max_heaps), is_client(false), send_window(DefaultSendWindow), name(name), password(password),
+      socket(port, num_receivers > 0),
       pmsg(reinterpret_cast<NetMessage *>(buffer)),
-      pdata(reinterpret_cast<NetMessageData *>(pmsg->data))
+      pdata(reinterpret_cast<NetMessageData *>(pmsg->data)),
+      next_receiver(0), heap_index(heap_index_capacity(max_heaps), 0),
+      dictionary(deflate_dictionary()), deflater(dictionary.data(), dictionary.length()),
+      inflater(dictionary.data(), dictionary.length()), deflate_source(0), deflated(0), deflated_len(0)
 {
     memset(buffer, 0, sizeof buffer);
+
+    if (num_receivers) {
+        start_receivers(port, num_receivers);
+    }
 }
 
 MessageSequencer::MessageSequencer(hostaddr_t server_host, hostport_t server_port)
     throw (Exception)
-    : max_heaps(1), is_client(true), name(), password(), socket(),
+    : max_heaps(1), is_client(true), send_window(DefaultSendWindow), name(), password(), socket(),
       pmsg(reinterpret_cast<NetMessage *>(buffer)),
-      pdata(reinterpret_cast<NetMessageData *>(pmsg->data))
+      pdata(reinterpret_cast<NetMessageData *>(pmsg->data)),
+      next_receiver(0), heap_index(heap_index_capacity(1), 0),
+      dictionary(deflate_dictionary()), deflater(dictionary.data(), dictionary.length()),
+      inflater(dictionary.data(), dictionary.length()), deflate_source(0), deflated(0), deflated_len(0)
 {
     memset(buffer, 0, sizeof buffer);
 
-    SequencerHeap *heap = new SequencerHeap(server_host, server_port);
-    heaps.push_back(heap);
+    create_heap(server_host, server_port);
 
     request_server_info(server_host, server_port);
 }
 
 MessageSequencer::~MessageSequencer() {
+    stop_receivers();
     delete_all_heaps();
+    for (RetiredHeaps::iterator it = free_heaps.begin(); it != free_heaps.end(); it++) {
+        delete *it;
+    }
 }
 
 void MessageSequencer::request_server_info(hostaddr_t host, hostport_t port) throw (Exception) {
@@ -75,10 +329,25 @@ void MessageSequencer::logout() throw (Exception) {
 }
 
 void MessageSequencer::broadcast(flags_t flags, data_len_t len, const void *data) throw (Exception) {
-    for (SequencerHeaps::iterator it = heaps.begin(); it != heaps.end(); it++) {
-        SequencerHeap *heap = *it;
-        push(heap, flags, len, data);
+    if (!(flags & NetFlagsReliable) || heaps.size() < 2) {
+        for (SequencerHeaps::iterator it = heaps.begin(); it != heaps.end(); it++) {
+            SequencerHeap *heap = *it;
+            push(heap, flags, len, data);
+        }
+        return;
     }
+
+    data_t *shared = share(len, data);
+    try {
+        for (SequencerHeaps::iterator it = heaps.begin(); it != heaps.end(); it++) {
+            SequencerHeap *heap = *it;
+            push_shared(heap, flags, len, shared);
+        }
+    } catch (const Exception&) {
+        unshare(shared);
+        throw;
+    }
+    unshare(shared);
 }
 
 void MessageSequencer::push(flags_t flags, data_len_t len, const void *data) throw (Exception) {
@@ -106,22 +375,74 @@ void MessageSequencer::push(const Connection *c, command_t cmd, flags_t flags,
 {
     SequencerHeap *h = find_heap(c);
     if (h && h->active) {
+        if (len > MessageSlotSize - MsgHeaderLength) {
+            throw Exception("Message too large to be sent");
+        }
         if (flags & NetFlagsReliable) {
-            data_t *alloc_data = 0;
-            if (len) {
-                alloc_data = new data_t[len];
-                memcpy(alloc_data, data, len);
+            data_len_t sz = (deflatable(h, cmd, len) ? deflate(len, data, deflate_buffer) : 0);
+            if (sz) {
+                h->out_queue.push_back(++h->last_send_rel_seq_no, flags | NetFlagsDeflate, cmd,
+                    sz, deflate_buffer);
+            } else {
+                h->out_queue.push_back(++h->last_send_rel_seq_no, flags, cmd, len, data);
             }
-            QueueMessage *m = new QueueMessage(++h->last_send_rel_seq_no, flags,
-                cmd, len, alloc_data);
-            h->out_queue.push_back(m);
         } else {
-            slack_send(h->host, h->port, ++h->last_send_unrel_seq_no,
-                flags, cmd, len, data);
+            slack_send(h, ++h->last_send_unrel_seq_no, flags, cmd, len, data);
         }
     }
 }
 
+data_t *MessageSequencer::share(data_len_t len, const void *data) throw (Exception) {
+    if (len > MessageSlotSize - MsgHeaderLength) {
+        throw Exception("Message too large to be sent");
+    }
+
+    data_t *shared = slab.acquire();
+    if (len) {
+        memcpy(shared, data, len);
+    }
+
+    return shared;
+}
+
+void MessageSequencer::push_shared(const Connection *c, flags_t flags, data_len_t len,
+    data_t *shared) throw (Exception)
+{
+    SequencerHeap *h = find_heap(c);
+    if (h && h->active) {
+        if (flags & NetFlagsReliable) {
+            /* deflated once for all receivers of the shared slot */
+            if (deflatable(h, NetCommandData, len) && deflate_source != shared) {
+                slab.release(deflated);
+                deflate_source = shared;
+                deflated = slab.acquire();
+                deflated_len = deflate(len, shared, deflated);
+                if (!deflated_len) {
+                    slab.release(deflated);
+                    deflated = 0;
+                }
+            }
+            if (deflatable(h, NetCommandData, len) && deflated) {
+                h->out_queue.push_back_shared(++h->last_send_rel_seq_no, flags | NetFlagsDeflate,
+                    NetCommandData, deflated_len, deflated);
+            } else {
+                h->out_queue.push_back_shared(++h->last_send_rel_seq_no, flags, NetCommandData, len, shared);
+            }
+        } else {
+            slack_send(h, ++h->last_send_unrel_seq_no, flags, NetCommandData, len, shared);
+        }
+    }
+}
+
+void MessageSequencer::unshare(data_t *shared) {
+    if (shared && shared == deflate_source) {
+        slab.release(deflated);
+        deflate_source = 0;
+        deflated = 0;
+    }
+    slab.release(shared);
+}
+
 bool MessageSequencer::cycle() throw (Exception) {
     hostaddr_t host;
     hostport_t port;
@@ -133,11 +454,14 @@ bool MessageSequencer::cycle() throw (Exception) {
     get_now(touch);
 
     /* incoming data? */
-    ssize_t sz = socket.recv(buffer, sizeof(buffer), &host, &port);
+    bool decoded = false;
+    ssize_t sz = receive(&host, &port, &decoded);
     if (sz) {
         again = true;
-        pmsg->from_net();
-        pdata->from_net();
+        if (!decoded) {
+            pmsg->from_net();
+            pdata->from_net();
+        }
 
         if (pmsg->cmd == NetCommandStatReq) {
             /* server status request */
@@ -176,46 +500,48 @@ bool MessageSequencer::cycle() throw (Exception) {
             }
         } else {
             /* login attempt, create new heap */
-            SequencerHeap *h = 0;
+            SequencerHeap *h = find_heap(host, port);
             if (pmsg->cmd == NetCommandLogin) {
-                if (!is_client && !find_heap(host, port)) {
+                if (!is_client && !h) {
                     NetLogin *login = reinterpret_cast<NetLogin *>(pdata->data);
                     std::string pwd(login->pwd);
                     if (password.length() && pwd != password) {
                         slack_send(host, port, 0, 0, NetCommandWrongPassword, 0, 0);
                     } else if (heaps.size() < max_heaps) {
-                        h = new SequencerHeap(host, port);
-                        heaps.push_back(h);
+                        h = create_heap(host, port);
                     } else {
                         slack_send(host, port, 0, 0, NetCommandServerFull, 0, 0);
                     }
                 }
-            } else {
-                h = find_heap(host, port);
             }
 
             /* process, if valid heap */
             if (h) {
+                /* keep the header, event handlers may reuse the buffer */
+                NetMessage header(*pmsg);
                 if (pmsg->flags & NetFlagsReliable) {
-                    /* queueing */
+                    /* queueing, out of window messages are dropped, sender resends them */
                     if (pmsg->seq_no > h->last_recv_rel_seq_no) {
-                        data_t *alloc_data = 0;
-                        if (pdata->len) {
-                            alloc_data = new data_t[pdata->len];
-                            memcpy(alloc_data, pdata->data, pdata->len);
+                        if (pdata->len <= MessageSlotSize - MsgHeaderLength) {
+                            h->in_queue.put(pmsg->seq_no, pmsg->flags, pmsg->cmd,
+                                pdata->len, pdata->data);
                         }
-                        QueueMessage *m = new QueueMessage(pmsg->seq_no, pmsg->flags,
-                            pmsg->cmd, pdata->len, alloc_data);
-                        sorted_insert(h->in_queue, m);
-                    } else {
-                        ack(h, pmsg->seq_no);
+                    }
+                    /* duplicates are acked again, our last ack might be lost */
+                    if (!h->ack_pending) {
+                        h->ack_pending = true;
+                        h->ack_since = touch;
                     }
                 } else {
                     if (pmsg->seq_no > h->last_recv_unrel_seq_no) {
+                        update_loss(h, pmsg->seq_no - h->last_recv_unrel_seq_no - 1);
                         h->last_recv_unrel_seq_no = pmsg->seq_no;
                         process_incoming(h, pmsg);
                     }
                 }
+                if (h->active) {
+                    process_header(h, header, touch);
+                }
             }
         }
     }
@@ -226,60 +552,67 @@ bool MessageSequencer::cycle() throw (Exception) {
         for (SequencerHeaps::iterator it = heaps.begin(); it != heaps.end(); it++) {
             SequencerHeap *h = *it;
 
-            /* inspect incoming queue */
-            if (h->in_queue.size()) {
-                QueueMessage *tmp_smsg = h->in_queue[0];
-                if (tmp_smsg->seq_no == h->last_recv_rel_seq_no + 1) {
-                    h->last_recv_rel_seq_no = tmp_smsg->seq_no;
-                    pmsg->seq_no = tmp_smsg->seq_no;
-                    pmsg->flags = tmp_smsg->flags;
-                    pmsg->cmd = tmp_smsg->cmd;
+            /* deliver incoming queue in order, its front is always last_recv_rel_seq_no + 1 */
+            bool logged_out = false;
+            while (QueueMessage *tmp_smsg = h->in_queue.front()) {
+                command_t tmp_cmd = tmp_smsg->cmd;
+                h->last_recv_rel_seq_no = tmp_smsg->seq_no;
+                pmsg->seq_no = tmp_smsg->seq_no;
+                pmsg->flags = tmp_smsg->flags;
+                pmsg->cmd = tmp_cmd;
+                bool intact = true;
+                if (tmp_smsg->flags & NetFlagsDeflate) {
+                    /* one byte less, process_incoming terminates the payload */
+                    size_t len = 0;
+                    intact = inflater.inflate(tmp_smsg->data, tmp_smsg->len, pdata->data,
+                        MessageSlotSize - MsgHeaderLength - 1, len);
+                    pdata->len = static_cast<data_len_t>(len);
+                } else {
                     pdata->len = tmp_smsg->len;
                     memcpy(pdata->data, tmp_smsg->data, tmp_smsg->len);
+                }
+                h->in_queue.pop_front();
+                if (intact) {
                     process_incoming(h, pmsg);
-                    h->in_queue.pop_front();
-                    ack(h, tmp_smsg->seq_no);
-                    command_t tmp_cmd = tmp_smsg->cmd;
-                    delete tmp_smsg;
-                    if (tmp_cmd == NetCommandLogout) {
-                        delete_heap(h);
-                        recycle = true;
-                        break;
-                    }
+                }
+                if (tmp_cmd == NetCommandLogout || !h->active) {
+                    logged_out = true;
+                    break;
                 }
             }
-
-            /* re/-send deepest entry in outgoing queue */
-            if (h->out_queue.size()) {
-                QueueMessage *tmp_smsg = h->out_queue[0];
-                ms_t diff = diff_ms(tmp_smsg->touch, touch);
-                if (!tmp_smsg->touch.tv_sec || diff >= tmp_smsg->last_resend_ms) {
-                    again = true;
-                    tmp_smsg->touch = touch;
-                    tmp_smsg->resends++;
-                    tmp_smsg->last_resend_ms *= 2;
-                    if (tmp_smsg->resends > MaxResends) {
-                        /* disconnect after too many resends */
-                        h->active = false;
-                        event_logout(h, LogoutReasonTooManyResends);
-                        delete_heap(h);
-                        recycle = true;
-                        break;
-                    } else {
-                        slack_send(h->host, h->port, tmp_smsg->seq_no, tmp_smsg->flags,
-                            tmp_smsg->cmd, tmp_smsg->len, tmp_smsg->data);
-                    }
+            if (logged_out) {
+                if (h->ack_pending && h->active) {
+                    ack(h);
                 }
+                delete_heap(h);
+                recycle = true;
+                break;
+            }
+
+            /* re/-send everything due within the send window */
+            bool sent = false;
+            if (!send_out_queue(h, touch, sent)) {
+                /* disconnect, if a message can't get through */
+                h->active = false;
+                event_logout(h, LogoutReasonTooManyResends);
+                delete_heap(h);
+                recycle = true;
+                break;
+            }
+            if (sent) {
+                again = true;
             }
 
-            /* send unrel ping */
-            ms_t diff = diff_ms(h->last_ping, touch);
-            if (!h->last_ping.tv_sec || diff >= PingInterval) {
-                get_now(h->last_ping);
-                push(h, NetCommandPing, 0, sizeof(gametime_t), &h->last_ping);
-                h->sent_pings++;
+            /* nothing went out to carry the ack, send it alone */
+            if (h->ack_pending && diff_ms(h->ack_since, touch) >= AckDelay) {
+                ack(h);
             }
-            if (h->sent_pings > PingTimeout / PingInterval) {
+
+            /* keep idle links alive, the header carries the ping stamps */
+            if (diff_ms(h->last_send, touch) >= PingInterval) {
+                slack_send(h, ++h->last_send_unrel_seq_no, 0, NetCommandPing, 0, 0);
+            }
+            if (diff_ms(h->last_recv, touch) > PingTimeout) {
                 /* after x seconds of absolutely silence, disconnect client */
                 h->active = false;
                 event_logout(h, LogoutReasonPingTimeout);
@@ -294,55 +627,263 @@ bool MessageSequencer::cycle() throw (Exception) {
     return again;
 }
 
+void MessageSequencer::flush() throw (Exception) {
+    socket.flush();
+}
+
+void MessageSequencer::watch(Reactor& reactor) throw (Exception) {
+    reactor.add(socket);
+    for (NetReceivers::iterator it = receivers.begin(); it != receivers.end(); it++) {
+        (*it)->set_reactor(&reactor);
+    }
+}
+
+void MessageSequencer::unwatch(Reactor& reactor) {
+    for (NetReceivers::iterator it = receivers.begin(); it != receivers.end(); it++) {
+        (*it)->set_reactor(0);
+    }
+    reactor.remove(socket);
+}
+
+void MessageSequencer::set_io_batch_size(size_t count) throw (Exception) {
+    socket.set_batch_size(count);
+}
+
+ssize_t MessageSequencer::receive(hostaddr_t *host, hostport_t *port, bool *decoded) throw (Exception) {
+    /* receiver threads first, round robin */
+    size_t count = receivers.size();
+    for (size_t i = 0; i < count; i++) {
+        NetReceiver *receiver = receivers[next_receiver];
+        next_receiver = (next_receiver + 1) % count;
+        const ReceivedDatagram *dgram = receiver->front();
+        if (dgram) {
+            memcpy(buffer, dgram->data, dgram->len);
+            *host = dgram->host;
+            *port = dgram->port;
+            *decoded = true;
+            ssize_t sz = static_cast<ssize_t>(dgram->len);
+            receiver->pop();
+
+            return sz;
+        }
+    }
+
+    /* own socket, gets its share, if steering is not available */
+    *decoded = false;
+
+    return socket.recv(buffer, MessageSlotSize, host, port);
+}
+
+void MessageSequencer::start_receivers(hostport_t port, size_t count) throw (Exception) {
+    if (count > MaxReceivers) {
+        count = MaxReceivers;
+    }
+
+    try {
+        for (size_t i = 0; i < count; i++) {
+            receivers.push_back(new NetReceiver(port));
+        }
+
+        /* our own socket is first in the group, keep it for sending */
+        receivers.back()->get_socket().steer_reuse_port_group(1, static_cast<unsigned int>(count));
+
+        for (NetReceivers::iterator it = receivers.begin(); it != receivers.end(); it++) {
+            (*it)->start();
+        }
+    } catch (...) {
+        stop_receivers();
+        throw;
+    }
+}
+
+void MessageSequencer::stop_receivers() {
+    for (NetReceivers::iterator it = receivers.begin(); it != receivers.end(); it++) {
+        delete *it;
+    }
+    receivers.clear();
+}
+
+void MessageSequencer::set_send_window(size_t count) {
+    if (count < 1) {
+        count = 1;
+    } else if (count > MaxSendWindow) {
+        count = MaxSendWindow;
+    }
+    send_window = count;
+}
+
 void MessageSequencer::kill(const Connection *c) throw (Exception) {
     SequencerHeap *h = static_cast<SequencerHeap *>(const_cast<Connection *>(c));
     event_logout(c, LogoutApplicationQuit);
     delete_heap(h);
 }
 
-void MessageSequencer::ack(SequencerHeap *heap, sequence_no_t seq_no) throw (Exception) {
-    sequence_no_t net_seq_no = htonl(seq_no);
-    slack_send(heap->host, heap->port, ++heap->last_send_unrel_seq_no,
-        0, NetCommandAcknowledge, sizeof(sequence_no_t), &net_seq_no);
+void MessageSequencer::ack(SequencerHeap *heap) throw (Exception) {
+    slack_send(heap, ++heap->last_send_unrel_seq_no, 0, NetCommandAcknowledge, 0, 0);
 }
 
-void MessageSequencer::process_incoming(SequencerHeap *heap, NetMessage *msg) throw (Exception) {
-    NetMessageData *data = reinterpret_cast<NetMessageData *>(msg->data);
+void MessageSequencer::process_header(SequencerHeap *heap, const NetMessage& header,
+    const gametime_t& now) throw (Exception)
+{
+    heap->last_recv = now;
+    if (header.flags & NetFlagsInflates) {
+        heap->peer_inflates = true;
+    }
 
-    switch (msg->cmd) {
-        case NetCommandAcknowledge:
-        {
-            if (heap->out_queue.size()) {
-                sequence_no_t *pseq_no = reinterpret_cast<sequence_no_t *>(data->data);
-                sequence_no_t seq_no = ntohl(*pseq_no);
-                QueueMessage *tmp_smsg = heap->out_queue[0];
-                if (tmp_smsg->seq_no == seq_no) {
-                    if (tmp_smsg->cmd == NetCommandLogin) {
-                        event_login(heap, tmp_smsg->len, tmp_smsg->data);
-                    }
-                    delete tmp_smsg;
-                    heap->out_queue.pop_front();
+    /* round trip from our echoed stamp, minus the time the peer held it */
+    if (header.flags & NetFlagsEcho) {
+        uint16_t elapsed = static_cast<uint16_t>(stamp_ms(now) - header.echo);
+        if (elapsed >= header.echo_delay) {
+            update_rtt(heap, elapsed - header.echo_delay);
+        }
+    }
+    heap->peer_stamp = header.stamp;
+    heap->peer_stamp_touch = now;
+    heap->peer_stamp_valid = true;
+
+    /* everything up to the cumulative ack is through */
+    MessageQueue& queue = heap->out_queue;
+    sequence_no_t ack = header.ack;
+    if (queue.size() && ack <= heap->last_send_rel_seq_no) {
+        while (queue.size() && queue.front_seq_no() <= ack) {
+            QueueMessage *tmp_smsg = queue.front();
+            if (tmp_smsg) {
+                acknowledged(heap, tmp_smsg);
+            }
+            queue.pop_front();
+        }
+
+        /* and the holes behind it, which don't need resending */
+        uint32_t ack_bits = header.ack_bits;
+        for (int i = 0; i < NetAckSelectiveBits && ack_bits; i++) {
+            if (ack_bits & (1U << i)) {
+                QueueMessage *tmp_smsg = queue.get(ack + 2 + i);
+                if (tmp_smsg) {
+                    acknowledged(heap, tmp_smsg);
                 }
             }
-            break;
         }
+    }
+}
 
-        case NetCommandPing:
-        {
-            push(heap, NetCommandPong, 0, data->len, data->data);
-            break;
+void MessageSequencer::acknowledged(SequencerHeap *heap, QueueMessage *msg) throw (Exception) {
+    if (msg->cmd == NetCommandLogin) {
+        event_login(heap, msg->len, msg->data);
+    }
+    heap->out_queue.remove(msg->seq_no);
+}
+
+bool MessageSequencer::send_out_queue(SequencerHeap *heap, const gametime_t& now, bool& sent)
+    throw (Exception)
+{
+    MessageQueue& queue = heap->out_queue;
+    if (!queue.size()) {
+        return true;
+    }
+
+    sequence_no_t first = queue.front_seq_no();
+    sequence_no_t last = heap->last_send_rel_seq_no;
+    size_t window = loss_window(heap);
+    if (last - first >= window) {
+        last = first + static_cast<sequence_no_t>(window) - 1;
+    }
+
+    for (sequence_no_t seq_no = first; seq_no <= last; seq_no++) {
+        QueueMessage *msg = queue.get(seq_no);
+        if (!msg) {
+            continue;   /* already selectively acked */
+        }
+        if (msg->touch.tv_sec && diff_ms(msg->touch, now) < msg->last_resend_ms) {
+            continue;
+        }
+        if (msg->touch.tv_sec) {
+            if (diff_ms(msg->first_touch, now) >= ResendGiveUp) {
+                return false;
+            }
+            msg->last_resend_ms *= 2;
+            if (msg->last_resend_ms > MaxResendTimeout) {
+                msg->last_resend_ms = MaxResendTimeout;
+            }
+        } else {
+            msg->first_touch = now;
+            msg->last_resend_ms = static_cast<int>(heap->resend_timeout);
         }
+        msg->touch = now;
+        msg->resends++;
+        slack_send(heap, msg->seq_no, msg->flags, msg->cmd, msg->len, msg->data);
+        sent = true;
+    }
 
-        case NetCommandPong:
-        {
-            gametime_t *pseq_time = reinterpret_cast<gametime_t *>(data->data);
-            gametime_t now;
-            get_now(now);
-            heap->ping_time = diff_ms(*pseq_time, now);
-            heap->sent_pings = 0;
-            break;
+    return true;
+}
+
+uint32_t MessageSequencer::selective_acks(SequencerHeap *heap) {
+    uint32_t ack_bits = 0;
+    if (heap->in_queue.size()) {
+        for (int i = 0; i < NetAckSelectiveBits; i++) {
+            if (heap->in_queue.get(heap->last_recv_rel_seq_no + 2 + i)) {
+                ack_bits |= (1U << i);
+            }
         }
+    }
 
+    return ack_bits;
+}
+
+void MessageSequencer::update_rtt(SequencerHeap *heap, ms_t sample) {
+    float r = static_cast<float>(sample);
+    if (!heap->rtt_valid) {
+        heap->srtt = r;
+        heap->rttvar = r / 2.0f;
+        heap->rtt_valid = true;
+    } else {
+        float err = r - heap->srtt;
+        heap->rttvar += (std::fabs(err) - heap->rttvar) / 4.0f;
+        heap->srtt += err / 8.0f;
+    }
+    heap->ping_time = static_cast<ms_t>(heap->srtt + 0.5f);
+    heap->ping_jitter = static_cast<ms_t>(heap->rttvar + 0.5f);
+
+    /* the peer may hold back its ack for AckDelay */
+    float variance = 4.0f * heap->rttvar;
+    if (variance < ClockGranularity) {
+        variance = ClockGranularity;
+    }
+    ms_t timeout = static_cast<ms_t>(heap->srtt + variance) + AckDelay;
+    if (timeout < MinResendTimeout) {
+        timeout = MinResendTimeout;
+    } else if (timeout > MaxResendTimeout) {
+        timeout = MaxResendTimeout;
+    }
+    heap->resend_timeout = timeout;
+}
+
+void MessageSequencer::update_loss(SequencerHeap *heap, sequence_no_t lost) {
+    /* gaps in the unreliable sequence numbers are lost packets */
+    if (lost > 16) {
+        lost = 16;
+    }
+    for (sequence_no_t i = 0; i < lost; i++) {
+        heap->packet_loss += (1.0f - heap->packet_loss) * LossGain;
+    }
+    heap->packet_loss -= heap->packet_loss * LossGain;
+}
+
+size_t MessageSequencer::loss_window(const SequencerHeap *heap) const {
+    /* a lossy link gets fewer reliable messages in flight, the loss */
+    /* of the incoming direction stands in for the outgoing one     */
+    size_t window = static_cast<size_t>(send_window / (1.0f + heap->packet_loss * LossBackoff));
+    if (window < MinSendWindow) {
+        window = (send_window < MinSendWindow ? send_window : MinSendWindow);
+    }
+
+    return window;
+}
+
+void MessageSequencer::process_incoming(SequencerHeap *heap, NetMessage *msg) throw (Exception) {
+    NetMessageData *data = reinterpret_cast<NetMessageData *>(msg->data);
+
+    switch (msg->cmd) {
         case NetCommandLogin:
         {
             if (!is_client) {
@@ -370,72 +911,171 @@ void MessageSequencer::process_incoming(SequencerHeap *heap, NetMessage *msg) th
     }
 }
 
-void MessageSequencer::sorted_insert(SequencerHeap::QueuedMessages& msg_queue,
-QueueMessage *smsg)
-{
-    SequencerHeap::QueuedMessages::iterator it;
-    for (it = msg_queue.begin(); it != msg_queue.end(); it++) {
-        QueueMessage *tmp_smsg = *it;
-        if (tmp_smsg->seq_no > smsg->seq_no) {
-            break;
-        }
+bool MessageSequencer::deflatable(SequencerHeap *heap, command_t cmd, data_len_t len) const {
+    /* the peer inflates at most one byte less than a slot */
+    return (heap->peer_inflates && cmd == NetCommandData && len >= DeflateThreshold &&
+        len < MessageSlotSize - MsgHeaderLength);
+}
+
+data_len_t MessageSequencer::deflate(data_len_t len, const void *data, void *out) {
+    /* only worth it, if it gets smaller */
+    return static_cast<data_len_t>(deflater.deflate(data, len, out, len - 1));
+}
+
+SequencerHeap *MessageSequencer::create_heap(hostaddr_t host, hostport_t port) {
+    /* oldest retired heap first, and only after its quarantine */
+    SequencerHeap *heap;
+    gametime_t now;
+    get_now(now);
+    if (free_heaps.size() && diff_ms(free_heaps.front()->retired, now) >= HeapQuarantine) {
+        heap = free_heaps.front();
+        free_heaps.pop_front();
+        heap->reset(host, port);
+    } else {
+        heap = new SequencerHeap(slab, host, port);
     }
-    msg_queue.insert(it, smsg);
+    heap->slot = heaps.size();
+    heaps.push_back(heap);
+    index_heap(heap);
+
+    return heap;
 }
 
 SequencerHeap *MessageSequencer::find_heap(hostaddr_t host, hostport_t port) {
-    for (SequencerHeaps::iterator it = heaps.begin(); it != heaps.end(); it++) {
-        SequencerHeap *heap = *it;
+    size_t mask = heap_index.size() - 1;
+    size_t pos = index_position(host, port);
+    while (SequencerHeap *heap = heap_index[pos]) {
         if (heap->host == host && heap->port == port) {
             return heap;
         }
+        pos = (pos + 1) & mask;
     }
 
     return 0;
 }
 
 SequencerHeap *MessageSequencer::find_heap(const Connection *c) {
-    for (SequencerHeaps::iterator it = heaps.begin(); it != heaps.end(); it++) {
-        if (*it == c) {
-            return static_cast<SequencerHeap *>(const_cast<Connection *>(c));
+    /* heaps are never freed before the sequencer dies, so a stale */
+    /* connection pointer can be inspected. it is rejected during  */
+    /* the quarantine, a recycled heap is a different connection.  */
+    if (c) {
+        const SequencerHeap *heap = static_cast<const SequencerHeap *>(c);
+        if (heap->slot < heaps.size() && heaps[heap->slot] == heap) {
+            return heaps[heap->slot];
         }
     }
 
     return 0;
 }
 
-void MessageSequencer::delete_heap(SequencerHeap *heap) {
-    flush_queues(heap);
-    for (SequencerHeaps::iterator it = heaps.begin(); it != heaps.end(); it++) {
-        SequencerHeap *h = *it;
-        if (h == heap) {
-            flush_queues(heap);
-            delete heap;
-            heaps.erase(it);
+size_t MessageSequencer::index_position(hostaddr_t host, hostport_t port) const {
+    uint32_t key = (host ^ (static_cast<uint32_t>(port) << 16 | port)) * 2654435761U;
+
+    return static_cast<size_t>(key ^ (key >> 16)) & (heap_index.size() - 1);
+}
+
+void MessageSequencer::index_heap(SequencerHeap *heap) {
+    size_t mask = heap_index.size() - 1;
+    size_t pos = index_position(heap->host, heap->port);
+    while (heap_index[pos]) {
+        pos = (pos + 1) & mask;
+    }
+    heap_index[pos] = heap;
+}
+
+void MessageSequencer::unindex_heap(SequencerHeap *heap) {
+    size_t mask = heap_index.size() - 1;
+    size_t hole = index_position(heap->host, heap->port);
+    while (heap_index[hole] != heap) {
+        if (!heap_index[hole]) {
+            return;
+        }
+        hole = (hole + 1) & mask;
+    }
+    heap_index[hole] = 0;
+
+    /* backward shift deletion: pull up entries whose probe chain crosses the hole */
+    size_t pos = hole;
+    while (true) {
+        pos = (pos + 1) & mask;
+        SequencerHeap *h = heap_index[pos];
+        if (!h) {
             break;
         }
+        size_t home = index_position(h->host, h->port);
+        bool movable = (pos > hole ? (home <= hole || home > pos) : (home <= hole && home > pos));
+        if (movable) {
+            heap_index[hole] = h;
+            heap_index[pos] = 0;
+            hole = pos;
+        }
     }
 }
 
-void MessageSequencer::flush_queues(SequencerHeap *heap) {
-    SequencerHeap::QueuedMessages::iterator it;
+void MessageSequencer::delete_heap(SequencerHeap *heap) {
+    if (find_heap(heap)) {
+        flush_queues(heap);
+        unindex_heap(heap);
 
-    /* purge in_queue */
-    for (it = heap->in_queue.begin(); it != heap->in_queue.end(); it++) {
-        delete *it;
-    }
-    heap->in_queue.clear();
+        /* swap with last active heap to keep the list dense */
+        SequencerHeap *last = heaps.back();
+        heaps[heap->slot] = last;
+        last->slot = heap->slot;
+        heaps.pop_back();
 
-    /* purge out_queue */
-    for (it = heap->out_queue.begin(); it != heap->out_queue.end(); it++) {
-        delete *it;
+        heap->active = false;
+        get_now(heap->retired);
+        free_heaps.push_back(heap);
     }
-    heap->out_queue.clear();
+}
+
+void MessageSequencer::flush_queues(SequencerHeap *heap) {
+    heap->in_queue.clear(1);
+    heap->out_queue.clear(1);
 }
 
 void MessageSequencer::slack_send(hostaddr_t host, hostport_t port,
     sequence_no_t seq_no, flags_t flags, command_t cmd, data_len_t len,
     const void *data) throw (Exception)
+{
+    pmsg->ack = 0;
+    pmsg->ack_bits = 0;
+    pmsg->stamp = 0;
+    pmsg->echo = 0;
+    pmsg->echo_delay = 0;
+    send_message(host, port, seq_no, flags, cmd, len, data);
+}
+
+void MessageSequencer::slack_send(SequencerHeap *heap, sequence_no_t seq_no,
+    flags_t flags, command_t cmd, data_len_t len, const void *data) throw (Exception)
+{
+    gametime_t now;
+    get_now(now);
+
+    /* every packet to a heap carries our acks and ping stamps */
+    flags |= NetFlagsInflates;
+    pmsg->ack = heap->last_recv_rel_seq_no;
+    pmsg->ack_bits = selective_acks(heap);
+    pmsg->stamp = stamp_ms(now);
+    pmsg->echo = 0;
+    pmsg->echo_delay = 0;
+    if (heap->peer_stamp_valid) {
+        ms_t held = diff_ms(heap->peer_stamp_touch, now);
+        if (held < 65536) {
+            flags |= NetFlagsEcho;
+            pmsg->echo = heap->peer_stamp;
+            pmsg->echo_delay = static_cast<uint16_t>(held);
+        }
+    }
+    heap->ack_pending = false;
+    heap->last_send = now;
+
+    send_message(heap->host, heap->port, seq_no, flags, cmd, len, data);
+}
+
+void MessageSequencer::send_message(hostaddr_t host, hostport_t port,
+    sequence_no_t seq_no, flags_t flags, command_t cmd, data_len_t len,
+    const void *data) throw (Exception)
 {
     pmsg->seq_no = seq_no;
     pmsg->flags = flags;
@@ -453,8 +1093,6 @@ void MessageSequencer::slack_send(hostaddr_t host, hostport_t port,
 
 void MessageSequencer::delete_all_heaps() {
     while (heaps.size()) {
-        flush_queues(heaps[0]);
-        delete heaps[0];
-        heaps.erase(heaps.begin());
+        delete_heap(heaps.back());
     }
 }
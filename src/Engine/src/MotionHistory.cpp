@@ -0,0 +1,126 @@
+#include "MotionHistory.hpp"
+
+#include <cmath>
+
+MotionHistory::MotionHistory() : head(0), count(0) { }
+
+MotionHistory::~MotionHistory() { }
+
+void MotionHistory::clear() {
+    head = 0;
+    count = 0;
+}
+
+void MotionHistory::add(double time, double x, double y, double accel_x, double accel_y) {
+    if (count) {
+        const MotionSample& newest = at(count - 1);
+        if (time < newest.time) {
+            return;
+        }
+        if (std::fabs(x - newest.x) > MotionSnapDistance || std::fabs(y - newest.y) > MotionSnapDistance) {
+            clear();
+        } else if (time == newest.time) {
+            count--;
+        }
+    }
+
+    if (count == MotionHistorySize) {
+        head = (head + 1) % MotionHistorySize;
+        count--;
+    }
+
+    MotionSample& s = samples[(head + count) % MotionHistorySize];
+    s.time = time;
+    s.x = x;
+    s.y = y;
+    s.accel_x = accel_x;
+    s.accel_y = accel_y;
+    count++;
+}
+
+bool MotionHistory::sample(double time, double& x, double& y, double& accel_x, double& accel_y) const {
+    if (!count) {
+        return false;
+    }
+
+    /* ran out of states, continue the last motion for a short while */
+    const MotionSample& newest = at(count - 1);
+    if (time >= newest.time) {
+        double dt = time - newest.time;
+        if (dt > MotionMaxExtrapolation) {
+            dt = MotionMaxExtrapolation;
+        }
+        x = newest.x + newest.accel_x * dt / MotionVelocityPeriod;
+        y = newest.y + newest.accel_y * dt / MotionVelocityPeriod;
+        accel_x = newest.accel_x;
+        accel_y = newest.accel_y;
+        return true;
+    }
+
+    const MotionSample& oldest = at(0);
+    if (time <= oldest.time) {
+        x = oldest.x;
+        y = oldest.y;
+        accel_x = oldest.accel_x;
+        accel_y = oldest.accel_y;
+        return true;
+    }
+
+    int i = count - 2;
+    while (i > 0 && at(i).time > time) {
+        i--;
+    }
+    const MotionSample& a = at(i);
+    const MotionSample& b = at(i + 1);
+
+    /* cubic hermite, the velocities are the tangents */
+    double dt = b.time - a.time;
+    double s = (time - a.time) / dt;
+    double s2 = s * s;
+    double s3 = s2 * s;
+    double h00 = 2.0f * s3 - 3.0f * s2 + 1.0f;
+    double h10 = s3 - 2.0f * s2 + s;
+    double h01 = -2.0f * s3 + 3.0f * s2;
+    double h11 = s3 - s2;
+    double scale = dt / MotionVelocityPeriod;
+
+    x = h00 * a.x + h10 * a.accel_x * scale + h01 * b.x + h11 * b.accel_x * scale;
+    y = h00 * a.y + h10 * a.accel_y * scale + h01 * b.y + h11 * b.accel_y * scale;
+    accel_x = a.accel_x + (b.accel_x - a.accel_x) * s;
+    accel_y = a.accel_y + (b.accel_y - a.accel_y) * s;
+
+    return true;
+}
+
+bool MotionHistory::bumped(double from, double to, double velocity) const {
+    return stopped(from, to, velocity, true);
+}
+
+bool MotionHistory::landed(double from, double to, double velocity) const {
+    return stopped(from, to, velocity, false);
+}
+
+const MotionSample& MotionHistory::at(int index) const {
+    return samples[(head + index) % MotionHistorySize];
+}
+
+bool MotionHistory::stopped(double from, double to, double velocity, bool any_direction) const {
+    for (int i = 1; i < count; i++) {
+        const MotionSample& a = at(i - 1);
+        const MotionSample& b = at(i);
+        if (b.time > from && b.time <= to) {
+            if (a.accel_y > velocity && b.accel_y <= 0.0f) {
+                return true;
+            }
+            if (any_direction &&
+                ((a.accel_y < -velocity && b.accel_y >= 0.0f) ||
+                 (a.accel_x > velocity && b.accel_x <= 0.0f) ||
+                 (a.accel_x < -velocity && b.accel_x >= 0.0f)))
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,99 @@
+#include "NetReceiver.hpp"
+
+static const size_t ReceiverQueueSize = 512;  /* datagrams */
+static const size_t ReceiverBatchSize = 32;   /* datagrams per recvmmsg */
+static const int ReceiverWaitMs = 100;        /* granularity of stop() */
+
+NetReceiver::NetReceiver(hostport_t port) throw (Exception)
+    : socket(port, true), queue(ReceiverQueueSize), running(false), reactor(0)
+{
+    socket.set_batch_size(ReceiverBatchSize);
+}
+
+NetReceiver::~NetReceiver() {
+    stop();
+}
+
+void NetReceiver::start() throw (Exception) {
+    if (!running) {
+        running = true;
+        if (!thread_start()) {
+            running = false;
+            throw Exception("Starting network receiver thread failed.");
+        }
+    }
+}
+
+void NetReceiver::stop() {
+    if (running) {
+        running = false;
+        thread_join();
+    }
+}
+
+UDPSocket& NetReceiver::get_socket() {
+    return socket;
+}
+
+void NetReceiver::set_reactor(Reactor *reactor) {
+    ScopeMutex lock(reactor_mtx);
+    this->reactor = reactor;
+}
+
+const ReceivedDatagram *NetReceiver::front() {
+    return queue.front();
+}
+
+void NetReceiver::pop() {
+    queue.pop();
+}
+
+void NetReceiver::thread() {
+    while (running) {
+        try {
+            if (!socket.wait(ReceiverWaitMs)) {
+                continue;
+            }
+
+            bool pushed = false;
+            while (running) {
+                /* sequencer lags behind? drop like the wire would */
+                ReceivedDatagram *dgram = queue.back();
+                char *buffer = (dgram ? dgram->data : scratch);
+                hostaddr_t host;
+                hostport_t port;
+                ssize_t sz = socket.recv(buffer, UDPDatagramMaxSize, &host, &port);
+                if (sz <= 0) {
+                    break;
+                }
+                if (!dgram || sz < NetMessageHeaderLength) {
+                    continue;
+                }
+
+                NetMessage *msg = reinterpret_cast<NetMessage *>(buffer);
+                NetMessageData *data = reinterpret_cast<NetMessageData *>(msg->data);
+                msg->from_net();
+                data->from_net();
+                if (NetMessageHeaderLength + data->len > sz) {
+                    continue;   /* truncated */
+                }
+
+                dgram->host = host;
+                dgram->port = port;
+                dgram->len = static_cast<size_t>(sz);
+                queue.push();
+                pushed = true;
+            }
+
+            /* locked, so unwatch() waits for a wake in progress */
+            if (pushed) {
+                ScopeMutex lock(reactor_mtx);
+                if (reactor) {
+                    reactor->wake();
+                }
+            }
+        } catch (const Exception&) {
+            /* chuck it, keep receiving */
+        }
+    }
+}
@@ -0,0 +1,49 @@
+#include "PacketBuilder.hpp"
+
+PacketBuilder::PacketBuilder() : max_size(PacketMaxSize), size(0), last(0) { }
+
+PacketBuilder::~PacketBuilder() { }
+
+/* takes effect with the next message */
+void PacketBuilder::set_max_size(int max_size) {
+    this->max_size = (max_size > PacketSizeLimit ? PacketSizeLimit : max_size);
+}
+
+bool PacketBuilder::is_empty() const {
+    return (size == 0);
+}
+
+bool PacketBuilder::fits(data_len_t len) const {
+    return (size + GTransportLen + len <= max_size);
+}
+
+void PacketBuilder::append(unsigned char tournament_id, command_t cmd, data_len_t len, const void *data) {
+    if (last) {
+        last->flags |= TransportFlagMorePackets;
+    }
+
+    last = reinterpret_cast<GTransport *>(buffer + size);
+    last->cmd = cmd;
+    last->tournament_id = tournament_id;
+    last->flags = 0;
+    last->len = len;
+    if (len) {
+        memcpy(last->data, data, len);
+    }
+    last->to_net();
+
+    size += GTransportLen + len;
+}
+
+data_len_t PacketBuilder::get_size() const {
+    return static_cast<data_len_t>(size);
+}
+
+const void *PacketBuilder::get_data() const {
+    return buffer;
+}
+
+void PacketBuilder::clear() {
+    size = 0;
+    last = 0;
+}
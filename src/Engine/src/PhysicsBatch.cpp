@@ -0,0 +1,187 @@
+#include "PhysicsBatch.hpp"
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PHYSICS_BATCH_SSE2
+#include <emmintrin.h>
+#endif
+
+/* longer sweeps per axis go to the scalar resolver, in tiles */
+static const int MaxSweepTiles = 16;
+
+PhysicsBatch::PhysicsBatch() { }
+
+PhysicsBatch::~PhysicsBatch() { }
+
+void PhysicsBatch::clear() {
+    entities.clear();
+    pos_x.clear();
+    pos_y.clear();
+    accel_x.clear();
+    accel_y.clear();
+    gravity.clear();
+    box_left.clear();
+    box_width.clear();
+    box_bottom.clear();
+    box_height.clear();
+    free_lanes.clear();
+}
+
+void PhysicsBatch::add(const EntityHandle& entity, double x, double y, double accel_x, double accel_y,
+    const CollisionBox& colbox, int width, int height, bool gravity)
+{
+    entities.push_back(entity);
+    pos_x.push_back(x);
+    pos_y.push_back(y);
+    this->accel_x.push_back(accel_x);
+    this->accel_y.push_back(accel_y);
+    this->gravity.push_back(gravity ? 1.0f : 0.0f);
+    box_left.push_back(static_cast<double>(colbox.x));
+    box_width.push_back(static_cast<double>(colbox.width));
+    box_bottom.push_back(static_cast<double>(height - colbox.y));
+    box_height.push_back(static_cast<double>(colbox.height));
+}
+
+void PhysicsBatch::integrate(double period_f, double accel_gravity, double max_accel_y,
+    const CollisionGrid& grid, int tile_width, int tile_height, int map_width)
+{
+    size_t n = entities.size();
+    new_x.resize(n);
+    new_y.resize(n);
+    new_accel_y.resize(n);
+    border.resize(n);
+    cell_left.resize(n);
+    cell_top.resize(n);
+    cell_right.resize(n);
+    cell_bottom.resize(n);
+    free_lanes.resize(n);
+
+    double gravity_step = accel_gravity * period_f;
+    size_t i = 0;
+
+#ifdef PHYSICS_BATCH_SSE2
+    const __m128d zero = _mm_setzero_pd();
+    const __m128d one = _mm_set1_pd(1.0f);
+    const __m128d pf = _mm_set1_pd(period_f);
+    const __m128d gstep = _mm_set1_pd(gravity_step);
+    const __m128d max_ay = _mm_set1_pd(max_accel_y);
+    const __m128d mapw = _mm_set1_pd(static_cast<double>(map_width));
+    const __m128d tw = _mm_set1_pd(static_cast<double>(tile_width));
+    const __m128d th = _mm_set1_pd(static_cast<double>(tile_height));
+
+    for (; i + 2 <= n; i += 2) {
+        __m128d x = _mm_loadu_pd(&pos_x[i]);
+        __m128d y = _mm_loadu_pd(&pos_y[i]);
+        __m128d ax = _mm_loadu_pd(&accel_x[i]);
+        __m128d ay = _mm_loadu_pd(&accel_y[i]);
+
+        /* gravity, only for the falling lanes */
+        __m128d falls = _mm_cmpneq_pd(_mm_loadu_pd(&gravity[i]), zero);
+        __m128d ay_g = _mm_min_pd(_mm_add_pd(ay, gstep), max_ay);
+        ay = _mm_or_pd(_mm_and_pd(falls, ay_g), _mm_andnot_pd(falls, ay));
+
+        /* new position */
+        __m128d nx = _mm_add_pd(x, _mm_mul_pd(ax, pf));
+        __m128d ny = _mm_add_pd(y, _mm_mul_pd(ay, pf));
+        _mm_storeu_pd(&new_x[i], nx);
+        _mm_storeu_pd(&new_y[i], ny);
+        _mm_storeu_pd(&new_accel_y[i], ay);
+
+        /* map border */
+        __m128d bl = _mm_loadu_pd(&box_left[i]);
+        __m128d bw = _mm_loadu_pd(&box_width[i]);
+        __m128d out = _mm_or_pd(_mm_cmplt_pd(nx, _mm_sub_pd(zero, bl)),
+            _mm_cmpgt_pd(_mm_add_pd(_mm_add_pd(nx, bl), bw), mapw));
+        int mask = _mm_movemask_pd(out);
+        border[i] = mask & 1;
+        border[i + 1] = mask & 2;
+
+        /* swept box, one pixel more against rounding */
+        __m128d bb = _mm_loadu_pd(&box_bottom[i]);
+        __m128d bh = _mm_loadu_pd(&box_height[i]);
+        __m128d left = _mm_sub_pd(_mm_add_pd(_mm_min_pd(x, nx), bl), one);
+        __m128d right = _mm_add_pd(_mm_add_pd(_mm_max_pd(x, nx), _mm_add_pd(bl, bw)), one);
+        __m128d bottom = _mm_add_pd(_mm_add_pd(_mm_max_pd(y, ny), bb), one);
+        __m128d top = _mm_sub_pd(_mm_sub_pd(_mm_add_pd(_mm_min_pd(y, ny), bb), bh), one);
+
+        /* tiles counted like the scalar resolver does, int(v) / size */
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(&cell_left[i]),
+            _mm_cvttpd_epi32(_mm_div_pd(_mm_cvtepi32_pd(_mm_cvttpd_epi32(left)), tw)));
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(&cell_right[i]),
+            _mm_cvttpd_epi32(_mm_div_pd(_mm_cvtepi32_pd(_mm_cvttpd_epi32(right)), tw)));
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(&cell_top[i]),
+            _mm_cvttpd_epi32(_mm_div_pd(_mm_cvtepi32_pd(_mm_cvttpd_epi32(top)), th)));
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(&cell_bottom[i]),
+            _mm_cvttpd_epi32(_mm_div_pd(_mm_cvtepi32_pd(_mm_cvttpd_epi32(bottom)), th)));
+    }
+#endif
+
+    for (; i < n; i++) {
+        integrate_lane(i, period_f, gravity_step, max_accel_y, tile_width, tile_height, map_width);
+    }
+
+    /* the tile lookups stay scalar, gathering bytes does not pay */
+    for (i = 0; i < n; i++) {
+        free_lanes[i] = (!border[i] &&
+            is_empty(grid, cell_left[i], cell_top[i], cell_right[i], cell_bottom[i]));
+    }
+}
+
+bool PhysicsBatch::is_free(size_t lane, const EntityHandle& entity) const {
+    return (lane < free_lanes.size() && entities[lane] == entity && free_lanes[lane]);
+}
+
+void PhysicsBatch::get_move(size_t lane, double& x, double& y, double& accel_y) const {
+    x = new_x[lane];
+    y = new_y[lane];
+    accel_y = new_accel_y[lane];
+}
+
+void PhysicsBatch::integrate_lane(size_t i, double period_f, double gravity_step,
+    double max_accel_y, int tile_width, int tile_height, int map_width)
+{
+    double x = pos_x[i];
+    double y = pos_y[i];
+    double ay = accel_y[i];
+
+    if (gravity[i] != 0.0f) {
+        ay += gravity_step;
+        if (ay > max_accel_y) {
+            ay = max_accel_y;
+        }
+    }
+
+    double nx = x + (accel_x[i] * period_f);
+    double ny = y + (ay * period_f);
+    new_x[i] = nx;
+    new_y[i] = ny;
+    new_accel_y[i] = ay;
+
+    border[i] = (nx < -box_left[i] || nx + box_left[i] + box_width[i] > map_width);
+
+    double left = std::min(x, nx) + box_left[i] - 1.0f;
+    double right = std::max(x, nx) + (box_left[i] + box_width[i]) + 1.0f;
+    double bottom = std::max(y, ny) + box_bottom[i] + 1.0f;
+    double top = std::min(y, ny) + box_bottom[i] - box_height[i] - 1.0f;
+    cell_left[i] = static_cast<int>(left) / tile_width;
+    cell_right[i] = static_cast<int>(right) / tile_width;
+    cell_top[i] = static_cast<int>(top) / tile_height;
+    cell_bottom[i] = static_cast<int>(bottom) / tile_height;
+}
+
+bool PhysicsBatch::is_empty(const CollisionGrid& grid, int left, int top, int right, int bottom) {
+    if (right - left >= MaxSweepTiles || bottom - top >= MaxSweepTiles) {
+        return false;
+    }
+
+    for (int y = top; y <= bottom; y++) {
+        for (int x = left; x <= right; x++) {
+            if (grid.get(x, y) != CollisionCellEmpty) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
@@ -1,14 +1,21 @@
 #include "Player.hpp"
 
+#include <cstring>
+
 Player::Player(Resources& resources, const Connection *c, player_id_t player_id,
     const std::string& player_name, const std::string& characterset_name)
     : resources(resources), c(c), player_id(player_id), player_name(player_name),
       characterset(resources.get_characterset(characterset_name)),
       animation_counter(0.0f), font(0), player_name_width(0), its_me(false),
-      respawning(false), joining(false), force_broadcast(false),
+      respawning(false), joining(false),
       flag_pick_refused_counter(0), flag_pick_refused(false), client_synced(false),
-      server_force_quit_client(false), server_force_quit_client_counter(0)
+      server_force_quit_client(false), server_force_quit_client_counter(0),
+      snapshot_acked(false), snapshot_ack_no(0), snapshot_trimmed(false), spawn_no(0), spawn_index(0),
+      input_received(false), input_no(0), input_acked(false),
+      input_stalled(false), input_extrapolated(0), input_spawned(false),
+      interpolation_delay(0.0f)
 {
+    memset(&input, 0, GPlayerInputLen);
     reset();
 }
 
@@ -48,6 +55,12 @@ void Player::spawn(int x, int y) {
     state.client_server_state.y = static_cast<double>(y);
 }
 
+void Player::place(int x, int y) {
+    clean_motion();
+    state.client_server_state.x = static_cast<double>(x);
+    state.client_server_state.y = static_cast<double>(y);
+}
+
 bool Player::is_alive_and_playing() const {
     return (!(state.server_state.flags & (PlayerServerFlagDead | PlayerServerFlagSpectating)));
 }
@@ -75,12 +88,18 @@ void Player::clean_states() {
     state.server_state.bombs = 0;
     state.server_state.grenades = 0;
     state.server_state.frogs = 0;
+    clean_motion();
+    flag_pick_refused_counter = 0.0;
+    flag_pick_refused = false;
+}
+
+void Player::clean_motion() {
     state.client_server_state.accel_x = 0.0f;
     state.client_server_state.accel_y = 0.0f;
     state.client_server_state.jump_accel_y = 0.0f;
     last_falling_y_pos = PlayerFallingTestMaxY;
-    flag_pick_refused_counter = 0.0;
-    flag_pick_refused = false;
+    motion.clear();
+    hitboxes.clear();
 }
 
 void Player::reset_states() {
@@ -9,14 +9,29 @@
 #include <cstdio>
 #include <cerrno>
 
-const ns_t CycleS = 1000000000;
-
 const int CalcCyclesPerS = 60; /* 60Hz */
-const ns_t CalcCycleNS = CycleS / CalcCyclesPerS;
 
 const int BroadcastsPerS = 15;
 const int BroadcastCount = CalcCyclesPerS / BroadcastsPerS;
 
+const size_t NetIOBatchSize = 32; /* datagrams per recvmmsg/sendmmsg */
+const int NetCycleBudget = 256;   /* datagrams per loop, then simulate */
+
+const int MasterHeartbeatTicks = 5 * CalcCyclesPerS;
+const int ForceQuitTicks = 3;
+const int ScoreBoardTicks = 30 * CalcCyclesPerS;
+const int MaxCatchUpTicks = 5;
+const size_t PlayerInputQueueMax = 6; /* ticks */
+
+/* interest management, the client's view is 640x340 pixels */
+const int InterestViewWidth = 640;
+const int InterestViewHeight = 340;
+const int InterestMarginTiles = 6;
+const int InterestFarInterval = 8;  /* broadcasts */
+
+/* GSnapshot counts its parts in a byte */
+const size_t SnapshotMaxParts = 255;
+
 const char *logout_messages[] = {
     "gone, gone... gone",
     "ended in smoke",
@@ -46,13 +61,17 @@ Server::Server(Resources& resources, Subsystem& subsystem,
     GamePlayType type, const std::string& map_name, int duration, int warmup) throw (Exception)
     : Properties(""), ClientServer(port, num_players, server_name, ""),
       resources(resources), subsystem(subsystem),
-      factory(resources, subsystem, 0),
+      strings(resources), factory(resources, strings, subsystem, 0),
       nbr_logout_msg(0), running(false), current_config(0), score_board_counter(0),
       warmup(false), hold_disconnected_players(false), reconnect_kills(0),
       hdp_counter(0), master_server(0), ms_counter(0), master_socket(),
       rotation_current_index(0), team_red_name(DefaultTeamRed), team_blue_name(DefaultTeamBlue),
-      log_file(0), logger(subsystem.get_stream(), true)
+      log_file(0), logger(subsystem.get_stream(), true),
+      tick_scheduler(CalcCyclesPerS, MaxCatchUpTicks), tick_statistics(0),
+      snapshot_no(0), snapshot_time(0)
 {
+    set_io_batch_size(NetIOBatchSize);
+    strings.build();
     map_configs.push_back(MapConfiguration(type, map_name, duration, warmup));
 }
 
@@ -60,9 +79,10 @@ Server::Server(Resources& resources, Subsystem& subsystem,
 Server::Server(Resources& resources, Subsystem& subsystem,
     const std::string& server_config_file) throw (Exception)
     : Properties(server_config_file),
-      ClientServer(atoi(get_value("port").c_str()), atoi(get_value("num_players").c_str()), get_value("server_name"), get_value("server_password")),
+      ClientServer(atoi(get_value("port").c_str()), atoi(get_value("num_players").c_str()), get_value("server_name"), get_value("server_password"),
+          std::max(0, atoi(get_value("net_receive_threads").c_str()))),
       resources(resources), subsystem(subsystem),
-      factory(resources, subsystem, 0),
+      strings(resources), factory(resources, strings, subsystem, 0),
       nbr_logout_msg(0), running(false), current_config(0), score_board_counter(0),
       warmup(false), hold_disconnected_players(atoi(get_value("hold_disconnected_player").c_str()) != 0 ? true : false),
       reconnect_kills(atoi(get_value("reconnect_kills").c_str())),
@@ -70,8 +90,15 @@ Server::Server(Resources& resources, Subsystem& subsystem,
       ms_counter(0), master_socket(), rotation_current_index(0),
       team_red_name(get_value("clan_red_name")),
       team_blue_name(get_value("clan_blue_name")),
-      log_file(0), logger(create_log_stream(), true)
+      log_file(0), logger(create_log_stream(), true),
+      tick_scheduler(CalcCyclesPerS, MaxCatchUpTicks),
+      tick_statistics(std::max(0, atoi(get_value("tick_statistics").c_str()))),
+      snapshot_no(0), snapshot_time(0)
 {
+    set_io_batch_size(NetIOBatchSize);
+    set_packet_size(atoi(get_value("packet_size").c_str()));
+    strings.build();
+
     char kvb[128];
     int map_count = atoi(get_value("map_count").c_str());
     if (map_count < 1) {
@@ -137,6 +164,11 @@ void Server::start() throw (ServerException) {
     running = true;
     thread();
 #else
+    start_threaded();
+#endif
+}
+
+void Server::start_threaded() throw (ServerException) {
     if (!running) {
         running = true;
         if (!thread_start()) {
@@ -144,12 +176,19 @@ void Server::start() throw (ServerException) {
             throw ServerException("Starting server thread failed.");
         }
     }
-#endif
+}
+
+void Server::join() {
+    if (running) {
+        thread_join();
+        running = false;
+    }
 }
 
 void Server::stop() {
     if (running) {
         running = false;
+        reactor.wake();
         thread_join();
     }
 }
@@ -168,37 +207,37 @@ void Server::thread() {
 
         /* start */
         gametime_t now;
-        gametime_t last;
-
-        ns_t diff_now = 0;
-        ns_t diff_last = 0;
-        ms_t diff_milliseconds = 0;
+        const ns_t tick_ns = tick_scheduler.get_tick_ns();
 
         /* init */
-        get_now(last);
+        tick_scheduler.reset();
+        watch(reactor);
 
         /* loop */
         int send_counter = 0;
         while (running) {
             try {
-                /* process incoming messages */
+                /* process incoming messages, bursts must not stall the simulation */
+                int budget = NetCycleBudget;
                 try {
-                    while (cycle());
+                    while (budget && cycle()) {
+                        budget--;
+                    }
                 } catch (const Exception& e) {
                     subsystem << e.what() << std::endl;
                 }
 
-                /* time over? */
-                get_now(now);
-                diff_now = diff_ns(last, now) + diff_last;
-                if (diff_now >= CalcCycleNS) {
-                    diff_milliseconds = diff_ms(last, now);
-                    diff_last = diff_now - CalcCycleNS;
-                    last = now;
-
+                /* run all due ticks */
+                while (tick_scheduler.next_tick()) {
                     /* tournament update */
                     if (tournament) {
-                        tournament->update_states(diff_now);
+                        for (Players::iterator it = players.begin(); it != players.end(); it++) {
+                            next_input(*it);
+                        }
+                        tournament->update_states(tick_ns);
+                        for (Players::iterator it = players.begin(); it != players.end(); it++) {
+                            input_spawn(*it);
+                        }
                         Tournament::StateResponses& responses = tournament->get_state_responses();
                         size_t sz = responses.size();
                         for (size_t i = 0; i < sz; i++) {
@@ -211,8 +250,10 @@ void Server::thread() {
                         for (Players::iterator it = players.begin(); it != players.end(); it++) {
                             Player *p = *it;
                             if (p->client_synced) {
-                                if (p->respawning) {
+                                /* wait, until the spawn of the client arrived */
+                                if (p->respawning && p->input_spawned) {
                                     p->respawning = false;
+                                    p->input_spawned = false;
                                     if (!p->is_alive_and_playing()) {
                                         p->state.server_state.flags &= PlayerServerFlagTeamRed;
                                         p->zero();
@@ -225,9 +266,6 @@ void Server::thread() {
                                 }
                             }
                         }
-
-                        /* flush */
-                        flush_stacked_broadcast_data_synced(NetFlagsReliable);
                     }
 
                     bool new_tournament = false;
@@ -239,7 +277,7 @@ void Server::thread() {
                                 new_tournament = true;
                             } else {
                                 /* count down score board */
-                                score_board_counter -= diff_milliseconds;
+                                score_board_counter--;
                                 if (score_board_counter <= 0) {
                                     score_board_counter = 0;
                                     new_tournament = true;
@@ -337,9 +375,6 @@ void Server::thread() {
                             } else {
                                 logger.log(ServerLogger::LogTypeGameBegins, "game begins");
                             }
-
-                            /* flush */
-                            flush_stacked_broadcast_data_synced(NetFlagsReliable);
                         }
                     } else {
                         /* broadcast */
@@ -356,76 +391,15 @@ void Server::thread() {
                                 gmstat.to_net();
                                 stacked_broadcast_data_synced(factory.get_tournament_id(), GPCUpdateGameState, 0, GGameStateLen, &gmstat);
 
-                                /* update player position and state */
+                                /* update players, objects, animations and npcs */
                                 done = true;
-                                if (players.size()) {
-                                    GPTAllStates stat;
-                                    for (Players::iterator it = players.begin(); it != players.end(); it++) {
-                                        Player *p = *it;
-                                        if (p->client_synced) {
-                                            const Connection *c = p->get_connection();
-                                            if (c) {
-                                                p->state.server_state.ping_time = static_cast<pico_size_t>(c->ping_time);
-                                            }
-                                            stat.id = p->state.id;
-                                            stat.server_state = p->state.server_state;
-                                            stat.client_server_state = p->state.client_server_state;
-                                            stat.to_net();
-                                            stacked_broadcast_data_synced(factory.get_tournament_id(), GPCUpdatePlayerState, 0, GPTAllStatesLen, &stat);
-                                        }
-                                    }
-                                }
-
-                                /* update objects */
-                                GObjectState objstat;
-                                Tournament::GameObjects& objects = tournament->get_game_objects();
-                                for (Tournament::GameObjects::iterator it = objects.begin();
-                                    it != objects.end(); it++)
-                                {
-                                    GameObject *obj = *it;
-                                    if (obj->object->get_physics()) {
-                                        objstat = obj->state;
-                                        objstat.to_net();
-                                        stacked_broadcast_data_synced(factory.get_tournament_id(), GPCUpdateObject, 0, GObjectStateLen, &objstat);
-                                    }
-                                }
-
-                                /* update animations */
-                                /* -> have to discuss, if these animations must be populated */
-                                /* -> every cycle. all animations are rendered clientside */
-                                GAnimationState anistat;
-                                Tournament::GameAnimations& animations = tournament->get_game_animations();
-                                for (Tournament::GameAnimations::iterator it = animations.begin();
-                                    it != animations.end(); it++)
-                                {
-                                    GameAnimation *ani = *it;
-                                    if (ani->animation->get_physics()) {
-                                       anistat = ani->state;
-                                       anistat.to_net();
-                                       stacked_broadcast_data_synced(factory.get_tournament_id(), GPCUpdateAnimation, 0, GAnimationStateLen, &anistat);
-                                    }
-                                }
-
-                                /* update spawnable npcs */
-                                GNPCState npcstat;
-                                Tournament::SpawnableNPCs& spawnable_npcs = tournament->get_spawnable_npcs();
-                                for (Tournament::SpawnableNPCs::iterator it = spawnable_npcs.begin();
-                                    it != spawnable_npcs.end(); it++)
-                                {
-                                    SpawnableNPC *npc = *it;
-                                    npcstat = npc->state;
-                                    npcstat.to_net();
-                                    stacked_broadcast_data_synced(factory.get_tournament_id(), GPCUpdateSpawnableNPC, 0, GNPCStateLen, &npcstat);
-                                }
+                                broadcast_snapshot();
                             }
-                            /* flush */
-                            flush_stacked_broadcast_data_synced(0);
                         }
 
                         /* special player broadcasts? */
                         if (!done) {
                             GPTAllStates stat;
-                            bool force_broadcast = false;
                             for (Players::iterator it = players.begin(); it != players.end(); it++) {
                                 Player *p = *it;
                                 if (p->client_synced) {
@@ -435,18 +409,14 @@ void Server::thread() {
                                     }
                                     if (p->state.client_server_state.flags & PlayerClientServerFlagForceBroadcast) {
                                         p->state.client_server_state.flags &= ~PlayerClientServerFlagForceBroadcast;
-                                        force_broadcast = true;
                                         stat.id = p->state.id;
                                         stat.server_state = p->state.server_state;
-                                        stat.client_server_state = p->state.client_server_state;
+                                        stat.client_server_state.pack(p->state.client_server_state);
                                         stat.to_net();
                                         stacked_broadcast_data_synced(factory.get_tournament_id(), GPCUpdatePlayerState, 0, GPTAllStatesLen, &stat);
                                     }
                                 }
                             }
-                            if (force_broadcast) {
-                                flush_stacked_broadcast_data_synced(0);
-                            }
                         }
 
                         /* delete old held player stats */
@@ -456,7 +426,7 @@ void Server::thread() {
                                 it != held_player_stats.end(); it++)
                             {
                                 PlayerStats *ps = *it;
-                                ms_t diff = diff_ms(ps->disconnect_time, now);
+                                ms_t diff = diff_ms(ps->disconnect_time, tick_scheduler.get_tick_start());
                                 /* 60 seconds */
                                 if (diff > 60000) {
                                     delete ps;
@@ -466,32 +436,47 @@ void Server::thread() {
                             }
                         }
                     }
-                }
 
-                /* update master server all 5 seconds */
-                if (master_server) {
-                    ms_counter++;
-                    if (ms_counter >= 10000) {
-                        ms_counter = 0;
-                        sprintf(msbuf, "%hu", get_port());
-                        master_socket.send(master_server, 25112, msbuf, strlen(msbuf));
+                    /* update master server all 5 seconds */
+                    if (master_server) {
+                        ms_counter++;
+                        if (ms_counter >= MasterHeartbeatTicks) {
+                            ms_counter = 0;
+                            sprintf(msbuf, "%hu", get_port());
+                            master_socket.send(master_server, 25112, msbuf, strlen(msbuf));
+                        }
                     }
-                }
 
-                /* delayed force quit clients? (once per cycle) */
-                for (Players::iterator it = players.begin(); it != players.end(); it++) {
-                    Player *p = *it;
-                    if (p->server_force_quit_client) {
-                        p->server_force_quit_client_counter--;
-                        if (!p->server_force_quit_client_counter) {
-                            kill(p->get_connection());
-                            break;
+                    /* delayed force quit clients? (once per tick) */
+                    for (Players::iterator it = players.begin(); it != players.end(); it++) {
+                        Player *p = *it;
+                        if (p->server_force_quit_client) {
+                            p->server_force_quit_client_counter--;
+                            if (!p->server_force_quit_client_counter) {
+                                kill(p->get_connection());
+                                break;
+                            }
                         }
                     }
+                    tick_scheduler.tick_done();
+
+                    /* simulation costs */
+                    const TickStatistics& stats = tick_scheduler.get_statistics();
+                    if (tick_statistics && stats.ticks >= static_cast<uint32_t>(tick_statistics) * CalcCyclesPerS) {
+                        subsystem << "tick statistics: " << stats.to_string() << std::endl;
+                        tick_scheduler.clear_statistics();
+                    }
                 }
 
-                /* wait for 1 ms */
-                wait_ns(1000000);
+                /* push out everything queued in this round */
+                flush_stacked_data();
+                flush();
+
+                /* sleep until the next datagram or tick, unless there is a backlog */
+                if (budget) {
+                    get_now(now);
+                    reactor.wait(tick_scheduler.until_next_tick(now));
+                }
             } catch (const Exception& e) {
                 subsystem << e.what() << std::endl;
                 broadcast_data(0, GPCServerQuit, NetFlagsReliable, strlen(e.what()), e.what());
@@ -500,10 +485,279 @@ void Server::thread() {
     } catch (const Exception& e) {
         subsystem << e.what() << std::endl;
     }
+    unwatch(reactor);
+}
+
+void Server::broadcast_snapshot() throw (Exception) {
+    snapshot_no++;
+    snapshot_time = static_cast<uint32_t>(tick_scheduler.get_tick_no() * 1000 / CalcCyclesPerS);
+    snapshot.start(snapshot_no, 1);
+
+    int tw = tournament->get_tileset()->get_tile_width();
+    int th = tournament->get_tileset()->get_tile_height();
+
+    /* players */
+    GPTAllStates stat;
+    for (Players::iterator it = players.begin(); it != players.end(); it++) {
+        Player *p = *it;
+        if (p->client_synced) {
+            const Connection *c = p->get_connection();
+            if (c) {
+                p->state.server_state.ping_time = static_cast<pico_size_t>(c->ping_time);
+            }
+            stat.id = p->state.id;
+            stat.server_state = p->state.server_state;
+            stat.client_server_state.pack(p->state.client_server_state);
+            stat.to_net();
+            snapshot.add(SnapshotKindPlayer, &stat,
+                static_cast<int>(p->state.client_server_state.x) / tw,
+                static_cast<int>(p->state.client_server_state.y) / th);
+        }
+    }
+
+    /* objects */
+    GObjectState objstat;
+    Tournament::GameObjects& objects = tournament->get_game_objects();
+    for (Tournament::GameObjects::iterator it = objects.begin(); it != objects.end(); it++) {
+        GameObject *obj = *it;
+        if (obj->object->get_physics()) {
+            objstat = obj->state;
+            objstat.to_net();
+            snapshot.add(SnapshotKindObject, &objstat,
+                static_cast<int>(obj->state.x) / tw, static_cast<int>(obj->state.y) / th);
+        }
+    }
+
+    /* animations */
+    /* -> have to discuss, if these animations must be populated */
+    /* -> every cycle. all animations are rendered clientside */
+    GAnimationState anistat;
+    Tournament::GameAnimations& animations = tournament->get_game_animations();
+    for (Tournament::GameAnimations::iterator it = animations.begin(); it != animations.end(); it++) {
+        GameAnimation *ani = *it;
+        if (ani->animation->get_physics()) {
+            anistat = ani->state;
+            anistat.to_net();
+            snapshot.add(SnapshotKindAnimation, &anistat,
+                static_cast<int>(ani->state.x) / tw, static_cast<int>(ani->state.y) / th);
+        }
+    }
+
+    /* spawnable npcs */
+    GNPCState npcstat;
+    Tournament::SpawnableNPCs& spawnable_npcs = tournament->get_spawnable_npcs();
+    for (Tournament::SpawnableNPCs::iterator it = spawnable_npcs.begin(); it != spawnable_npcs.end(); it++) {
+        SpawnableNPC *npc = *it;
+        npcstat = npc->state;
+        npcstat.to_net();
+        snapshot.add(SnapshotKindNPC, &npcstat,
+            static_cast<int>(npc->state.x) / tw, static_cast<int>(npc->state.y) / th);
+    }
+
+    snapshot.finish(0);
+
+    /* every client gets the delta against what it has seen last */
+    for (Players::iterator it = players.begin(); it != players.end(); it++) {
+        Player *p = *it;
+        if (p->client_synced && p->get_connection()) {
+            send_snapshot(p);
+            send_input_ack(p);
+        }
+    }
+}
+
+void Server::send_snapshot(Player *p) throw (Exception) {
+    Snapshot *baseline = (p->snapshot_acked ? p->snapshots.get_complete(p->snapshot_ack_no) : 0);
+    Snapshot& view = p->snapshots.slot(snapshot_no);
+    if (baseline == &view) {
+        baseline = 0;   /* acked too long ago, the slot is reused now */
+    }
+    view.start(snapshot_no, 1);
+
+    /* the expanded view rectangle around the player, in tiles.  */
+    /* spectators roam freely, they get everything at full rate. */
+    int tw = tournament->get_tileset()->get_tile_width();
+    int th = tournament->get_tileset()->get_tile_height();
+    bool everything = ((p->state.server_state.flags & PlayerServerFlagSpectating) != 0);
+    int view_x = static_cast<int>(p->state.client_server_state.x) / tw;
+    int view_y = static_cast<int>(p->state.client_server_state.y) / th;
+    int range_x = InterestViewWidth / 2 / tw + InterestMarginTiles;
+    int range_y = InterestViewHeight / 2 / th + InterestMarginTiles;
+
+    const Snapshot::Records& records = snapshot.get_records();
+    const Snapshot::Records *base_records = (baseline ? &baseline->get_records() : 0);
+    const size_t max_part_size = get_packet_size() - GTransportLen - GSnapshotLen;
+
+    /* encode changed and removed records, split into datagram sized parts */
+    size_t needed = records.size() * Snapshot::get_max_encoded_size() +
+        (base_records ? base_records->size() * Snapshot::get_max_encoded_size() : 0);
+    if (snapshot_buffer.size() < needed) {
+        snapshot_buffer.resize(needed);
+    }
+    snapshot_parts.clear();
+    snapshot_parts.push_back(0);
+
+    /* records not fitting into the last part are deferred, the */
+    /* view keeps their baseline, so they are sent next time.   */
+    /* players come first in the sort order, they always fit.   */
+    size_t pos = 0;
+    size_t base_index = 0;
+    size_t deferred = 0;
+    for (Snapshot::Records::const_iterator it = records.begin(); it != records.end(); it++) {
+        const SnapshotRecord& rec = *it;
+        const SnapshotRecord *base = 0;
+        if (base_records) {
+            size_t base_count = base_records->size();
+            while (base_index < base_count && (*base_records)[base_index] < rec) {
+                const SnapshotRecord& removed = (*base_records)[base_index];
+                if (!append_snapshot_part(pos, Snapshot::encode_removed(removed, &snapshot_buffer[pos]), max_part_size)) {
+                    view.add(removed);
+                    deferred++;
+                }
+                base_index++;
+            }
+            if (base_index < base_count && !(rec < (*base_records)[base_index])) {
+                base = &(*base_records)[base_index];
+            }
+        }
+
+        /* far away entities are refreshed round robin at a low rate. */
+        /* skipped ones stay in the view as the client still has them */
+        bool interesting = (everything || rec.kind == SnapshotKindPlayer ||
+            (abs(rec.tile_x - view_x) <= range_x && abs(rec.tile_y - view_y) <= range_y) ||
+            (snapshot_no + rec.id) % InterestFarInterval == 0);
+        if (!interesting) {
+            if (base) {
+                view.add(*base);
+            }
+            continue;
+        }
+
+        if (append_snapshot_part(pos, Snapshot::encode(rec, base, &snapshot_buffer[pos]), max_part_size)) {
+            view.add(rec);
+        } else {
+            if (base) {
+                view.add(*base);
+            }
+            deferred++;
+        }
+    }
+
+    /* whatever is left in the baseline is gone now */
+    if (base_records) {
+        for (; base_index < base_records->size(); base_index++) {
+            const SnapshotRecord& removed = (*base_records)[base_index];
+            if (!append_snapshot_part(pos, Snapshot::encode_removed(removed, &snapshot_buffer[pos]), max_part_size)) {
+                view.add(removed);
+                deferred++;
+            }
+        }
+    }
+    snapshot_parts.push_back(pos);
+    view.finish(0);
+
+    /* log only when a series of trimmed snapshots starts */
+    if (deferred && !p->snapshot_trimmed) {
+        subsystem << "snapshot for " << p->get_player_name() << " exceeds "
+            << SnapshotMaxParts << " parts, " << deferred << " records deferred" << std::endl;
+    }
+    p->snapshot_trimmed = (deferred != 0);
+
+    /* even an empty snapshot advances the baseline */
+    size_t parts = snapshot_parts.size() - 1;
+
+    data_t packet[PacketSizeLimit];
+    GSnapshot *gs = reinterpret_cast<GSnapshot *>(packet);
+    for (size_t i = 0; i < parts; i++) {
+        size_t sz = snapshot_parts[i + 1] - snapshot_parts[i];
+        gs->snapshot_no = snapshot_no;
+        gs->baseline_no = (baseline ? baseline->get_snapshot_no() : 0);
+        gs->server_time = snapshot_time;
+        gs->flags = (baseline ? SnapshotFlagDelta : 0);
+        gs->part = static_cast<unsigned char>(i);
+        gs->parts = static_cast<unsigned char>(parts);
+        memcpy(gs->data, &snapshot_buffer[snapshot_parts[i]], sz);
+        gs->to_net();
+        send_data(p->get_connection(), factory.get_tournament_id(), GPCSnapshot, 0,
+            static_cast<data_len_t>(GSnapshotLen + sz), gs);
+    }
+}
+
+bool Server::append_snapshot_part(size_t& pos, size_t sz, size_t max_part_size) {
+    if (sz) {
+        if (pos + sz - snapshot_parts.back() > max_part_size) {
+            if (snapshot_parts.size() >= SnapshotMaxParts) {
+                return false;
+            }
+            snapshot_parts.push_back(pos);
+        }
+        pos += sz;
+    }
+
+    return true;
+}
+
+void Server::next_input(Player *p) {
+    if (!p->client_synced || !p->input_received) {
+        p->input_stalled = true;
+        return;
+    }
+    p->input_stalled = false;
+
+    /* holding back inputs must not freeze the player, so it goes on */
+    /* with the last one. the client reconciles with the next ack.   */
+    if (p->inputs.empty()) {
+        p->input_extrapolated++;
+        return;
+    }
+
+    /* late inputs stand in for the extrapolated ticks and are */
+    /* skipped, the newest one carries the current spawn_no    */
+    while (p->input_extrapolated && p->inputs.size() > 1) {
+        p->inputs.pop_front();
+        p->input_extrapolated--;
+    }
+    p->input_extrapolated = 0;
+
+    p->input = p->inputs.front();
+    p->inputs.pop_front();
+    p->input_acked = true;
+
+    GPlayerClientServerState& state = p->state.client_server_state;
+    state.key_states = p->input.key_states;
+    state.jaxis = p->input.jaxis;
+    state.flags = (state.flags & ~PlayerClientServerFlagWriting) |
+        (p->input.flags & PlayerClientServerFlagWriting);
+}
+
+void Server::input_spawn(Player *p) {
+    /* the client spawned at the end of this input, which is only */
+    /* accepted, if the tournament lets this player spawn now     */
+    if (!p->input_stalled && p->input.spawn_no != p->spawn_no) {
+        p->spawn_no = p->input.spawn_no;
+        if (tournament->spawn_allowed(p) && tournament->spawn_player_at(p, p->input.spawn_index)) {
+            if (!p->is_alive_and_playing()) {
+                p->input_spawned = true;
+            }
+        }
+    }
+}
+
+void Server::send_input_ack(Player *p) throw (Exception) {
+    if (p->input_acked) {
+        GPlayerInputAck ack;
+        ack.input_no = p->input.input_no;
+        ack.client_flags = p->state.client_state.flags;
+        ack.last_falling_y_pos = static_cast<pos_t>(p->last_falling_y_pos);
+        ack.client_server_state = p->state.client_server_state;
+        ack.to_net();
+        send_data(p->get_connection(), factory.get_tournament_id(), GPCPlayerInputAck, 0, GPlayerInputAckLen, &ack);
+    }
 }
 
 void Server::event_login(const Connection *c, data_len_t len, void *data) throw (Exception) {
     GPlayerDescription *desc = reinterpret_cast<GPlayerDescription *>(data);
+    desc->from_net();
     desc->player_name[NameLength - 1] = 0;
     desc->characterset_name[NameLength - 1] = 0;
     size_t sz = players.size();
@@ -528,6 +782,8 @@ void Server::event_login(const Connection *c, data_len_t len, void *data) throw
     /* add new player */
     Player *p = new Player(resources, c, player_id, desc->player_name,
         desc->characterset_name);
+    int delay = (desc->interpolation_delay > MaxInterpolationDelay ? MaxInterpolationDelay : desc->interpolation_delay);
+    p->interpolation_delay = delay * 1000000.0f;
     players.push_back(p);
     sz++;
     std::string msg(p->get_player_name() + " connected");
@@ -623,13 +879,39 @@ void Server::event_data(const Connection *c, data_len_t len, void *data) throw (
         while (true) {
             t->from_net();
             switch (t->cmd) {
-                case GPSUpdatePlayerClientServerState:
+                case GPSPlayerInput:
                 {
                     if (t->tournament_id == factory.get_tournament_id()) {
                         if (p->client_synced) {
-                            GPlayerClientServerState *state = reinterpret_cast<GPlayerClientServerState *>(t->data);
-                            state->from_net();
-                            p->state.client_server_state = *state;
+                            GPlayerInput *inputs = reinterpret_cast<GPlayerInput *>(t->data);
+                            size_t n = t->len / GPlayerInputLen;
+                            for (size_t i = 0; i < n; i++) {
+                                GPlayerInput& input = inputs[i];
+                                input.from_net();
+                                if (!p->input_received || snapshot_newer(input.input_no, p->input_no)) {
+                                    p->input_received = true;
+                                    p->input_no = input.input_no;
+                                    p->inputs.push_back(input);
+                                }
+                            }
+
+                            /* don't let a burst delay this player for long */
+                            while (p->inputs.size() > PlayerInputQueueMax) {
+                                p->inputs.pop_front();
+                            }
+                        }
+                    }
+                    break;
+                }
+
+                case GPSSnapshotAck:
+                {
+                    GSnapshotAck *ack = reinterpret_cast<GSnapshotAck *>(t->data);
+                    ack->from_net();
+                    if (!snapshot_newer(ack->snapshot_no, snapshot_no)) {
+                        if (!p->snapshot_acked || snapshot_newer(ack->snapshot_no, p->snapshot_ack_no)) {
+                            p->snapshot_acked = true;
+                            p->snapshot_ack_no = ack->snapshot_no;
                         }
                     }
                     break;
@@ -881,7 +1163,8 @@ void Server::event_logout(const Connection *c, LogoutReason reason) throw (Excep
                 if (tournament) {
                     GAnimation ani;
                     memset(&ani, 0, sizeof(GAnimation));
-                    strncpy(ani.animation_name, "disappear", NameLength - 1);
+                    ani.animation_name_id = strings.get_id(StringTableAnimation, "disappear");
+                    ani.sound_name_id = StringIdNone;
                     const CollisionBox& colbox = p->get_characterset()->get_colbox();
                     ani.id = tournament->create_animation_id();
                     ani.x = p->state.client_server_state.x + colbox.x;
@@ -896,7 +1179,7 @@ void Server::event_logout(const Connection *c, LogoutReason reason) throw (Excep
                 Font *font = resources.get_font("normal");
                 GTextAnimation tani;
                 memset(&tani, 0, sizeof(GTextAnimation));
-                strncpy(tani.font_name, font->get_name().c_str(), NameLength - 1);
+                tani.font_name_id = strings.get_id(StringTableFont, font->get_name());
                 strncpy(tani.display_text, text.c_str(), TextLength - 1);
                 tani.x = p->state.client_server_state.x + (tg->get_width() / 2) - (font->get_text_width(text) / 2);
                 tani.y = p->state.client_server_state.y - (tg->get_height() / 2) - (font->get_font_height() / 2) - 15;
@@ -905,9 +1188,6 @@ void Server::event_logout(const Connection *c, LogoutReason reason) throw (Excep
                 stacked_broadcast_data_synced(factory.get_tournament_id(), GPCAddTextAnimation, NetFlagsReliable, GTextAnimationLen, &tani);
             }
 
-            /* flush */
-            flush_stacked_broadcast_data_synced(NetFlagsReliable);
-
             /* send text message */
             logger.log(ServerLogger::LogTypePlayerDisconnect, msg, p);
             broadcast_data(factory.get_tournament_id(), GPCTextMessage, NetFlagsReliable, static_cast<data_len_t>(msg.length()), msg.c_str());
@@ -918,6 +1198,7 @@ void Server::event_logout(const Connection *c, LogoutReason reason) throw (Excep
             /* delete player */
             players.erase(it);
             delete p;
+            discard_stacked_data(c);
             break;
         }
     }
@@ -956,7 +1237,7 @@ bool Server::select_map() {
 
     tournament = factory.create_tournament(*current_config, true, warmup, players, &logger);
     tournament->set_team_names(team_red_name, team_blue_name);
-    score_board_counter = 30000;
+    score_board_counter = ScoreBoardTicks;
 
     return switch_to_game;
 }
@@ -973,7 +1254,7 @@ void Server::cleanup_held_players() {
 void Server::quit_client(const Connection *c, Player *p, const std::string& message) {
     send_data(c, 0, GPCServerQuit, NetFlagsReliable, message.length(), message.c_str());
     p->server_force_quit_client = true;
-    p->server_force_quit_client_counter = 50;
+    p->server_force_quit_client_counter = ForceQuitTicks;
 }
 
 void Server::sync_client(const Connection *c, Player *p) {
@@ -986,6 +1267,21 @@ void Server::sync_client(const Connection *c, Player *p) {
         tournament->player_added(p);
     }
 
+    /* send resource names, from now on referred to by id */
+    GStringTableEntry entry;
+    for (int i = 0; i < _StringTableMAX; i++) {
+        StringTableKind kind = static_cast<StringTableKind>(i);
+        size_t sz = strings.get_count(kind);
+        for (size_t id = 0; id < sz; id++) {
+            memset(&entry, 0, GStringTableEntryLen);
+            entry.kind = static_cast<unsigned char>(kind);
+            entry.id = static_cast<stringid_t>(id);
+            strncpy(entry.name, strings.get_name(kind, entry.id).c_str(), NameLength - 1);
+            entry.to_net();
+            stacked_send_data(c, 0, GPCStringTable, NetFlagsReliable, GStringTableEntryLen, &entry);
+        }
+    }
+
     /* send current gameplay state */
     if (current_config) {
         GTournament gt;
@@ -1024,7 +1320,7 @@ void Server::sync_client(const Connection *c, Player *p) {
             GameObject *obj = *it;
             if (obj->spawned_object) {
                 memset(&so, 0, GSpawnObjectLen);
-                strncpy(so.object_name, obj->object->get_name().c_str(), NameLength - 1);
+                so.object_name_id = strings.get_id(StringTableObject, obj->object->get_name());
                 so.flags = 0;
                 so.id = obj->state.id;
                 so.x = static_cast<pos_t>(round(obj->state.x));
@@ -1050,7 +1346,8 @@ void Server::sync_client(const Connection *c, Player *p) {
             SpawnableNPC *npc = *it;
 
             memset(&npcspwn, 0, GSpawnNPCLen);
-            strncpy(npcspwn.npc_name, npc->npc->get_name().c_str(), NameLength - 1);
+            npcspwn.npc_name_id = strings.get_id(StringTableNPC, npc->npc->get_name());
+            npcspwn.sound_name_id = StringIdNone;
             npcspwn.id = npc->state.id;
             npcspwn.owner = npc->state.owner;
             npcspwn.direction = npc->state.direction;
@@ -1072,9 +1369,8 @@ void Server::sync_client(const Connection *c, Player *p) {
             GameAnimation *ani = *it;
             if (ani->animation->get_physics()) {
                 gani.id = ani->state.id;
-                memset(gani.animation_name, 0, NameLength);
-                strncpy(gani.animation_name, ani->animation->get_name().c_str(), NameLength - 1);
-                memset(gani.sound_name, 0, NameLength);
+                gani.animation_name_id = strings.get_id(StringTableAnimation, ani->animation->get_name());
+                gani.sound_name_id = StringIdNone;
                 gani.duration = ani->state.duration;
                 gani.owner = ani->state.owner;
                 gani.x = ani->state.x;
@@ -1085,9 +1381,6 @@ void Server::sync_client(const Connection *c, Player *p) {
                 stacked_send_data(c, factory.get_tournament_id(), GPCAddAnimation, NetFlagsReliable, GAnimationLen, &gani);
             }
         }
-
-        /* flush */
-        flush_stacked_send_data(c, NetFlagsReliable);
     }
 
     /* send generic states */
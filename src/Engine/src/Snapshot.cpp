@@ -0,0 +1,283 @@
+#include "Snapshot.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+/* field sizes of each kind behind the leading id, in struct order */
+static const unsigned char PlayerFields[] = {
+    2, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2,    /* GPlayerServerState */
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, /* GPlayerClientServerStatePacked */
+    0
+};
+static const unsigned char ObjectFields[] = { 8, 8, 8, 8, 0 };
+static const unsigned char AnimationFields[] = { 2, 2, 8, 8, 8, 8, 0 };
+static const unsigned char NPCFields[] = { 2, 1, 2, 8, 8, 8, 8, 0 };
+
+struct SnapshotLayout {
+    const unsigned char *fields;
+    size_t size;
+};
+
+static const SnapshotLayout Layouts[_SnapshotKindMAX] = {
+    { PlayerFields, GPTAllStatesLen },
+    { ObjectFields, GObjectStateLen },
+    { AnimationFields, GAnimationStateLen },
+    { NPCFields, GNPCStateLen }
+};
+
+static const size_t IdSize = sizeof(identifier_t);
+static const size_t MaxMaskSize = 4;
+
+static size_t field_count(const unsigned char *fields) {
+    size_t n = 0;
+    while (fields[n]) {
+        n++;
+    }
+
+    return n;
+}
+
+static size_t mask_size(unsigned char kind) {
+    return (field_count(Layouts[kind].fields) + 7) / 8;
+}
+
+Snapshot::Snapshot() : valid(false), complete(false), snapshot_no(0), parts(0) {
+    memset(parts_received, 0, sizeof(parts_received));
+}
+
+Snapshot::~Snapshot() { }
+
+void Snapshot::start(uint16_t snapshot_no, unsigned char parts) {
+    this->snapshot_no = snapshot_no;
+    this->parts = parts;
+    valid = true;
+    complete = false;
+    memset(parts_received, 0, sizeof(parts_received));
+    records.clear();
+    removed_records.clear();
+}
+
+void Snapshot::add(SnapshotKind kind, const void *net_data, int tile_x, int tile_y) {
+    SnapshotRecord rec;
+    rec.kind = static_cast<unsigned char>(kind);
+    rec.tile_x = tile_x;
+    rec.tile_y = tile_y;
+    memcpy(rec.data, net_data, Layouts[kind].size);
+    rec.id = ntohs(*reinterpret_cast<const uint16_t *>(rec.data));
+    records.push_back(rec);
+}
+
+void Snapshot::add(const SnapshotRecord& rec) {
+    records.push_back(rec);
+}
+
+void Snapshot::remove(unsigned char kind, uint16_t id) {
+    SnapshotRecord key;
+    key.kind = kind;
+    key.id = id;
+    removed_records.push_back(key);
+}
+
+void Snapshot::reset() {
+    valid = false;
+    complete = false;
+    records.clear();
+    removed_records.clear();
+}
+
+bool Snapshot::add_part(unsigned char part) {
+    uint32_t& bits = parts_received[part / 32];
+    uint32_t bit = 1u << (part % 32);
+    if (part >= parts || (bits & bit)) {
+        return false;
+    }
+    bits |= bit;
+
+    return true;
+}
+
+bool Snapshot::has_all_parts() const {
+    for (int i = 0; i < parts; i++) {
+        if (!(parts_received[i / 32] & (1u << (i % 32)))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void Snapshot::finish(const Snapshot *baseline) {
+    /* records missing in a delta snapshot did not change, */
+    /* unless the server explicitly removed them           */
+    if (baseline) {
+        const Records& base_records = baseline->get_records();
+        size_t sz = records.size();
+        std::sort(records.begin(), records.end());
+        std::sort(removed_records.begin(), removed_records.end());
+        for (Records::const_iterator it = base_records.begin(); it != base_records.end(); it++) {
+            if (!std::binary_search(records.begin(), records.begin() + sz, *it) &&
+                !std::binary_search(removed_records.begin(), removed_records.end(), *it))
+            {
+                records.push_back(*it);
+            }
+        }
+    }
+    std::sort(records.begin(), records.end());
+    removed_records.clear();
+    complete = true;
+}
+
+bool Snapshot::is_valid(uint16_t snapshot_no) const {
+    return (valid && this->snapshot_no == snapshot_no);
+}
+
+bool Snapshot::is_complete() const {
+    return complete;
+}
+
+uint16_t Snapshot::get_snapshot_no() const {
+    return snapshot_no;
+}
+
+const Snapshot::Records& Snapshot::get_records() const {
+    return records;
+}
+
+const SnapshotRecord *Snapshot::find(unsigned char kind, uint16_t id) const {
+    SnapshotRecord key;
+    key.kind = kind;
+    key.id = id;
+    Records::const_iterator it = std::lower_bound(records.begin(), records.end(), key);
+    if (it != records.end() && it->kind == kind && it->id == id) {
+        return &*it;
+    }
+
+    return 0;
+}
+
+size_t Snapshot::encode(const SnapshotRecord& rec, const SnapshotRecord *base, data_t *out) {
+    const unsigned char *fields = Layouts[rec.kind].fields;
+    size_t msz = mask_size(rec.kind);
+    unsigned char mask[MaxMaskSize];
+    memset(mask, 0, sizeof(mask));
+
+    data_t *p = out + 1 + IdSize + msz;
+    size_t ofs = IdSize;
+    for (size_t i = 0; fields[i]; i++) {
+        size_t fsz = fields[i];
+        if (!base || memcmp(rec.data + ofs, base->data + ofs, fsz)) {
+            mask[i / 8] |= (1 << (i % 8));
+            memcpy(p, rec.data + ofs, fsz);
+            p += fsz;
+        }
+        ofs += fsz;
+    }
+
+    if (base && p == out + 1 + IdSize + msz) {
+        return 0;
+    }
+
+    out[0] = rec.kind;
+    memcpy(out + 1, rec.data, IdSize);
+    memcpy(out + 1 + IdSize, mask, msz);
+
+    return static_cast<size_t>(p - out);
+}
+
+size_t Snapshot::encode_removed(const SnapshotRecord& base, data_t *out) {
+    out[0] = static_cast<data_t>(base.kind | SnapshotKindRemoved);
+    memcpy(out + 1, base.data, IdSize);
+
+    return 1 + IdSize;
+}
+
+size_t Snapshot::decode(const data_t *in, size_t len, const Snapshot *baseline,
+    SnapshotRecord& rec, bool& removed)
+{
+    if (len < 1 + IdSize) {
+        return 0;
+    }
+
+    removed = ((in[0] & SnapshotKindRemoved) != 0);
+    rec.kind = static_cast<unsigned char>(in[0] & ~SnapshotKindRemoved);
+    if (rec.kind >= _SnapshotKindMAX) {
+        return 0;
+    }
+
+    if (removed) {
+        memcpy(rec.data, in + 1, IdSize);
+        rec.id = ntohs(*reinterpret_cast<const uint16_t *>(rec.data));
+        return 1 + IdSize;
+    }
+
+    const unsigned char *fields = Layouts[rec.kind].fields;
+    size_t msz = mask_size(rec.kind);
+    if (len < 1 + IdSize + msz) {
+        return 0;
+    }
+
+    rec.tile_x = 0;
+    rec.tile_y = 0;
+    memset(rec.data, 0, sizeof(rec.data));
+    memcpy(rec.data, in + 1, IdSize);
+    rec.id = ntohs(*reinterpret_cast<const uint16_t *>(rec.data));
+    const data_t *mask = in + 1 + IdSize;
+
+    /* start over from the baseline */
+    if (baseline) {
+        const SnapshotRecord *base = baseline->find(rec.kind, rec.id);
+        if (base) {
+            memcpy(rec.data, base->data, Layouts[rec.kind].size);
+        }
+    }
+
+    const data_t *p = mask + msz;
+    size_t ofs = IdSize;
+    for (size_t i = 0; fields[i]; i++) {
+        size_t fsz = fields[i];
+        if (mask[i / 8] & (1 << (i % 8))) {
+            if (p + fsz > in + len) {
+                return 0;
+            }
+            memcpy(rec.data + ofs, p, fsz);
+            p += fsz;
+        }
+        ofs += fsz;
+    }
+
+    return static_cast<size_t>(p - in);
+}
+
+size_t Snapshot::get_record_size(unsigned char kind) {
+    return Layouts[kind].size;
+}
+
+size_t Snapshot::get_max_encoded_size() {
+    return 1 + IdSize + MaxMaskSize + SnapshotRecordSize;
+}
+
+SnapshotHistory::SnapshotHistory() { }
+
+SnapshotHistory::~SnapshotHistory() { }
+
+Snapshot& SnapshotHistory::slot(uint16_t snapshot_no) {
+    return snapshots[snapshot_no % SnapshotHistorySize];
+}
+
+Snapshot *SnapshotHistory::get(uint16_t snapshot_no) {
+    Snapshot& s = slot(snapshot_no);
+
+    return (s.is_valid(snapshot_no) ? &s : 0);
+}
+
+Snapshot *SnapshotHistory::get_complete(uint16_t snapshot_no) {
+    Snapshot *s = get(snapshot_no);
+
+    return (s && s->is_complete() ? s : 0);
+}
+
+void SnapshotHistory::clear() {
+    for (int i = 0; i < SnapshotHistorySize; i++) {
+        snapshots[i].reset();
+    }
+}
@@ -0,0 +1,93 @@
+#include "SpatialHash.hpp"
+
+#include <algorithm>
+
+static const int SpatialHashBuckets = 1024;    /* power of two */
+
+SpatialHash::SpatialHash(int cell_width, int cell_height)
+    : cell_width(cell_width), cell_height(cell_height),
+      buckets(SpatialHashBuckets, -1), query_no(0) { }
+
+SpatialHash::~SpatialHash() { }
+
+void SpatialHash::clear() {
+    std::fill(buckets.begin(), buckets.end(), -1);
+    nodes.clear();
+    entries.clear();
+    entry_handles.clear();
+    marks.clear();
+}
+
+void SpatialHash::insert(void *object, const CollisionBox& box, const EntityHandle& handle) {
+    int entry = static_cast<int>(entries.size());
+    entries.push_back(object);
+    entry_handles.push_back(handle);
+    marks.push_back(0);
+
+    /* boxes touching at their edges intersect, see CollisionBox */
+    int cx1 = get_cell(box.x, cell_width);
+    int cx2 = get_cell(box.x + box.width, cell_width);
+    int cy1 = get_cell(box.y, cell_height);
+    int cy2 = get_cell(box.y + box.height, cell_height);
+    for (int cy = cy1; cy <= cy2; cy++) {
+        for (int cx = cx1; cx <= cx2; cx++) {
+            int bucket = get_bucket(cx, cy);
+            Node node;
+            node.entry = entry;
+            node.next = buckets[bucket];
+            buckets[bucket] = static_cast<int>(nodes.size());
+            nodes.push_back(node);
+        }
+    }
+}
+
+void SpatialHash::query(const CollisionBox& box, Candidates& candidates, Handles *handles) {
+    candidates.clear();
+    if (handles) {
+        handles->clear();
+    }
+    if (entries.empty()) {
+        return;
+    }
+
+    /* marks say, which entries this query found already */
+    if (!++query_no) {
+        std::fill(marks.begin(), marks.end(), 0);
+        query_no = 1;
+    }
+
+    found.clear();
+    int cx1 = get_cell(box.x, cell_width);
+    int cx2 = get_cell(box.x + box.width, cell_width);
+    int cy1 = get_cell(box.y, cell_height);
+    int cy2 = get_cell(box.y + box.height, cell_height);
+    for (int cy = cy1; cy <= cy2; cy++) {
+        for (int cx = cx1; cx <= cx2; cx++) {
+            for (int n = buckets[get_bucket(cx, cy)]; n >= 0; n = nodes[n].next) {
+                int entry = nodes[n].entry;
+                if (marks[entry] != query_no) {
+                    marks[entry] = query_no;
+                    found.push_back(entry);
+                }
+            }
+        }
+    }
+
+    std::sort(found.begin(), found.end());
+    for (std::vector<int>::iterator it = found.begin(); it != found.end(); it++) {
+        candidates.push_back(entries[*it]);
+        if (handles) {
+            handles->push_back(entry_handles[*it]);
+        }
+    }
+}
+
+int SpatialHash::get_bucket(int cx, int cy) const {
+    unsigned int h = static_cast<unsigned int>(cx) * 73856093U ^ static_cast<unsigned int>(cy) * 19349663U;
+
+    return static_cast<int>(h & (SpatialHashBuckets - 1));
+}
+
+int SpatialHash::get_cell(int v, int size) {
+    return (v >= 0 ? v / size : -((-v + size - 1) / size));
+}
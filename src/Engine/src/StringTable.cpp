@@ -0,0 +1,136 @@
+#include "StringTable.hpp"
+
+static const char *KindNames[] = { "animation", "sound", "object", "npc", "font" };
+
+template<class T> static void add_names(StringTable& table, StringTableKind kind,
+    Resources::ResourceObjects& objects)
+{
+    stringid_t id = 0;
+    for (Resources::ResourceObjects::iterator it = objects.begin(); it != objects.end(); it++) {
+        if (id == StringIdNone) {
+            break;
+        }
+        table.add(kind, id++, static_cast<T *>(it->object)->get_name());
+    }
+}
+
+StringTable::StringTable(Resources& resources) : resources(resources) { }
+
+StringTable::~StringTable() { }
+
+void StringTable::build() {
+    clear();
+    add_names<Animation>(*this, StringTableAnimation, resources.get_animations());
+    add_names<Sound>(*this, StringTableSound, resources.get_sounds());
+    add_names<Object>(*this, StringTableObject, resources.get_objects());
+    add_names<NPC>(*this, StringTableNPC, resources.get_npcs());
+    add_names<Font>(*this, StringTableFont, resources.get_fonts());
+}
+
+void StringTable::clear() {
+    for (int i = 0; i < _StringTableMAX; i++) {
+        entries[i].clear();
+        ids[i].clear();
+    }
+}
+
+void StringTable::add(StringTableKind kind, stringid_t id, const std::string& name) {
+    if (id == StringIdNone) {
+        return;
+    }
+
+    Entries& e = entries[kind];
+    if (id >= e.size()) {
+        e.resize(id + 1);
+    }
+    e[id].name = name;
+    e[id].resource = lookup(kind, name);
+    ids[kind][name] = id;
+}
+
+void StringTable::resolve() {
+    for (int i = 0; i < _StringTableMAX; i++) {
+        StringTableKind kind = static_cast<StringTableKind>(i);
+        for (Entries::iterator it = entries[i].begin(); it != entries[i].end(); it++) {
+            it->resource = lookup(kind, it->name);
+        }
+    }
+}
+
+stringid_t StringTable::get_id(StringTableKind kind, const std::string& name) const {
+    Ids::const_iterator it = ids[kind].find(name);
+
+    return (it != ids[kind].end() ? it->second : StringIdNone);
+}
+
+size_t StringTable::get_count(StringTableKind kind) const {
+    return entries[kind].size();
+}
+
+const std::string& StringTable::get_name(StringTableKind kind, stringid_t id) const {
+    return entries[kind][id].name;
+}
+
+Animation *StringTable::get_animation(stringid_t id) const throw (ResourcesException) {
+    return static_cast<Animation *>(get(StringTableAnimation, id));
+}
+
+Sound *StringTable::get_sound(stringid_t id) const throw (ResourcesException) {
+    return static_cast<Sound *>(get(StringTableSound, id));
+}
+
+Object *StringTable::get_object(stringid_t id) const throw (ResourcesException) {
+    return static_cast<Object *>(get(StringTableObject, id));
+}
+
+NPC *StringTable::get_npc(stringid_t id) const throw (ResourcesException) {
+    return static_cast<NPC *>(get(StringTableNPC, id));
+}
+
+Font *StringTable::get_font(stringid_t id) const throw (ResourcesException) {
+    return static_cast<Font *>(get(StringTableFont, id));
+}
+
+void *StringTable::lookup(StringTableKind kind, const std::string& name) {
+    if (!name.length()) {
+        return 0;
+    }
+
+    try {
+        switch (kind) {
+            case StringTableAnimation:
+                return resources.get_animation(name);
+
+            case StringTableSound:
+                return resources.get_sound(name);
+
+            case StringTableObject:
+                return resources.get_object(name);
+
+            case StringTableNPC:
+                return resources.get_npc(name);
+
+            case StringTableFont:
+                return resources.get_font(name);
+
+            default:
+                break;
+        }
+    } catch (const ResourcesException&) {
+        /* not installed here, reported on use */
+    }
+
+    return 0;
+}
+
+void *StringTable::get(StringTableKind kind, stringid_t id) const throw (ResourcesException) {
+    const Entries& e = entries[kind];
+    if (id >= e.size()) {
+        throw ResourcesException(std::string(KindNames[kind]) + " id not found");
+    }
+    if (!e[id].resource) {
+        throw ResourcesException(std::string(KindNames[kind]) + " " + e[id].name + " not found");
+    }
+
+    return e[id].resource;
+}
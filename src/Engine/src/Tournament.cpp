@@ -1,14 +1,13 @@
 #include "Tournament.hpp"
 
-#include <algorithm>
 #include <cmath>
 #include <cstdlib>
 
-Tournament::Tournament(Resources& resources, Subsystem& subsystem, Gui *gui, ServerLogger *logger,
-    const std::string& game_file, bool server, const std::string& map_name,
+Tournament::Tournament(Resources& resources, StringTable& strings, Subsystem& subsystem, Gui *gui,
+    ServerLogger *logger, const std::string& game_file, bool server, const std::string& map_name,
     Players& players, int duration, bool warmup)
     throw (TournamentException, ResourcesException)
-      : resources(resources), subsystem(subsystem),
+      : resources(resources), strings(strings), subsystem(subsystem),
       properties(*resources.get_game_settings(game_file)),
       gui(gui), server(server),
       map(*resources.get_map(map_name)),
@@ -39,11 +38,20 @@ Tournament::Tournament(Resources& resources, Subsystem& subsystem, Gui *gui, Ser
       hud_bombs(resources.get_icon("bomb")),
       hud_frogs(resources.get_icon("frog")),
       enemy_indicator(resources.get_icon("enemy_indicator_neutral")),
-      game_over(false), logger(logger), gui_is_destroyed(false)
+      game_over(false), logger(logger), gui_is_destroyed(false),
+      interpolated(false), interpolation_time(0.0f), simulation_time(0.0f),
+      tick_start_x(0.0f), tick_start_y(0.0f), tick_start_view_x(spectator_x),
+      tick_start_view_y(spectator_y), blended(false), blend_saved_x(0.0f), blend_saved_y(0.0f),
+      player_hash(tile_width, tile_height), npc_hash(tile_width, tile_height),
+      object_hash(tile_width, tile_height), player_hash_valid(false),
+      npc_hash_valid(false), object_hash_valid(false)
 {
     /* init */
     char kvb[128];
 
+    /* flat tile lookups for all physics */
+    collision_grid.build(tileset, map_array, map_width, map_height);
+
     /* get parallax shift from map */
     int shift = map.get_parallax_shift();
     if (shift) {
@@ -58,9 +66,12 @@ Tournament::Tournament(Resources& resources, Subsystem& subsystem, Gui *gui, Ser
         const std::string& objname = map.get_value(kvb);
         if (objname.length()) {
             Object *obj = resources.get_object(objname);
-            GameObject *gobj = new GameObject;
+            GameObject *gobj = object_pool.acquire();
             gobj->picked = !server;
             gobj->object = obj;
+            gobj->tilegraphic = obj->get_tile()->get_tilegraphic();
+            gobj->width = gobj->tilegraphic->get_width();
+            gobj->height = gobj->tilegraphic->get_height();
             gobj->state.id = static_cast<identifier_t>(i);
             sprintf(kvb, "object_x%d", i);
             gobj->state.x = atoi(map.get_value(kvb).c_str()) * tile_width;
@@ -105,30 +116,12 @@ Tournament::Tournament(Resources& resources, Subsystem& subsystem, Gui *gui, Ser
 Tournament::~Tournament() {
     delete_responses();
 
-    for (GameAnimations::iterator it = game_animations.begin();
-        it != game_animations.end(); it++)
-    {
-        delete *it;
-    }
-
     for (GameTextAnimations::iterator it = game_text_animations.begin();
         it != game_text_animations.end(); it++)
     {
         delete *it;
     }
 
-    for (GameObjects::iterator it = game_objects.begin();
-        it != game_objects.end(); it++)
-    {
-        delete *it;
-    }
-
-    for (SpawnableNPCs::iterator it = spawnable_npcs.begin();
-        it != spawnable_npcs.end(); it++)
-    {
-        delete *it;
-    }
-
     if (logger) {
         logger->set_map(0);
     }
@@ -199,9 +192,8 @@ void Tournament::show_stats(bool state) {
 }
 
 void Tournament::add_animation(GAnimation *animation) {
-    GameAnimation *gani = 0;
     try {
-        Animation *ani = resources.get_animation(animation->animation_name);
+        Animation *ani = strings.get_animation(animation->animation_name_id);
 
         int shaker = ani->get_screen_shaker();
         if (shaker) {
@@ -217,8 +209,11 @@ void Tournament::add_animation(GAnimation *animation) {
                 bx = rand() % spread - spread / 2;
                 by = rand() % spread - spread / 2;
             }
-            gani = new GameAnimation;
+            GameAnimation *gani = animation_pool.acquire();
             gani->animation = ani;
+            gani->tilegraphic = ani->get_tile()->get_tilegraphic();
+            gani->width = gani->tilegraphic->get_width();
+            gani->height = gani->tilegraphic->get_height();
             gani->state.id = animation->id;
             gani->state.duration = animation->duration;
             gani->state.owner = animation->owner;
@@ -230,12 +225,11 @@ void Tournament::add_animation(GAnimation *animation) {
             game_animations.push_back(gani);
         }
         if (!server) {
-            if (strlen(animation->sound_name)) {
-                subsystem.play_sound(resources.get_sound(animation->sound_name), 0);
+            if (animation->sound_name_id != StringIdNone) {
+                subsystem.play_sound(strings.get_sound(animation->sound_name_id), 0);
             }
         }
     } catch (const ResourcesException& e) {
-        if (gani) delete gani;
         subsystem << "creating animation failed: " << e.what() << std::endl;
     }
 }
@@ -244,17 +238,19 @@ void Tournament::add_animation(const std::string& name, identifier_t id,
     scounter_t duration, identifier_t owner, int x, int y,
     double accel_x, double accel_y, int width, int height)
 {
-    GameAnimation *gani = 0;
     try {
         Animation *ani = resources.get_animation(name);
         TileGraphic *tg = ani->get_tile()->get_tilegraphic();
-        gani = new GameAnimation;
+        GameAnimation *gani = animation_pool.acquire();
         gani->animation = ani;
+        gani->tilegraphic = tg;
+        gani->width = tg->get_width();
+        gani->height = tg->get_height();
         gani->state.id = id; /* client side generated are 0 */
         gani->state.duration = duration;
         gani->state.owner = owner;
-        gani->state.x = x + width / 2 - tg->get_width() / 2;
-        gani->state.y = y  + height / 2 - tg->get_height() / 2;
+        gani->state.x = x + width / 2 - gani->width / 2;
+        gani->state.y = y  + height / 2 - gani->height / 2;
         gani->state.accel_x = accel_x;
         gani->state.accel_y = accel_y;
         game_animations.push_back(gani);
@@ -263,7 +259,6 @@ void Tournament::add_animation(const std::string& name, identifier_t id,
         }
 
     } catch (const ResourcesException& e) {
-        if (gani) delete gani;
         subsystem << "creating animation failed: " << e.what() << std::endl;
     }
 }
@@ -272,7 +267,7 @@ void Tournament::add_text_animation(GTextAnimation *animation) {
     GameTextAnimation *gani = 0;
     try {
         gani = new GameTextAnimation;
-        gani->font = resources.get_font(animation->font_name);
+        gani->font = strings.get_font(animation->font_name_id);
         gani->text = animation->display_text;
         gani->x = static_cast<int>(animation->x);
         gani->y = static_cast<int>(animation->y);
@@ -294,9 +289,8 @@ void Tournament::add_pick_object(GPickObject *po) {
             obj->delete_me = obj->object->is_spawnable();
             const std::string& pickup_animation = obj->object->get_value("pickup_animation");
             if (pickup_animation.length()) {
-                TileGraphic *tg = obj->object->get_tile()->get_tilegraphic();
                 add_animation(pickup_animation, 0, 0, 0, static_cast<int>(obj->state.x),
-                    static_cast<int>(obj->state.y), 0.0f, 0.0f, tg->get_width(), tg->get_height());
+                    static_cast<int>(obj->state.y), 0.0f, 0.0f, obj->width, obj->height);
             }
             if (!server) {
                 const std::string& pickup_sound = obj->object->get_value("pickup_sound");
@@ -310,9 +304,9 @@ void Tournament::add_pick_object(GPickObject *po) {
     }
 
     /* delete marked objects */
-    game_objects.erase(std::remove_if(game_objects.begin(),
-        game_objects.end(), erase_element<GameObject>),
-        game_objects.end());
+    if (object_pool.release_marked(game_objects)) {
+        object_hash_valid = false;
+    }
 }
 
 void Tournament::add_place_object(GPlaceObject *po) {
@@ -324,12 +318,12 @@ void Tournament::add_place_object(GPlaceObject *po) {
             obj->picked = false;
             obj->state.x = po->x;
             obj->state.y = po->y;
+            object_hash_valid = false;
             if (po->flags & PlaceObjectWithAnimation) {
                 const std::string& spawn_animation = obj->object->get_value("spawn_animation");
                 if (spawn_animation.length()) {
-                    TileGraphic *tg = obj->object->get_tile()->get_tilegraphic();
                     add_animation(spawn_animation, 0, 0, 0, static_cast<int>(obj->state.x),
-                        static_cast<int>(obj->state.y), 0.0f, 0.0f, tg->get_width(), tg->get_height());
+                        static_cast<int>(obj->state.y), 0.0f, 0.0f, obj->width, obj->height);
                 }
             }
             if (po->flags & PlaceObjectResetVelocity) {
@@ -369,7 +363,7 @@ void Tournament::add_place_object(GPlaceObject *po) {
 
 void Tournament::spawn_object(GSpawnObject *so) {
     try {
-        Object *obj = resources.get_object(so->object_name);
+        Object *obj = strings.get_object(so->object_name_id);
         spawn_object(obj, so->id, static_cast<int>(so->x), static_cast<int>(so->y), so->flags);
     } catch (const Exception& e) {
         subsystem << e.what() << std::endl;
@@ -377,8 +371,11 @@ void Tournament::spawn_object(GSpawnObject *so) {
 }
 
 void Tournament::spawn_object(Object *obj, identifier_t id, int x, int y, flags_t flags) {
-    GameObject *nobj = new GameObject;
+    GameObject *nobj = object_pool.acquire();
     nobj->object = obj;
+    nobj->tilegraphic = obj->get_tile()->get_tilegraphic();
+    nobj->width = nobj->tilegraphic->get_width();
+    nobj->height = nobj->tilegraphic->get_height();
     nobj->origin_x = x;
     nobj->origin_y = y;
     nobj->state.id = id;
@@ -388,6 +385,7 @@ void Tournament::spawn_object(Object *obj, identifier_t id, int x, int y, flags_
     nobj->state.y = static_cast<double>(y);
     nobj->spawned_object = true;
     game_objects.push_back(nobj);
+    object_hash_valid = false;
 
     if (!server) {
         if (flags & PlaceObjectWithAnimation) {
@@ -513,18 +511,48 @@ void Tournament::spawn_player(Player *p) {
 
 void Tournament::spawn_player_base(Player *p, SpawnPoints& spawn_points) {
     // TODO: better selection of spawn points, maybe order by last spawn point usage
-    GameObject *obj = spawn_points[rand() % spawn_points.size()];
+    size_t index = rand() % spawn_points.size();
+    int x, y;
+    get_spawn_position(p, spawn_points[index], x, y);
+    p->spawn(x, y);
+    player_hash_valid = false;
+
+    /* the server repeats the spawns of the client, see spawn_player_at() */
+    if (!server) {
+        p->spawn_no++;
+        p->spawn_index = static_cast<unsigned char>(index);
+    }
+}
+
+bool Tournament::spawn_player_at(Player *p, size_t index) {
+    return spawn_player_at_base(p, spawn_points, index);
+}
+
+/* server side, alive players stay where the server moved them */
+bool Tournament::spawn_allowed(Player *p) {
+    return !p->is_alive_and_playing();
+}
+
+bool Tournament::spawn_player_at_base(Player *p, SpawnPoints& spawn_points, size_t index) {
+    if (index >= spawn_points.size()) {
+        return false;
+    }
+
+    int x, y;
+    get_spawn_position(p, spawn_points[index], x, y);
+    p->place(x, y);
+    player_hash_valid = false;
+
+    return true;
+}
+
+void Tournament::get_spawn_position(Player *p, GameObject *obj, int& x, int& y) {
     const CollisionBox& colbox = p->get_characterset()->get_colbox();
-    TileGraphic *tg = obj->object->get_tile()->get_tilegraphic();
-    int w = tg->get_width();
-    int h = tg->get_height();
-
-    int x = static_cast<int>(obj->state.x);
-    int y = static_cast<int>(obj->state.y);
-    x += w / 2;
-    y += h;
+    x = static_cast<int>(obj->state.x);
+    y = static_cast<int>(obj->state.y);
+    x += obj->width / 2;
+    y += obj->height;
     x = x - colbox.width / 2 - colbox.x;
-    p->spawn(x, y);
 }
 
 void Tournament::add_team_score(GTeamScore *ts) { }
@@ -739,8 +767,8 @@ void Tournament::player_dies(Player *p, const std::string& die_message) {
 
         GAnimation *ani = new GAnimation;
         memset(ani, 0, sizeof(GAnimation));
-        strncpy(ani->animation_name, tempani->get_name().c_str(), NameLength - 1);
-        strncpy(ani->sound_name, properties.get_value("die_sound").c_str(), NameLength - 1);
+        ani->animation_name_id = strings.get_id(StringTableAnimation, tempani->get_name());
+        ani->sound_name_id = strings.get_id(StringTableSound, properties.get_value("die_sound"));
 
         TileGraphic *tg = p->get_characterset()->get_tile(DirectionLeft, CharacterAnimationStanding)->get_tilegraphic();
         TileGraphic *tga = tempani->get_tile()->get_tilegraphic();
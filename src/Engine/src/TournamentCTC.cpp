@@ -7,11 +7,11 @@
 const int CoinDropInitialValue = 1000;
 const int CoinInitialSendCounter = 15;
 
-TournamentCTC::TournamentCTC(Resources& resources, Subsystem& subsystem, Gui *gui,
+TournamentCTC::TournamentCTC(Resources& resources, StringTable& strings, Subsystem& subsystem, Gui *gui,
     ServerLogger *logger, const std::string& game_file, bool server,
     const std::string& map_name, Players& players, int duration, bool warmup)
     throw (TournamentException, ResourcesException)
-    : Tournament(resources, subsystem, gui, logger, game_file, server, map_name, players,
+    : Tournament(resources, strings, subsystem, gui, logger, game_file, server, map_name, players,
       duration, warmup), coin(0),
       enemy_indicator_coin(resources.get_icon("enemy_indicator_coin"))
 {
@@ -142,6 +142,7 @@ void TournamentCTC::check_coin_validity(double period_f) {
 
 void TournamentCTC::return_coin(int flags) {
     coin->picked = false;
+    object_hash_valid = false;
     coin->state.accel_x = 0.0f;
     coin->state.accel_y = 0.0f;
     GPlaceObject *gpo = new GPlaceObject;
@@ -240,7 +241,7 @@ void TournamentCTC::draw_object_addons() {
         if (!coin->picked) {
             int x = static_cast<int>(coin->state.x) + 2;
             int y = static_cast<int>(coin->state.y) - 10;
-            int w = coin->object->get_tile()->get_tilegraphic()->get_width();
+            int w = coin->width;
             subsystem.set_color(0.0f, 0.0f, 0.0f, 1.0f);
             subsystem.draw_box(x + left, y + top, w, 5);
             subsystem.set_color(1.0f, 1.0f, 1.0f, 1.0f);
@@ -509,6 +510,7 @@ bool TournamentCTC::test_and_drop_coin(Player *p) {
             /* drop object */
             p->state.server_state.flags &= ~PlayerServerFlagHasCoin;
             coin->picked = false;
+            object_hash_valid = false;
             coin->spawn_counter = static_cast<double>(CoinDropInitialValue);
             send_coin_remaining();
 
@@ -6,11 +6,11 @@
 const int FlagDropInitialValue = 1000;
 const int FlagPickRefusal = 100;
 
-TournamentCTF::TournamentCTF(Resources& resources, Subsystem& subsystem, Gui *gui,
+TournamentCTF::TournamentCTF(Resources& resources, StringTable& strings, Subsystem& subsystem, Gui *gui,
     ServerLogger *logger, const std::string& game_file, bool server,
     const std::string& map_name, Players& players, int duration, bool warmup)
     throw (TournamentException, ResourcesException)
-    : TournamentTeam(resources, subsystem, gui, logger, game_file, server, map_name, players,
+    : TournamentTeam(resources, strings, subsystem, gui, logger, game_file, server, map_name, players,
       duration, warmup), red_flag(0), blue_flag(0)
 {
     /* find red and blue flags in this map */
@@ -131,7 +131,7 @@ void TournamentCTF::draw_object_addons() {
             if (!flag->picked) {
                 int x = static_cast<int>(flag->state.x);
                 int y = static_cast<int>(flag->state.y) - 10;
-                int w = flag->object->get_tile()->get_tilegraphic()->get_width();
+                int w = flag->width;
                 subsystem.set_color(0.0f, 0.0f, 0.0f, 1.0f);
                 subsystem.draw_box(x + left, y + top, w, 5);
                 subsystem.set_color(1.0f, 1.0f, 1.0f, 1.0f);
@@ -244,12 +244,12 @@ bool TournamentCTF::pick_item(Player *p, GameObject *obj) {
 }
 
 bool TournamentCTF::tile_collision(TestType type, Player *p, int last_falling_y_pos,
-    Tile *t, bool *killing)
+    Tile::TileType tt, bool *killing)
 {
     if (killing) *killing = false;
 
     if (p) {
-        switch (t->get_tile_type()) {
+        switch (tt) {
             case Tile::TileTypeBaseRed:
                 if (server && p) {
                     if (p->state.server_state.flags & PlayerServerFlagHasOppositeFlag &&
@@ -301,7 +301,7 @@ bool TournamentCTF::tile_collision(TestType type, Player *p, int last_falling_y_
         }
     }
 
-    return Tournament::tile_collision(type, p, last_falling_y_pos, t, killing);
+    return Tournament::tile_collision(type, p, last_falling_y_pos, tt, killing);
 }
 
 bool TournamentCTF::test_and_drop_flag(Player *p) {
@@ -319,6 +319,7 @@ bool TournamentCTF::test_and_drop_flag(Player *p) {
             /* drop object */
             p->state.server_state.flags &= ~PlayerServerFlagHasOppositeFlag;
             flag->picked = false;
+            object_hash_valid = false;
             flag->spawn_counter = static_cast<double>(FlagDropInitialValue);
             send_flag_remaining(flag);
 
@@ -361,6 +362,7 @@ bool TournamentCTF::test_and_drop_flag(Player *p) {
 
 void TournamentCTF::return_flag(GameObject *flag, int flags) {
     flag->picked = false;
+    object_hash_valid = false;
     flag->state.accel_x = 0.0f;
     flag->state.accel_y = 0.0f;
     GPlaceObject *gpo = new GPlaceObject;
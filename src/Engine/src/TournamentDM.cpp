@@ -3,11 +3,11 @@
 #include <algorithm>
 #include <cstdlib>
 
-TournamentDM::TournamentDM(Resources& resources, Subsystem& subsystem, Gui *gui,
+TournamentDM::TournamentDM(Resources& resources, StringTable& strings, Subsystem& subsystem, Gui *gui,
     ServerLogger *logger, const std::string& game_file, bool server,
     const std::string& map_name, Players& players, int duration, bool warmup)
     throw (TournamentException, ResourcesException)
-    : Tournament(resources, subsystem, gui, logger, game_file, server, map_name, players,
+    : Tournament(resources, strings, subsystem, gui, logger, game_file, server, map_name, players,
       duration, warmup)
 {
     /* create spawn points */
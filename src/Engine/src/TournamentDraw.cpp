@@ -206,7 +206,7 @@ void Tournament::draw_animations(bool background) {
         int x = static_cast<int>(round(gani->state.x));
         int y = static_cast<int>(round(gani->state.y));
 
-        TileGraphic *tg = gani->animation->get_tile()->get_tilegraphic();
+        TileGraphic *tg = gani->tilegraphic;
 
         subsystem.draw_tilegraphic(tg, gani->index, x + left, y + top);
 
@@ -236,14 +236,13 @@ void Tournament::draw_objects() {
                 int x = static_cast<int>(round(obj->state.x));
                 int y = static_cast<int>(round(obj->state.y));
 
-                TileGraphic *tg = obj->object->get_tile()->get_tilegraphic();
-                subsystem.draw_tilegraphic(tg, x + left, y + top);
+                subsystem.draw_tilegraphic(obj->tilegraphic, x + left, y + top);
 
                 if (debug) {
                     const CollisionBox& colbox = obj->object->get_colbox();
                     subsystem.set_color(1.0f, 1.0f, 1.0f, 0.5f);
                     subsystem.draw_box(x + left + colbox.x,
-                        y + top + tg->get_height() - colbox.height - colbox.y,
+                        y + top + obj->height - colbox.height - colbox.y,
                         colbox.width, colbox.height);
                     subsystem.reset_color();
                 }
@@ -6,9 +6,9 @@
 #include "TournamentCTC.hpp"
 #include "TournamentGOH.hpp"
 
-TournamentFactory::TournamentFactory(Resources& resources, Subsystem& subsystem, Gui *gui)
+TournamentFactory::TournamentFactory(Resources& resources, StringTable& strings, Subsystem& subsystem, Gui *gui)
     throw (TournamentFactoryException)
-    : resources(resources), subsystem(subsystem), gui(gui), tournament_id(0) { }
+    : resources(resources), strings(strings), subsystem(subsystem), gui(gui), tournament_id(0) { }
 
 TournamentFactory::~TournamentFactory() { }
 
@@ -20,32 +20,32 @@ Tournament *TournamentFactory::create_tournament(const MapConfiguration& config,
 
     switch (config.type) {
         case GamePlayTypeDM:
-            tournament = new TournamentDM(resources, subsystem, gui, logger, "dm",
+            tournament = new TournamentDM(resources, strings, subsystem, gui, logger, "dm",
                 server, config.map_name, players, duration, warmup);
             break;
 
         case GamePlayTypeTDM:
-            tournament = new TournamentTDM(resources, subsystem, gui, logger, "tdm",
+            tournament = new TournamentTDM(resources, strings, subsystem, gui, logger, "tdm",
                 server, config.map_name, players, duration, warmup);
             break;
 
         case GamePlayTypeCTF:
-            tournament = new TournamentCTF(resources, subsystem, gui, logger, "ctf",
+            tournament = new TournamentCTF(resources, strings, subsystem, gui, logger, "ctf",
                 server, config.map_name, players, duration, warmup);
             break;
 
         case GamePlayTypeSR:
-            tournament = new TournamentSR(resources, subsystem, gui, logger, "sr",
+            tournament = new TournamentSR(resources, strings, subsystem, gui, logger, "sr",
                 server, config.map_name, players, duration, warmup);
             break;
 
         case GamePlayTypeCTC:
-            tournament = new TournamentCTC(resources, subsystem, gui, logger, "ctc",
+            tournament = new TournamentCTC(resources, strings, subsystem, gui, logger, "ctc",
                 server, config.map_name, players, duration, warmup);
             break;
 
         case GamePlayTypeGOH:
-            tournament = new TournamentGOH(resources, subsystem, gui, logger, "goh",
+            tournament = new TournamentGOH(resources, strings, subsystem, gui, logger, "goh",
                 server, config.map_name, players, duration, warmup);
             break;
     }
@@ -4,11 +4,11 @@
 
 const int HillCounterMax = 750;
 
-TournamentGOH::TournamentGOH(Resources& resources, Subsystem& subsystem, Gui *gui,
+TournamentGOH::TournamentGOH(Resources& resources, StringTable& strings, Subsystem& subsystem, Gui *gui,
     ServerLogger *logger, const std::string& game_file, bool server,
     const std::string& map_name, Players& players, int duration, bool warmup)
     throw (TournamentException, ResourcesException)
-    : TournamentTeam(resources, subsystem, gui, logger, game_file, server, map_name,
+    : TournamentTeam(resources, strings, subsystem, gui, logger, game_file, server, map_name,
       players, duration, warmup),
       first_player_on_hill(0), addon_player(0), hill_counter(0),
       crested_sound(properties.get_value("crested_sound")),
@@ -164,8 +164,8 @@ void TournamentGOH::generic_data_delivery(void *data) {
 }
 
 bool TournamentGOH::player_is_in_hill_zone(Player *p) {
-    static int tilex;
-    static int tiley;
+    int tilex;
+    int tiley;
 
     CollisionBox colbox = p->get_characterset()->get_colbox();
     colbox.x += static_cast<int>(p->state.client_server_state.x);
@@ -179,22 +179,11 @@ bool TournamentGOH::player_is_in_hill_zone(Player *p) {
             tilex = static_cast<int>(x + colbox.x) / tile_width;
             tiley = static_cast<int>(y + colbox.y) / tile_height;
 
-            bool do_test = true;
-            if (tilex < 0 || tiley < 0) {
-                do_test = false;
-            }
-            if (tilex > map_width - 1 || tiley > map_height - 1) {
-                do_test = false;
-            }
-
-            if (do_test) {
-                int index = map_array[tiley][tilex];
-                if (index > -1) {
-                    Tile *t = tileset->get_tile(index);
-                    if (t->get_tile_type() == Tile::TileTypeHillZone) {
-                        return true;
-                    }
-                }
+            unsigned char cell = collision_grid.get(tilex, tiley);
+            if (cell != CollisionCellEmpty &&
+                CollisionGrid::get_type(cell) == Tile::TileTypeHillZone)
+            {
+                return true;
             }
 
             /* check end? */
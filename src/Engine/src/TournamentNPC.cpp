@@ -1,17 +1,19 @@
 #include "Tournament.hpp"
 
 #include <cstdlib>
-#include <algorithm>
 
 void Tournament::reset_frog_spawn_counter() {
     frog_respawn_counter = static_cast<double>(rand() % frog_spawn_init + frog_spawn_init);
 }
 
 void Tournament::add_spawnable_npc(GSpawnNPC *snpc) {
-    NPC *npc = resources.get_npc(snpc->npc_name);
+    NPC *npc = strings.get_npc(snpc->npc_name_id);
 
-    SpawnableNPC *nnpc = new SpawnableNPC;
+    SpawnableNPC *nnpc = npc_pool.acquire();
+    TileGraphic *tg = npc->get_tile(DirectionLeft, NPCAnimationStanding)->get_tilegraphic();
     nnpc->npc = npc;
+    nnpc->width = tg->get_width();
+    nnpc->height = tg->get_height();
     nnpc->state.id = snpc->id;
     nnpc->state.owner = snpc->owner;
     nnpc->state.flags = 0;
@@ -26,11 +28,12 @@ void Tournament::add_spawnable_npc(GSpawnNPC *snpc) {
     nnpc->ignore_owner_counter = npc->get_ignore_owner_counter();
     nnpc->move_counter = static_cast<double>(npc->get_move_init_randomized());
     spawnable_npcs.push_back(nnpc);
+    npc_hash_valid = false;
 
     if (!server) {
         try {
-            if (snpc->sound_name[0]) {
-                subsystem.play_sound(resources.get_sound(snpc->sound_name), 0);
+            if (snpc->sound_name_id != StringIdNone) {
+                subsystem.play_sound(strings.get_sound(snpc->sound_name_id), 0);
             }
         } catch (const Exception& e) {
             subsystem << e.what();
@@ -45,16 +48,17 @@ void Tournament::remove_spawnable_npc(GRemoveNPC *rnpc) {
         SpawnableNPC *npc = *it;
         if (npc->state.id == rnpc->id) {
             spawnable_npcs.erase(it);
-            delete npc;
+            npc_pool.release(npc);
+            npc_hash_valid = false;
             break;
         }
     }
 }
 
 void Tournament::remove_marked_npcs() {
-    spawnable_npcs.erase(std::remove_if(spawnable_npcs.begin(),
-        spawnable_npcs.end(), erase_element<SpawnableNPC>),
-        spawnable_npcs.end());
+    if (npc_pool.release_marked(spawnable_npcs)) {
+        npc_hash_valid = false;
+    }
 }
 
 void Tournament::send_remove_npc(SpawnableNPC *npc) {
@@ -76,8 +80,8 @@ void Tournament::add_npc_remove_animation(SpawnableNPC *npc) {
             int height = tg->get_height();
             GAnimation *sgani = new GAnimation;
             memset(sgani, 0, GAnimationLen);
-            strncpy(sgani->animation_name, ani->get_name().c_str(), NameLength - 1);
-            strncpy(sgani->sound_name, sound_name.c_str(), NameLength - 1);
+            sgani->animation_name_id = strings.get_id(StringTableAnimation, ani->get_name());
+            sgani->sound_name_id = strings.get_id(StringTableSound, sound_name);
             sgani->id = npc->state.id;
             sgani->duration = ani->get_duration();
             TileGraphic *anitg = ani->get_tile()->get_tilegraphic();
@@ -120,7 +124,7 @@ void Tournament::spawn_frog() {
             memset(spwn, 0, sizeof(GSpawnObject));
             spwn->flags = PlaceObjectWithAnimation | PlaceObjectWithSpawnSound;
             spwn->id = id;
-            strncpy(spwn->object_name, obj->get_name().c_str(), NameLength - 1);
+            spwn->object_name_id = strings.get_id(StringTableObject, obj->get_name());
             spwn->x = static_cast<pos_t>(gobj->origin_x);
             spwn->y = static_cast<pos_t>(gobj->origin_y);
             spwn->to_net();
@@ -179,21 +183,24 @@ void Tournament::update_npc_states(double period_f) {
     {
         SpawnableNPC *npc = *it;
 
-        /* update physics */
-        TileGraphic *tg = npc->npc->get_tile(DirectionLeft, NPCAnimationStanding)->get_tilegraphic();
-        int width = tg->get_width();
-        int height = tg->get_height();
-
-        const CollisionBox& colbox = npc->npc->get_colbox();
-
+        /* update physics, clients interpolate them */
         bool killing = false;
-        double y = npc->state.y - height;
-        bool col = render_physics(period_f, false, 0, 0.0f, 0,
-            npc->npc->get_springiness_x(), 0.0f, colbox,
-            npc->state.x, y, npc->state.accel_x, npc->state.accel_y,
-            width, height, npc->npc->get_friction_factor(), false, npc->falling,
-            npc->last_falling_y_pos, &killing, npc->npc->get_name());
-        npc->state.y = y + height;
+        bool col = false;
+        if (server) {
+            int width = npc->width;
+            int height = npc->height;
+
+            const CollisionBox& colbox = npc->npc->get_colbox();
+
+            double y = npc->state.y - height;
+            col = render_physics(period_f, false, 0, 0.0f, 0,
+                npc->npc->get_springiness_x(), 0.0f, colbox,
+                npc->state.x, y, npc->state.accel_x, npc->state.accel_y,
+                width, height, npc->npc->get_friction_factor(), false, npc->falling,
+                npc->last_falling_y_pos, &killing, npc->npc->get_name());
+            npc->state.y = y + height;
+            npc_hash_valid = false;
+        }
 
         /* update ownership */
         if (server && npc->init_owner) {
@@ -351,8 +358,8 @@ void Tournament::player_npc_collision(Player *p, SpawnableNPC *npc) {
             Animation *ani = resources.get_animation(explosion_animation);
             GAnimation *sgani = new GAnimation;
             memset(sgani, 0, GAnimationLen);
-            strncpy(sgani->animation_name, ani->get_name().c_str(), NameLength - 1);
-            strncpy(sgani->sound_name, ani->get_value("sound_name").c_str(), NameLength - 1);
+            sgani->animation_name_id = strings.get_id(StringTableAnimation, ani->get_name());
+            sgani->sound_name_id = strings.get_id(StringTableSound, ani->get_value("sound_name"));
             sgani->id = npc->state.id;
             sgani->duration = ani->get_duration();
             sgani->x = npc->state.x + ani->get_x_offset();
@@ -3,8 +3,6 @@
 #include <cmath>
 #include <algorithm>
 
-static double bump_sound_velocity = 0.35f;
-
 bool Tournament::render_physics(double period_f, bool projectile, int damage,
     double recoil, identifier_t owner, double springiness_x, double springiness_y,
     const CollisionBox& colbox, double& x, double& y, double& accel_x,
@@ -38,187 +36,64 @@ bool Tournament::render_physics(double period_f, bool projectile, int damage,
         is_collision = true;
     }
 
-    /* tile collision detection */
-    bool bailout;
-    int colmax;
-
-    /* AABB tile collision detection in x direction */
-    do {
-        /* left side */
-        if (accel_x < 0.0f) {
-            /* left upper stepped down */
-            bailout = false;
-            colmax = ((colbox.height - 1) / tile_height) + 1;
-            for (int i = 0; i < colmax; i++) {
-                if (collide_with_tile(TestTypeNormal, 0, last_falling_y_pos,
-                    newx + colbox.x, y + height - colbox.y - colbox.height +
-                    (i * tile_height), 0, killing))
-                {
-                    newx = (tilex + 1) * tile_width - colbox.x;
-                    if (accel_x < -bump_sound_velocity && play_bump) {
-                        play_ground_bump_sound();
-                    }
-                    accel_x = -accel_x * springiness_x;
-                    is_collision = true;
-                    bailout = true;
-                    break;
-                }
-            }
-            if (bailout) {
-                break;
-            }
-
-            /* left lower */
-            if (collide_with_tile(TestTypeNormal, 0, last_falling_y_pos,
-                newx + colbox.x, y + height - colbox.y - 1.0f, 0, killing))
-            {
-                newx = (tilex + 1) * tile_width - colbox.x;
-                if (accel_x < -bump_sound_velocity && play_bump) {
-                    play_ground_bump_sound();
-                }
-                accel_x = -accel_x * springiness_x;
-                is_collision = true;
-                break;
-            }
-        }
-
-        /* right side */
-        if (accel_x > 0.0f) {
-            /* right upper stepped down */
-            bailout = false;
-            colmax = ((colbox.height - 1) / tile_height) + 1;
-            for (int i = 0; i < colmax; i++) {
-                if (collide_with_tile(TestTypeNormal, 0, last_falling_y_pos,
-                    newx + colbox.width + colbox.x, y + height - colbox.height -
-                    colbox.y + (i * tile_height), 0, killing))
-                {
-                    newx = tilex * tile_width - colbox.width - colbox.x;
-                    if (accel_x > bump_sound_velocity && play_bump) {
-                        play_ground_bump_sound();
-                    }
-                    accel_x = -accel_x * springiness_x;
-                    is_collision = true;
-                    bailout = true;
-                    break;
-                }
-            }
-            if (bailout) {
-                break;
-            }
-
-            /* right lower */
-            if (collide_with_tile(TestTypeNormal, 0, last_falling_y_pos,
-                newx + colbox.width + colbox.x, y + width - colbox.y - 1.0f, 0, killing))
-            {
-                newx = tilex * tile_width - colbox.width - colbox.x;
-                if (accel_x > bump_sound_velocity && play_bump) {
-                    play_ground_bump_sound();
-                }
-                accel_x = -accel_x * springiness_x;
-                is_collision = true;
+    /* swept tile collision in x direction */
+    TileContact contact;
+    double bottom = y + height - colbox.y;
+    double top = bottom - colbox.height;
+    if (accel_x < 0.0f || accel_x > 0.0f) {
+        int dir_x = (accel_x < 0.0f ? -1 : 1);
+        double left = x + colbox.x;
+        if (sweep_tiles(TestTypeNormal, 0, last_falling_y_pos, left, top,
+            left + colbox.width, bottom, dir_x, 0, std::max(0.0, dir_x * (newx - x)),
+            contact, killing))
+        {
+            newx = (dir_x < 0 ? contact.edge - colbox.x : contact.edge - colbox.width - colbox.x);
+            if (std::fabs(accel_x) > BumpSoundVelocity && play_bump) {
+                play_ground_bump_sound();
             }
+            accel_x = -accel_x * springiness_x;
+            is_collision = true;
         }
-    } while (false);
+    }
 
     /* save last falling y before y correction for falling tile collision tests */
     if (static_cast<int>(newy + height) < last_falling_y_pos) {
         last_falling_y_pos = static_cast<int>(newy + height);
     }
 
-    /* AABB tile collision detection in y direction */
+    /* swept tile collision in y direction, at the new x */
     double ground_friction = 0.0f;
     bool new_falling = true;
-    do {
-        /* test if ascending only */
-        if (accel_y < 0.0f) {
-            last_falling_y_pos = Player::PlayerFallingTestMaxY;
-            /* top edge */
-            bailout = false;
-            colmax = ((colbox.width - 1) / tile_width) + 1;
-            for (int i = 0; i < colmax; i++) {
-                if (collide_with_tile(TestTypeNormal, 0, last_falling_y_pos,
-                    x + colbox.x + (i * tile_width), newy + height - colbox.y -
-                    colbox.height, 0, killing))
-                {
-                    newy = (tiley + 1) * tile_height + colbox.y + colbox.height - height;
-                    if (accel_y < -bump_sound_velocity && play_bump) {
-                        play_ground_bump_sound();
-                    }
-                    accel_y = 0.0f;
-                    is_collision = true;
-                    new_falling = false;
-                    bailout = true;
-                    break;
-                }
-            }
-            if (bailout) {
-                break;
-            }
-
-            /* top edge right point */
-            if (collide_with_tile(TestTypeNormal, 0, last_falling_y_pos,
-                x + colbox.x + colbox.width - 1.0f, newy + height - colbox.y -
-                colbox.height, 0, killing))
-            {
-                newy = (tiley + 1) * tile_height + colbox.y + colbox.height - height;
-                if (accel_y < -bump_sound_velocity && play_bump) {
-                    play_ground_bump_sound();
-                }
-                accel_y = 0.0f;
-                is_collision = true;
-                new_falling = false;
-                break;
+    double left = newx + colbox.x;
+    if (accel_y < 0.0f) {
+        /* ascending */
+        last_falling_y_pos = Player::PlayerFallingTestMaxY;
+        if (sweep_tiles(TestTypeNormal, 0, last_falling_y_pos, left, top,
+            left + colbox.width, bottom, 0, -1, std::max(0.0, y - newy), contact, killing))
+        {
+            newy = contact.edge + colbox.y + colbox.height - height;
+            if (accel_y < -BumpSoundVelocity && play_bump) {
+                play_ground_bump_sound();
             }
+            accel_y = 0.0f;
+            is_collision = true;
+            new_falling = false;
         }
-
-        /* test if falling only */
-        if (accel_y > 0.0f) {
-            /* bottom edge */
-            bool found = false;
-            colmax = ((colbox.width - 1) / tile_width) + 1;
-            for (int i = 0; i < colmax; i++) {
-                double tile_friction = 0.0f;
-                if (collide_with_tile(TestTypeFalling, 0, last_falling_y_pos,
-                    x + colbox.x + (i * tile_width), newy + height - colbox.y,
-                    &tile_friction, killing))
-                {
-                    if (!found) {
-                        newy = tiley * tile_height + colbox.y - height;
-                        if (accel_y > bump_sound_velocity && play_bump) {
-                            play_ground_bump_sound();
-                        }
-                        accel_y = -accel_y * springiness_y;
-                        is_collision = true;
-                        new_falling = false;
-                        found = true;
-                    }
-                }
-                if (tile_friction > ground_friction) {
-                    ground_friction = tile_friction;
-                }
-            }
-
-            /* bottom edge right point */
-            double tile_friction = 0.0f;
-            if (collide_with_tile(TestTypeFalling, 0, last_falling_y_pos,
-                x + colbox.x + colbox.width - 1.0f, newy + height - colbox.y,
-                &tile_friction, killing))
-            {
-                if (!found) {
-                    newy = tiley * tile_height + colbox.y - height;
-                    if (accel_y > bump_sound_velocity && play_bump) {
-                        play_ground_bump_sound();
-                    }
-                    accel_y = -accel_y * springiness_y;
-                    is_collision = true;
-                    new_falling = false;
-                }
-            }
-            if (tile_friction > ground_friction) {
-                ground_friction = tile_friction;
+    } else if (accel_y > 0.0f) {
+        /* falling */
+        if (sweep_tiles(TestTypeFalling, 0, last_falling_y_pos, left, top,
+            left + colbox.width, bottom, 0, 1, std::max(0.0, newy - y), contact, killing))
+        {
+            newy = contact.edge + colbox.y - height;
+            if (accel_y > BumpSoundVelocity && play_bump) {
+                play_ground_bump_sound();
             }
+            accel_y = -accel_y * springiness_y;
+            is_collision = true;
+            new_falling = false;
+            ground_friction = contact.friction;
         }
-    } while (false);
+    }
 
     /* save last falling y after y correction for falling tile collision tests */
     if (static_cast<int>(newy + height) > last_falling_y_pos) {
@@ -251,54 +126,189 @@ bool Tournament::render_physics(double period_f, bool projectile, int damage,
     y = newy;
 
     /* projectile -> player or npc hit? */
-    if (projectile) {
-        CollisionBox obj_colbox = colbox;
-        obj_colbox.x += static_cast<int>(x);
-        obj_colbox.y = static_cast<int>(y) + height - obj_colbox.height - obj_colbox.y;
+    if (projectile && projectile_hit(damage, recoil, owner, colbox, x, y, accel_x, height, weapon)) {
+        is_collision = true;
+    }
+
+    return is_collision;
+}
 
-        /* test players */
-        for (Players::iterator it = players.begin(); it != players.end(); it++) {
-            Player *p = *it;
-            if (p->state.id != owner) {
-                if (p->is_alive_and_playing()) {
-                    CollisionBox p_colbox = p->get_characterset()->get_damage_colbox();
-                    p_colbox.x += static_cast<int>(p->state.client_server_state.x);
-                    p_colbox.y = static_cast<int>(p->state.client_server_state.y) - p_colbox.height - p_colbox.y;
-                    if (obj_colbox.intersects(p_colbox)) {
-                        if (server) {
-                            GPlayerRecoil *prec = new GPlayerRecoil;
-                            prec->id = p->state.id;
-                            prec->x_recoil = (accel_x < 0.0f ? recoil : -recoil);
-                            prec->to_net();
-                            add_state_response(GPCPlayerRecoil, GPlayerRecoilLen, prec);
-                            player_damage(owner, p, 0, damage, weapon);
-                        }
-                        is_collision = true;
+bool Tournament::projectile_hit(int damage, double recoil, identifier_t owner,
+    const CollisionBox& colbox, double x, double y, double accel_x, int height,
+    const std::string& weapon)
+{
+    bool is_collision = false;
+
+    CollisionBox obj_colbox = colbox;
+    obj_colbox.x += static_cast<int>(x);
+    obj_colbox.y = static_cast<int>(y) + height - obj_colbox.height - obj_colbox.y;
+
+    /* test players, where the owner saw them */
+    double rewind = (server ? get_rewind(owner) : 0.0f);
+    SpatialHash::Candidates candidates;
+    query_players(obj_colbox, candidates);
+    for (SpatialHash::Candidates::iterator it = candidates.begin(); it != candidates.end(); it++) {
+        Player *p = static_cast<Player *>(*it);
+        if (p->state.id != owner) {
+            if (p->is_alive_and_playing()) {
+                double px, py;
+                get_rewound_position(p, rewind, px, py);
+                CollisionBox p_colbox = p->get_characterset()->get_damage_colbox();
+                p_colbox.x += static_cast<int>(px);
+                p_colbox.y = static_cast<int>(py) - p_colbox.height - p_colbox.y;
+                if (obj_colbox.intersects(p_colbox)) {
+                    if (server) {
+                        GPlayerRecoil *prec = new GPlayerRecoil;
+                        prec->id = p->state.id;
+                        prec->x_recoil = (accel_x < 0.0f ? recoil : -recoil);
+                        prec->to_net();
+                        add_state_response(GPCPlayerRecoil, GPlayerRecoilLen, prec);
+                        player_damage(owner, p, 0, damage, weapon);
                     }
+                    is_collision = true;
                 }
             }
         }
+    }
 
-        /* test npcs */
-        for (SpawnableNPCs::iterator it = spawnable_npcs.begin();
-            it != spawnable_npcs.end(); it++)
-        {
-            SpawnableNPC *npc = *it;
-            CollisionBox n_colbox = npc->npc->get_damage_colbox();
-            n_colbox.x += static_cast<int>(npc->state.x);
-            n_colbox.y = static_cast<int>(npc->state.y) - n_colbox.height - n_colbox.y;
-            if (obj_colbox.intersects(n_colbox)) {
-                if (server) {
-                    add_npc_remove_animation(npc);
-                    npc->delete_me = true;
-                    send_remove_npc(npc);
-                }
-                is_collision = true;
+    /* test npcs */
+    query_npcs(obj_colbox, candidates);
+    for (SpatialHash::Candidates::iterator it = candidates.begin(); it != candidates.end(); it++) {
+        SpawnableNPC *npc = static_cast<SpawnableNPC *>(*it);
+        CollisionBox n_colbox = npc->npc->get_damage_colbox();
+        n_colbox.x += static_cast<int>(npc->state.x);
+        n_colbox.y = static_cast<int>(npc->state.y) - n_colbox.height - n_colbox.y;
+        if (obj_colbox.intersects(n_colbox)) {
+            if (server) {
+                add_npc_remove_animation(npc);
+                npc->delete_me = true;
+                send_remove_npc(npc);
             }
+            is_collision = true;
         }
-
-        remove_marked_npcs();
     }
 
+    remove_marked_npcs();
+
     return is_collision;
 }
+
+void Tournament::batch_animations(double period_f) {
+    physics_batch.clear();
+    for (GameAnimations::iterator it = game_animations.begin();
+        it != game_animations.end(); it++)
+    {
+        GameAnimation *gani = *it;
+        if (gani->animation->get_physics()) {
+            physics_batch.add(animation_pool.get_handle(gani), gani->state.x, gani->state.y, gani->state.accel_x,
+                gani->state.accel_y, gani->animation->get_physics_colbox(),
+                gani->width, gani->height, !gani->animation->is_projectile());
+        }
+    }
+    physics_batch.integrate(period_f, YAccelGravity, YMaxAccel, collision_grid,
+        tile_width, tile_height, map_width * tile_width);
+}
+
+void Tournament::batch_objects(double period_f) {
+    physics_batch.clear();
+    for (GameObjects::iterator it = game_objects.begin();
+        it != game_objects.end(); it++)
+    {
+        GameObject *obj = *it;
+        if (!obj->picked && obj->object->get_physics()) {
+            const CollisionBox& colbox = (obj->object->has_physics_colbox() ?
+                obj->object->get_physics_colbox() : obj->object->get_colbox());
+            physics_batch.add(object_pool.get_handle(obj), obj->state.x, obj->state.y, obj->state.accel_x,
+                obj->state.accel_y, colbox, obj->width, obj->height, true);
+        }
+    }
+    physics_batch.integrate(period_f, YAccelGravity, YMaxAccel, collision_grid,
+        tile_width, tile_height, map_width * tile_width);
+}
+
+void Tournament::apply_free_move(size_t lane, double& x, double& y, double& accel_y,
+    int height, bool& falling, int& last_falling_y_pos)
+{
+    /* what render_physics does, if no tile and no border was touched */
+    double newx, newy;
+    physics_batch.get_move(lane, newx, newy, accel_y);
+    if (static_cast<int>(newy + height) < last_falling_y_pos) {
+        last_falling_y_pos = static_cast<int>(newy + height);
+    }
+    if (accel_y < 0.0f) {
+        last_falling_y_pos = Player::PlayerFallingTestMaxY;
+    }
+    if (static_cast<int>(newy + height) > last_falling_y_pos) {
+        last_falling_y_pos = static_cast<int>(newy + height);
+    }
+    falling = true;
+    x = newx;
+    y = newy;
+}
+
+bool Tournament::sweep_tiles(TestType type, Player *p, int last_falling_y_pos,
+    double left, double top, double right, double bottom, int dir_x, int dir_y,
+    double distance, TileContact& contact, bool *killing)
+{
+    /* the leading edge and the tiles it spans across */
+    double edge;
+    int size;
+    int from;
+    int to;
+    if (dir_x) {
+        edge = (dir_x < 0 ? left : right);
+        size = tile_width;
+        from = static_cast<int>(top) / tile_height;
+        to = static_cast<int>(bottom - 1.0f) / tile_height;
+    } else {
+        edge = (dir_y < 0 ? top : bottom);
+        size = tile_height;
+        from = static_cast<int>(left) / tile_width;
+        to = static_cast<int>(right - 1.0f) / tile_width;
+    }
+    int dir = dir_x + dir_y;
+    int first = static_cast<int>(edge) / size;
+    int last = static_cast<int>(edge + dir * distance) / size;
+
+    /* dda, walk the rows or columns the leading edge enters, in order */
+    for (int i = first; ; i += dir) {
+        bool hit = false;
+        double friction = 0.0f;
+        for (int j = from; j <= to; j++) {
+            bool tile_killing = false;
+            double tile_friction = 0.0f;
+            bool col = (dir_x ?
+                collide_with_tile(type, p, last_falling_y_pos, i, j, &tile_friction, &tile_killing) :
+                collide_with_tile(type, p, last_falling_y_pos, j, i, &tile_friction, &tile_killing));
+            if (tile_killing && killing) {
+                *killing = true;
+            }
+            if (col && !hit) {
+                hit = true;
+                contact.tile_x = tilex;
+                contact.tile_y = tiley;
+            }
+            if (tile_friction > friction) {
+                friction = tile_friction;
+            }
+        }
+
+        if (hit) {
+            contact.edge = static_cast<double>(dir > 0 ? i * size : (i + 1) * size);
+            contact.time = (distance > 0.0f ? (contact.edge - edge) * dir / distance : 0.0f);
+            if (contact.time < 0.0f) {
+                contact.time = 0.0f;
+            }
+            contact.normal_x = -dir_x;
+            contact.normal_y = -dir_y;
+            contact.friction = friction;
+            return true;
+        }
+
+        if (i == last) {
+            break;
+        }
+    }
+
+    return false;
+}
@@ -7,11 +7,11 @@
 #include "Win.hpp"
 #endif
 
-TournamentSR::TournamentSR(Resources& resources, Subsystem& subsystem, Gui *gui,
+TournamentSR::TournamentSR(Resources& resources, StringTable& strings, Subsystem& subsystem, Gui *gui,
     ServerLogger *logger, const std::string& game_file, bool server,
     const std::string& map_name, Players& players, int duration, bool warmup)
     throw (TournamentException, ResourcesException)
-    : Tournament(resources, subsystem, gui, logger, game_file, server, map_name,
+    : Tournament(resources, strings, subsystem, gui, logger, game_file, server, map_name,
       players, duration, warmup)
 {
     /* create spawn points */
@@ -76,7 +76,7 @@ void TournamentSR::write_stats_in_server_log() {
 void TournamentSR::frag_point(Player *pfrag, Player *pkill) { }
 
 bool TournamentSR::tile_collision(TestType type, Player *p, int last_falling_y_pos,
-    Tile *t, bool *killing)
+    Tile::TileType tt, bool *killing)
 {
     if (killing) {
         *killing = false;
@@ -84,7 +84,7 @@ bool TournamentSR::tile_collision(TestType type, Player *p, int last_falling_y_p
 
     if (p) {
         Player *me = get_me();
-        switch (t->get_tile_type()) {
+        switch (tt) {
             case Tile::TileTypeSpeedraceFinish:
                 if (!server && p == me) {
                     bool found = false;
@@ -103,6 +103,12 @@ bool TournamentSR::tile_collision(TestType type, Player *p, int last_falling_y_p
                             top->finished = true;
                         }
                     }
+                } else if (server) {
+                    /* the client spawns back to the start now */
+                    TimesOfPlayer *top = get_times_of_player(p);
+                    if (top) {
+                        top->returning = true;
+                    }
                 }
                 return false;
                 break;
@@ -112,7 +118,17 @@ bool TournamentSR::tile_collision(TestType type, Player *p, int last_falling_y_p
         }
     }
 
-    return Tournament::tile_collision(type, p, last_falling_y_pos, t, killing);
+    return Tournament::tile_collision(type, p, last_falling_y_pos, tt, killing);
+}
+
+bool TournamentSR::spawn_allowed(Player *p) {
+    TimesOfPlayer *top = get_times_of_player(p);
+    if (top && top->returning) {
+        top->returning = false;
+        return true;
+    }
+
+    return Tournament::spawn_allowed(p);
 }
 
 void TournamentSR::player_added(Player *p) {
@@ -1,16 +1,56 @@
 #include "Tournament.hpp"
 
 #include <algorithm>
+#include <cmath>
 
 static double YInitialJumpImpulse = 3.8f;
 static double YVeloJumpToLanding = 2.0f;
 static ns_t IntegrateMaxTimeStep = 10000000;
 
+static void get_moves(const Player *p, bool& move_left, bool& move_right,
+    bool& move_up, bool& move_down, bool& move_jump)
+{
+    move_left = ((p->state.client_server_state.key_states & PlayerKeyStateLeft) != 0) |
+        ((p->state.client_server_state.jaxis & PlayerKeyStateLeft) != 0);
+
+    move_right = ((p->state.client_server_state.key_states & PlayerKeyStateRight) != 0) |
+        ((p->state.client_server_state.jaxis & PlayerKeyStateRight) != 0);
+
+    move_up = ((p->state.client_server_state.key_states & PlayerKeyStateUp) != 0) |
+        ((p->state.client_server_state.jaxis & PlayerKeyStateUp) != 0);
+
+    move_down = ((p->state.client_server_state.key_states & PlayerKeyStateDown) != 0) |
+        ((p->state.client_server_state.jaxis & PlayerKeyStateDown) != 0);
+
+    move_jump = ((p->state.client_server_state.key_states & PlayerKeyStateJump) != 0);
+
+    /* prevent locking slidings */
+    if (move_left && move_right) {
+        move_left = move_right = false;
+    }
+
+    if (move_up && move_down) {
+        move_up = move_down = false;
+    }
+}
+
 void Tournament::update_states(ns_t ns) {
     if (!ready) {
         return;
     }
 
+    /* drawing blends from here to the end of this tick */
+    if (!server) {
+        Player *me = get_me();
+        if (me) {
+            tick_start_x = me->state.client_server_state.x;
+            tick_start_y = me->state.client_server_state.y;
+        }
+        tick_start_view_x = spectator_x;
+        tick_start_view_y = spectator_y;
+    }
+
+    simulation_time += ns;
     ns_t shot = IntegrateMaxTimeStep;
     while (ns) {
         if (ns <= IntegrateMaxTimeStep) {
@@ -21,11 +61,129 @@ void Tournament::update_states(ns_t ns) {
         }
         integrate(shot);
     }
+
+    if (server) {
+        record_hitboxes();
+    }
+}
+
+void Tournament::replay_player(Player *p, ns_t ns) {
+    if (!ready) {
+        return;
+    }
+
+    ns_t shot = IntegrateMaxTimeStep;
+    while (ns && p->is_alive_and_playing()) {
+        if (ns <= IntegrateMaxTimeStep) {
+            shot = ns;
+            ns = 0;
+        } else {
+            ns -= IntegrateMaxTimeStep;
+        }
+        move_player(p, shot / static_cast<double>(ns_fc), true);
+    }
+}
+
+void Tournament::interpolate(double time) {
+    if (!ready || server) {
+        return;
+    }
+
+    double accel_x, accel_y;
+    Player *me = get_me();
+
+    /* remote players */
+    for (Players::iterator it = players.begin(); it != players.end(); it++) {
+        Player *p = *it;
+        if (p != me && p->is_alive_and_playing()) {
+            GPlayerClientServerState& state = p->state.client_server_state;
+            if (p->motion.sample(time, state.x, state.y, accel_x, accel_y)) {
+                if (accel_y < -Epsilon || accel_y > Epsilon) {
+                    p->state.client_state.flags |= PlayerClientFlagFalling;
+                } else {
+                    p->state.client_state.flags &= ~PlayerClientFlagFalling;
+                }
+                if (interpolated && p->motion.landed(interpolation_time, time, YVeloLanding)) {
+                    p->state.client_state.flags |= PlayerClientFlagLanded;
+                }
+            }
+        }
+    }
+
+    /* objects, they still bump on the client */
+    for (GameObjects::iterator it = game_objects.begin(); it != game_objects.end(); it++) {
+        GameObject *obj = *it;
+        if (!obj->picked && obj->object->get_physics()) {
+            if (obj->motion.sample(time, obj->state.x, obj->state.y, obj->state.accel_x, obj->state.accel_y)) {
+                if (interpolated && obj->motion.bumped(interpolation_time, time, BumpSoundVelocity)) {
+                    play_ground_bump_sound();
+                }
+            }
+        }
+    }
+
+    /* npcs */
+    for (SpawnableNPCs::iterator it = spawnable_npcs.begin(); it != spawnable_npcs.end(); it++) {
+        SpawnableNPC *npc = *it;
+        if (npc->motion.sample(time, npc->state.x, npc->state.y, accel_x, accel_y)) {
+            npc->falling = (accel_y < -Epsilon || accel_y > Epsilon);
+        }
+    }
+
+    interpolated = true;
+    interpolation_time = time;
+    player_hash_valid = false;
+    npc_hash_valid = false;
+    object_hash_valid = false;
+}
+
+void Tournament::blend(double alpha) {
+    if (!ready || server) {
+        return;
+    }
+
+    /* no blending across spawns and corrections by the server */
+    Player *me = get_me();
+    if (me && me->is_alive_and_playing()) {
+        GPlayerClientServerState& state = me->state.client_server_state;
+        if (std::fabs(state.x - tick_start_x) < tile_width && std::fabs(state.y - tick_start_y) < tile_height) {
+            blend_saved_x = state.x;
+            blend_saved_y = state.y;
+            state.x = tick_start_x + (state.x - tick_start_x) * alpha;
+            state.y = tick_start_y + (state.y - tick_start_y) * alpha;
+            blended = true;
+        }
+    }
+
+    double view_x = spectator_x;
+    double view_y = spectator_y;
+    if (std::fabs(view_x - tick_start_view_x) < tile_width && std::fabs(view_y - tick_start_view_y) < tile_height) {
+        view_x = tick_start_view_x + (view_x - tick_start_view_x) * alpha;
+        view_y = tick_start_view_y + (view_y - tick_start_view_y) * alpha;
+    }
+    set_view(view_x, view_y);
+}
+
+void Tournament::unblend() {
+    if (blended) {
+        Player *me = get_me();
+        if (me) {
+            me->state.client_server_state.x = blend_saved_x;
+            me->state.client_server_state.y = blend_saved_y;
+        }
+        blended = false;
+        player_hash_valid = false;
+    }
 }
 
 void Tournament::integrate(ns_t ns) {
     double period_f = ns / static_cast<double>(ns_fc);
 
+    /* entities might have been changed from outside */
+    player_hash_valid = false;
+    npc_hash_valid = false;
+    object_hash_valid = false;
+
     /* show stats, if game is over? */
     if (!game_state.seconds_remaining) {
         if (!warmup) {
@@ -67,6 +225,7 @@ void Tournament::integrate(ns_t ns) {
                 obj->spawn_counter += period_f;
                 if (obj->spawn_counter >= spawn_time) {
                     obj->picked = false;
+                    object_hash_valid = false;
                     obj->spawn_counter = 0.0f;
                     GPlaceObject *gpo = new GPlaceObject;
                     gpo->id = obj->state.id;
@@ -91,6 +250,8 @@ void Tournament::integrate(ns_t ns) {
     }
 
     /* update animation states and its physics */
+    batch_animations(period_f);
+    size_t lane = 0;
     for (GameAnimations::iterator it = game_animations.begin();
         it != game_animations.end(); it++)
     {
@@ -101,10 +262,9 @@ void Tournament::integrate(ns_t ns) {
         bool finished = false;
 
         if (gani->animation_counter > speed) {
-            TileGraphic *tg = gani->animation->get_tile()->get_tilegraphic();
             gani->animation_counter = 0.0f;
             gani->index++;
-            if (gani->index >= static_cast<int>(tg->get_tile_count())) {
+            if (gani->index >= static_cast<int>(gani->tilegraphic->get_tile_count())) {
                 if (gani->state.duration) {
                     gani->state.duration--;
                     if (!gani->state.duration) {
@@ -117,20 +277,29 @@ void Tournament::integrate(ns_t ns) {
         }
 
         if (gani->animation->get_physics()) {
-            TileGraphic *tg = gani->animation->get_tile()->get_tilegraphic();
-            int width = tg->get_width();
-            int height = tg->get_height();
             double springiness = gani->animation->get_springiness();
             bool projectile = gani->animation->is_projectile();
             double recoil = gani->animation->get_recoil();
             int damage = gani->animation->get_damage();
 
             const CollisionBox& colbox = gani->animation->get_physics_colbox();
-            bool col = render_physics(period_f, projectile, damage, recoil,
-                gani->state.owner, springiness, springiness, colbox,
-                gani->state.x, gani->state.y, gani->state.accel_x,
-                gani->state.accel_y, width, height, 1.0f, true, gani->falling,
-                gani->last_falling_y_pos, 0, gani->animation->get_name());
+            bool col = false;
+            if (physics_batch.is_free(lane, animation_pool.get_handle(gani))) {
+                apply_free_move(lane, gani->state.x, gani->state.y, gani->state.accel_y,
+                    gani->height, gani->falling, gani->last_falling_y_pos);
+                if (projectile) {
+                    col = projectile_hit(damage, recoil, gani->state.owner, colbox,
+                        gani->state.x, gani->state.y, gani->state.accel_x, gani->height,
+                        gani->animation->get_name());
+                }
+            } else {
+                col = render_physics(period_f, projectile, damage, recoil,
+                    gani->state.owner, springiness, springiness, colbox,
+                    gani->state.x, gani->state.y, gani->state.accel_x,
+                    gani->state.accel_y, gani->width, gani->height, 1.0f, true, gani->falling,
+                    gani->last_falling_y_pos, 0, gani->animation->get_name());
+            }
+            lane++;
 
             if (col && projectile) {
                 finished = true;
@@ -145,8 +314,8 @@ void Tournament::integrate(ns_t ns) {
                     Animation *ani = resources.get_animation(finished_animation);
                     GAnimation *sgani = new GAnimation;
                     memset(sgani, 0, GAnimationLen);
-                    strncpy(sgani->animation_name, ani->get_name().c_str(), NameLength - 1);
-                    strncpy(sgani->sound_name, ani->get_value("sound_name").c_str(), NameLength - 1);
+                    sgani->animation_name_id = strings.get_id(StringTableAnimation, ani->get_name());
+                    sgani->sound_name_id = strings.get_id(StringTableSound, ani->get_value("sound_name"));
                     sgani->id = gani->state.id;
                     sgani->duration = ani->get_duration();
                     sgani->x = gani->state.x + ani->get_x_offset();
@@ -163,9 +332,7 @@ void Tournament::integrate(ns_t ns) {
         }
     }
 
-    game_animations.erase(std::remove_if(game_animations.begin(),
-        game_animations.end(), erase_element<GameAnimation>),
-        game_animations.end());
+    animation_pool.release_marked(game_animations);
 
     /* update text animations */
     for (GameTextAnimations::iterator it = game_text_animations.begin();
@@ -204,25 +371,33 @@ void Tournament::integrate(ns_t ns) {
         resources.update_tile_index(period_f * AnimationMultiplier, tileset);
     }
 
-    /* update object physics */
-    for (GameObjects::iterator it = game_objects.begin();
-        it != game_objects.end(); it++)
-    {
-        GameObject *obj = *it;
-        if (!obj->picked) {
-            if (obj->object->get_physics()) {
-                TileGraphic *tg = obj->object->get_tile()->get_tilegraphic();
-                int width = tg->get_width();
-                int height = tg->get_height();
-                double springiness = obj->object->get_springiness();
-
-                const CollisionBox& colbox = (obj->object->has_physics_colbox() ?
-                    obj->object->get_physics_colbox() : obj->object->get_colbox());
-
-                render_physics(period_f, false, 0, 0.0f, 0, springiness,
-                    springiness, colbox, obj->state.x, obj->state.y, obj->state.accel_x,
-                    obj->state.accel_y, width, height, 1.0f, true, obj->falling,
-                    obj->last_falling_y_pos, 0, obj->object->get_name());
+    /* update object physics, clients interpolate them */
+    if (server) {
+        batch_objects(period_f);
+        lane = 0;
+        for (GameObjects::iterator it = game_objects.begin();
+            it != game_objects.end(); it++)
+        {
+            GameObject *obj = *it;
+            if (!obj->picked) {
+                if (obj->object->get_physics()) {
+                    double springiness = obj->object->get_springiness();
+
+                    const CollisionBox& colbox = (obj->object->has_physics_colbox() ?
+                        obj->object->get_physics_colbox() : obj->object->get_colbox());
+
+                    if (physics_batch.is_free(lane, object_pool.get_handle(obj))) {
+                        apply_free_move(lane, obj->state.x, obj->state.y, obj->state.accel_y,
+                            obj->height, obj->falling, obj->last_falling_y_pos);
+                    } else {
+                        render_physics(period_f, false, 0, 0.0f, 0, springiness,
+                            springiness, colbox, obj->state.x, obj->state.y, obj->state.accel_x,
+                            obj->state.accel_y, obj->width, obj->height, 1.0f, true, obj->falling,
+                            obj->last_falling_y_pos, 0, obj->object->get_name());
+                    }
+                    lane++;
+                    object_hash_valid = false;
+                }
             }
         }
     }
@@ -261,7 +436,8 @@ void Tournament::integrate(ns_t ns) {
     for (Players::iterator it = players.begin(); it != players.end(); it++) {
         Player *p = *it;
 
-        if (p->is_alive_and_playing()) {
+        /* server side, players wait for their first input */
+        if (p->is_alive_and_playing() && !p->input_stalled) {
             const CollisionBox& colbox = p->get_characterset()->get_colbox();
 
             /* check player name width */
@@ -276,293 +452,34 @@ void Tournament::integrate(ns_t ns) {
             }
 
             /* action key triggers */
-            bool move_left = ((p->state.client_server_state.key_states & PlayerKeyStateLeft) != 0) |
-                ((p->state.client_server_state.jaxis & PlayerKeyStateLeft) != 0);
-
-            bool move_right = ((p->state.client_server_state.key_states & PlayerKeyStateRight) != 0) |
-                ((p->state.client_server_state.jaxis & PlayerKeyStateRight) != 0);
-
-            bool move_up = ((p->state.client_server_state.key_states & PlayerKeyStateUp) != 0) |
-                ((p->state.client_server_state.jaxis & PlayerKeyStateUp) != 0);
-
-            bool move_down = ((p->state.client_server_state.key_states & PlayerKeyStateDown) != 0) |
-                ((p->state.client_server_state.jaxis & PlayerKeyStateDown) != 0);
-
-            bool move_jump = ((p->state.client_server_state.key_states & PlayerKeyStateJump) != 0);
-
-            /* prevent locking slidings */
-            if (move_left && move_right) {
-                move_left = move_right = false;
-            }
-
-            if (move_up && move_down) {
-                move_up = move_down = false;
-            }
-
-            /* horizontal acceleration */
-            if (move_left) {
-                p->state.client_server_state.accel_x -= (XAccel * period_f);
-            }
-
-            if (move_right) {
-                p->state.client_server_state.accel_x += (XAccel * period_f);
-            }
-
-            if (p->state.client_server_state.accel_x < -XMaxAccel) {
-                p->state.client_server_state.accel_x = -XMaxAccel;
-            }
-
-            if (p->state.client_server_state.accel_x > XMaxAccel) {
-                p->state.client_server_state.accel_x = XMaxAccel;
-            }
-
-            /* horizontal deceleration */
-            if (!move_left && !move_right) {
-                if (p->state.client_server_state.accel_x > -Epsilon && p->state.client_server_state.accel_x < Epsilon) {
-                    p->state.client_server_state.accel_x = 0.0f;
-                } else if (p->state.client_server_state.accel_x < -Epsilon) {
-                    p->state.client_server_state.accel_x += (XDecel * period_f);
-                    if (p->state.client_server_state.accel_x > -Epsilon) {
-                        p->state.client_server_state.accel_x = 0.0f;
-                    }
-                } else if (p->state.client_server_state.accel_x > Epsilon) {
-                    p->state.client_server_state.accel_x -= (XDecel * period_f);
-                    if (p->state.client_server_state.accel_x < Epsilon) {
-                        p->state.client_server_state.accel_x = 0.0f;
-                    }
-                }
-            }
-
-            /* jump */
-            if (move_jump && p->state.client_state.flags & PlayerClientFlagJumpReleased) {
-                p->state.client_state.flags &= ~PlayerClientFlagJumpReleased;
-                if (!(p->state.client_state.flags & PlayerClientFlagFalling) &&
-                    p->state.client_server_state.jump_accel_y > -Epsilon &&
-                    p->state.client_server_state.jump_accel_y < Epsilon)
-                {
-                    if (p == me) {
-                        p->state.client_server_state.jump_accel_y = -YInitialJumpImpulse;
-                        if (!server) {
-                            p->force_broadcast = true;
-                            const std::string& jump_sound = p->get_characterset()->get_value("jump_sound");
-                            if (jump_sound.length()) {
-                                subsystem.play_sound(resources.get_sound(jump_sound), 0);
-                            }
-                        }
-                    }
-                }
-            } else if (!move_jump) {
-                p->state.client_state.flags |= PlayerClientFlagJumpReleased;
-            }
-
-            /* gravity */
-            p->state.client_server_state.accel_y += YAccelGravity * period_f;
-            if (p->state.client_server_state.accel_y > YMaxAccel) {
-                p->state.client_server_state.accel_y = YMaxAccel;
-            }
-
-            if (p->state.client_server_state.accel_y + p->state.client_server_state.jump_accel_y < -Epsilon) {
-                p->state.client_server_state.jump_accel_y += (move_jump ? YDecelJump : YDecelJumpNormal) * period_f;
-            } else {
-                p->state.client_server_state.jump_accel_y += YDecelJumpNormal * period_f;
-            }
-
-            if (p->state.client_server_state.jump_accel_y > -Epsilon) {
-                p->state.client_server_state.jump_accel_y = 0.0f;
-            }
-
-            /* new movement vector */
-            double movy = p->state.client_server_state.accel_y + p->state.client_server_state.jump_accel_y;
-
-            /* new position */
-            double newx = p->state.client_server_state.x + (p->state.client_server_state.accel_x * period_f);
-            double newy = p->state.client_server_state.y + (movy * period_f);
-
-            /* map boundary checks */
-            if (newx < -colbox.x) {
-                newx = -colbox.x;
-                p->state.client_server_state.accel_x = 0.0f;
-            }
-            if (newx + colbox.x + colbox.width > map_width * tile_width) {
-                newx = map_width * tile_width - (colbox.x + colbox.width);
-                p->state.client_server_state.accel_x = 0.0f;
-            }
-
-            /* tile collision detection */
-            bool bailout;
-            int colmax;
-
-            /* AABB tile collision detection in x direction */
-            do {
-                /* left side */
-                if (p->state.client_server_state.accel_x < 0.0f) {
-                    /* left upper stepped down */
-                    bailout = false;
-                    colmax = ((colbox.height - 1) / tile_height) + 1;
-                    for (int i = 0; i < colmax; i++) {
-                        if (collide_with_tile(TestTypeNormal, p, p->last_falling_y_pos, newx + colbox.x, p->state.client_server_state.y - colbox.y - colbox.height + (i * tile_height), 0, 0)) {
-                            newx = (tilex + 1) * tile_width - colbox.x;
-                            p->state.client_server_state.accel_x = 0.0f;
-                            bailout = true;
-                            break;
-                        }
-                    }
-                    if (bailout) {
-                        break;
-                    }
-
-                    /* left lower */
-                    if (collide_with_tile(TestTypeNormal, p, p->last_falling_y_pos, newx + colbox.x, p->state.client_server_state.y - colbox.y - 1.0f, 0, 0)) {
-                        newx = (tilex + 1) * tile_width - colbox.x;
-                        p->state.client_server_state.accel_x = 0.0f;
-                        break;
-                    }
-                }
-
-                if (p->state.client_server_state.accel_x > 0.0f) {
-                    /* right upper stepped down */
-                    bailout = false;
-                    colmax = ((colbox.height - 1) / tile_height) + 1;
-                    for (int i = 0; i < colmax; i++) {
-                        if (collide_with_tile(TestTypeNormal, p, p->last_falling_y_pos, newx + colbox.width + colbox.x, p->state.client_server_state.y - colbox.height - colbox.y + (i * tile_height), 0, 0)) {
-                            newx = tilex * tile_width - colbox.width - colbox.x;
-                            p->state.client_server_state.accel_x = 0.0f;
-                            bailout = true;
-                            break;
-                        }
-                    }
-                    if (bailout) {
-                        break;
-                    }
-
-                    /* right lower */
-                    if (collide_with_tile(TestTypeNormal, p, p->last_falling_y_pos, newx + colbox.width + colbox.x, p->state.client_server_state.y - colbox.y - 1.0f, 0, 0)) {
-                        newx = tilex * tile_width - colbox.width - colbox.x;
-                        p->state.client_server_state.accel_x = 0.0f;
-                    }
-                }
-            } while (false);
-
-            /* set player's falling flag */
-            p->state.client_state.flags |= PlayerClientFlagFalling;
-
-            /* save last falling y before y correction for falling tile collision tests */
-            if (static_cast<int>(newy) < p->last_falling_y_pos) {
-                p->last_falling_y_pos = static_cast<int>(newy);
-            }
-
-            /* AABB tile collision detection in y direction */
-            double ground_friction = 0.0f;
-
-            do {
-                /* test if jumping only */
-                if (movy < 0.0f) {
-                    /* reset after jump */
-                    p->last_falling_y_pos = Player::PlayerFallingTestMaxY;
-                    /* top edge */
-                    bailout = false;
-                    colmax = ((colbox.width - 1) / tile_width) + 1;
-                    for (int i = 0; i < colmax; i++) {
-                        if (collide_with_tile(TestTypeNormal, p, p->last_falling_y_pos, p->state.client_server_state.x + colbox.x + (i * tile_width), newy - colbox.y - colbox.height, 0, 0)) {
-                            newy = (tiley + 1) * tile_height + colbox.y + colbox.height;
-                            p->state.client_server_state.jump_accel_y = 0.0f;
-                            p->state.client_server_state.accel_y = 0.0f;
-                            p->state.client_state.flags &= ~PlayerClientFlagFalling;
-                            bailout = true;
-                            break;
-                        }
-                    }
-                    if (bailout) {
-                        break;
-                    }
-
-                    /* top edge right point */
-                    if (collide_with_tile(TestTypeNormal, p, p->last_falling_y_pos, p->state.client_server_state.x + colbox.x + colbox.width - 1.0f, newy - colbox.y - colbox.height, 0, 0)) {
-                        newy = (tiley + 1) * tile_height + colbox.y + colbox.height;
-                        p->state.client_server_state.jump_accel_y = 0.0f;
-                        p->state.client_server_state.accel_y = 0.0f;
-                        p->state.client_state.flags &= ~PlayerClientFlagFalling;
-                        break;
-                    }
-                }
-
-                /* test if falling only */
-                TestType test_type;
-                if (move_down) {
-                    p->last_falling_y_pos = Player::PlayerFallingTestMaxY;
-                    test_type = TestTypeFallingThrough;
-                } else {
-                    test_type = TestTypeFalling;
-                }
-                if (movy > 0.0f) {
-                    /* bottom edge */
-                    bool found = false;
-                    colmax = ((colbox.width - 1) / tile_width) + 1;
-                    for (int i = 0; i < colmax; i++) {
-                        double tile_friction = 0.0f;
-                        if (collide_with_tile(test_type, p, p->last_falling_y_pos, p->state.client_server_state.x + colbox.x + (i * tile_width), newy - colbox.y, &tile_friction, 0)) {
-                            if (!found) {
-                                if (p->state.client_server_state.accel_y > YVeloLanding) {
-                                    p->state.client_state.flags |= PlayerClientFlagLanded;
-                                }
-                                newy = tiley * tile_height + colbox.y;
-                                p->state.client_server_state.jump_accel_y = 0.0f;
-                                p->state.client_server_state.accel_y = 0.0f;
-                                p->state.client_state.flags &= ~PlayerClientFlagFalling;
-                                found = true;
-                            }
-                        }
-                        if (tile_friction > ground_friction) {
-                            ground_friction = tile_friction;
-                        }
-                    }
-
-                    /* bottom edge right point */
-                    double tile_friction = 0.0f;
-                    if (collide_with_tile(test_type, p, p->last_falling_y_pos, p->state.client_server_state.x + colbox.x + colbox.width - 1.0f, newy - colbox.y, &tile_friction, 0)) {
-                        if (!found) {
-                            if (p->state.client_server_state.accel_y > YVeloLanding) {
-                                p->state.client_state.flags |= PlayerClientFlagLanded;
-                            }
-                            newy = tiley * tile_height + colbox.y;
-                            p->state.client_server_state.jump_accel_y = 0.0f;
-                            p->state.client_server_state.accel_y = 0.0f;
-                            p->state.client_state.flags &= ~PlayerClientFlagFalling;
-                        }
-                    }
-                    if (tile_friction > ground_friction) {
-                        ground_friction = tile_friction;
-                    }
-                }
-            } while (false);
-
-            /* save last falling y after y correction for falling tile collision tests */
-            if (static_cast<int>(newy) > p->last_falling_y_pos) {
-                p->last_falling_y_pos = static_cast<int>(newy);
-            }
+            bool move_left, move_right, move_up, move_down, move_jump;
+            get_moves(p, move_left, move_right, move_up, move_down, move_jump);
 
             /* if player was killed by tile, continue to next player here */
-            if (p->state.server_state.flags & PlayerServerFlagDead) {
+            /* clients only predict themselves, the others interpolate     */
+            if ((server || p == me) && !move_player(p, period_f, false)) {
+                player_hash_valid = false;
                 continue;
             }
+            player_hash_valid = false;
 
             /* collision with object and NPC */
             if (server) {
                 CollisionBox p_colbox = colbox;
-                p_colbox.x += static_cast<int>(newx);
-                p_colbox.y = static_cast<int>(newy) - p_colbox.height - p_colbox.y;
+                p_colbox.x += static_cast<int>(p->state.client_server_state.x);
+                p_colbox.y = static_cast<int>(p->state.client_server_state.y) - p_colbox.height - p_colbox.y;
 
                 /* object collision? */
-                for (GameObjects::iterator oit = game_objects.begin();
-                    oit != game_objects.end(); oit++)
+                SpatialHash::Candidates candidates;
+                query_objects(p_colbox, candidates);
+                for (SpatialHash::Candidates::iterator oit = candidates.begin();
+                    oit != candidates.end(); oit++)
                 {
-                    GameObject *obj = *oit;
+                    GameObject *obj = static_cast<GameObject *>(*oit);
                     if (!obj->picked) {
-                        TileGraphic *tg = obj->object->get_tile()->get_tilegraphic();
-
                         CollisionBox obj_colbox = obj->object->get_colbox();
                         obj_colbox.x += static_cast<int>(obj->state.x);
-                        obj_colbox.y = static_cast<int>(obj->state.y) + tg->get_height() - obj_colbox.height - obj_colbox.y;
+                        obj_colbox.y = static_cast<int>(obj->state.y) + obj->height - obj_colbox.height - obj_colbox.y;
 
                         /* intersection? */
                         if (p_colbox.intersects(obj_colbox)) {
@@ -585,15 +502,16 @@ void Tournament::integrate(ns_t ns) {
                 }
 
                 /* delete marked objects */
-                game_objects.erase(std::remove_if(game_objects.begin(),
-                    game_objects.end(), erase_element<GameObject>),
-                    game_objects.end());
+                if (object_pool.release_marked(game_objects)) {
+                    object_hash_valid = false;
+                }
 
                 /* NPC collision */
-                for (SpawnableNPCs::iterator nit = spawnable_npcs.begin();
-                    nit != spawnable_npcs.end(); nit++)
+                query_npcs(p_colbox, candidates);
+                for (SpatialHash::Candidates::iterator nit = candidates.begin();
+                    nit != candidates.end(); nit++)
                 {
-                    SpawnableNPC *npc = *nit;
+                    SpawnableNPC *npc = static_cast<SpawnableNPC *>(*nit);
 
                     CollisionBox npc_colbox = npc->npc->get_colbox();
                     npc_colbox.x += static_cast<int>(npc->state.x);
@@ -610,26 +528,9 @@ void Tournament::integrate(ns_t ns) {
                 remove_marked_npcs();
             }
 
-            /* if player is sliding -> more friction */
-            if (!move_left && !move_right && !(p->state.client_state.flags & PlayerClientFlagFalling)) {
-                if (p->state.client_server_state.accel_x > -Epsilon && p->state.client_server_state.accel_x < Epsilon) {
-                    p->state.client_server_state.accel_x = 0.0f;
-                } else if (p->state.client_server_state.accel_x < -Epsilon) {
-                    p->state.client_server_state.accel_x += (ground_friction * period_f);
-                    if (p->state.client_server_state.accel_x > -Epsilon) {
-                        p->state.client_server_state.accel_x = 0.0f;
-                    }
-                } else if (p->state.client_server_state.accel_x > Epsilon) {
-                    p->state.client_server_state.accel_x -= (ground_friction * period_f);
-                    if (p->state.client_server_state.accel_x < Epsilon) {
-                        p->state.client_server_state.accel_x = 0.0f;
-                    }
-                }
-            }
-
             /* fell off the screen */
             if (server) {
-                if (newy - 100 > map_height * tile_height) {
+                if (p->state.client_server_state.y - 100 > map_height * tile_height) {
                     std::string msg(p->get_player_name() + " fell off the stage");
                     player_dies(p, msg);
                     if (logger) {
@@ -638,10 +539,6 @@ void Tournament::integrate(ns_t ns) {
                 }
             }
 
-            /* update player position */
-            p->state.client_server_state.x = newx;
-            p->state.client_server_state.y = newy;
-
             /* setup character icon and its animation */
             unsigned char icon = p->state.client_state.icon;
             p->animation_counter += period_f * AnimationMultiplier;
@@ -782,11 +679,14 @@ void Tournament::integrate(ns_t ns) {
         spectator_x = following_player->state.client_server_state.x + colbox.x + colbox.width / 2;
         spectator_y = following_player->state.client_server_state.y;
     }
+    set_view(spectator_x, spectator_y);
+}
 
+void Tournament::set_view(double x, double y) {
     int view_width = subsystem.get_view_width();
     int view_height = subsystem.get_view_height();
-    int origin_x = static_cast<int>(spectator_x);
-    int origin_y = static_cast<int>(spectator_y);
+    int origin_x = static_cast<int>(x);
+    int origin_y = static_cast<int>(y);
 
     if (map_width * tile_width < view_width) {
         left = (view_width / 2) - (map_width * tile_width / 2);
@@ -809,6 +709,202 @@ void Tournament::integrate(ns_t ns) {
     }
 }
 
+bool Tournament::move_player(Player *p, double period_f, bool replay) {
+    const CollisionBox& colbox = p->get_characterset()->get_colbox();
+    bool move_left, move_right, move_up, move_down, move_jump;
+    get_moves(p, move_left, move_right, move_up, move_down, move_jump);
+
+    /* horizontal acceleration */
+    if (move_left) {
+        p->state.client_server_state.accel_x -= (XAccel * period_f);
+    }
+
+    if (move_right) {
+        p->state.client_server_state.accel_x += (XAccel * period_f);
+    }
+
+    if (p->state.client_server_state.accel_x < -XMaxAccel) {
+        p->state.client_server_state.accel_x = -XMaxAccel;
+    }
+
+    if (p->state.client_server_state.accel_x > XMaxAccel) {
+        p->state.client_server_state.accel_x = XMaxAccel;
+    }
+
+    /* horizontal deceleration */
+    if (!move_left && !move_right) {
+        if (p->state.client_server_state.accel_x > -Epsilon && p->state.client_server_state.accel_x < Epsilon) {
+            p->state.client_server_state.accel_x = 0.0f;
+        } else if (p->state.client_server_state.accel_x < -Epsilon) {
+            p->state.client_server_state.accel_x += (XDecel * period_f);
+            if (p->state.client_server_state.accel_x > -Epsilon) {
+                p->state.client_server_state.accel_x = 0.0f;
+            }
+        } else if (p->state.client_server_state.accel_x > Epsilon) {
+            p->state.client_server_state.accel_x -= (XDecel * period_f);
+            if (p->state.client_server_state.accel_x < Epsilon) {
+                p->state.client_server_state.accel_x = 0.0f;
+            }
+        }
+    }
+
+    /* jump */
+    if (move_jump && p->state.client_state.flags & PlayerClientFlagJumpReleased) {
+        p->state.client_state.flags &= ~PlayerClientFlagJumpReleased;
+        if (!(p->state.client_state.flags & PlayerClientFlagFalling) &&
+            p->state.client_server_state.jump_accel_y > -Epsilon &&
+            p->state.client_server_state.jump_accel_y < Epsilon)
+        {
+            /* the server moves everybody, clients predict themselves */
+            if (server) {
+                p->state.client_server_state.jump_accel_y = -YInitialJumpImpulse;
+                p->state.client_server_state.flags |= PlayerClientServerFlagForceBroadcast;
+            } else if (p == get_me()) {
+                p->state.client_server_state.jump_accel_y = -YInitialJumpImpulse;
+                if (!replay) {
+                    const std::string& jump_sound = p->get_characterset()->get_value("jump_sound");
+                    if (jump_sound.length()) {
+                        subsystem.play_sound(resources.get_sound(jump_sound), 0);
+                    }
+                }
+            }
+        }
+    } else if (!move_jump) {
+        p->state.client_state.flags |= PlayerClientFlagJumpReleased;
+    }
+
+    /* gravity */
+    p->state.client_server_state.accel_y += YAccelGravity * period_f;
+    if (p->state.client_server_state.accel_y > YMaxAccel) {
+        p->state.client_server_state.accel_y = YMaxAccel;
+    }
+
+    if (p->state.client_server_state.accel_y + p->state.client_server_state.jump_accel_y < -Epsilon) {
+        p->state.client_server_state.jump_accel_y += (move_jump ? YDecelJump : YDecelJumpNormal) * period_f;
+    } else {
+        p->state.client_server_state.jump_accel_y += YDecelJumpNormal * period_f;
+    }
+
+    if (p->state.client_server_state.jump_accel_y > -Epsilon) {
+        p->state.client_server_state.jump_accel_y = 0.0f;
+    }
+
+    /* new movement vector */
+    double movy = p->state.client_server_state.accel_y + p->state.client_server_state.jump_accel_y;
+
+    /* new position */
+    double newx = p->state.client_server_state.x + (p->state.client_server_state.accel_x * period_f);
+    double newy = p->state.client_server_state.y + (movy * period_f);
+
+    /* map boundary checks */
+    if (newx < -colbox.x) {
+        newx = -colbox.x;
+        p->state.client_server_state.accel_x = 0.0f;
+    }
+    if (newx + colbox.x + colbox.width > map_width * tile_width) {
+        newx = map_width * tile_width - (colbox.x + colbox.width);
+        p->state.client_server_state.accel_x = 0.0f;
+    }
+
+    /* swept tile collision in x direction */
+    TileContact contact;
+    double bottom = p->state.client_server_state.y - colbox.y;
+    double top = bottom - colbox.height;
+    if (p->state.client_server_state.accel_x < 0.0f || p->state.client_server_state.accel_x > 0.0f) {
+        int dir_x = (p->state.client_server_state.accel_x < 0.0f ? -1 : 1);
+        double left = p->state.client_server_state.x + colbox.x;
+        if (sweep_tiles(TestTypeNormal, p, p->last_falling_y_pos, left, top, left + colbox.width,
+            bottom, dir_x, 0, std::max(0.0, dir_x * (newx - p->state.client_server_state.x)), contact, 0))
+        {
+            newx = (dir_x < 0 ? contact.edge - colbox.x : contact.edge - colbox.width - colbox.x);
+            p->state.client_server_state.accel_x = 0.0f;
+        }
+    }
+
+    /* set player's falling flag */
+    p->state.client_state.flags |= PlayerClientFlagFalling;
+
+    /* save last falling y before y correction for falling tile collision tests */
+    if (static_cast<int>(newy) < p->last_falling_y_pos) {
+        p->last_falling_y_pos = static_cast<int>(newy);
+    }
+
+    /* swept tile collision in y direction, at the new x */
+    double ground_friction = 0.0f;
+    double left = newx + colbox.x;
+    double dy = newy - p->state.client_server_state.y;
+
+    /* test if jumping only */
+    if (movy < 0.0f) {
+        /* reset after jump */
+        p->last_falling_y_pos = Player::PlayerFallingTestMaxY;
+        if (sweep_tiles(TestTypeNormal, p, p->last_falling_y_pos, left, top, left + colbox.width,
+            bottom, 0, -1, std::max(0.0, -dy), contact, 0))
+        {
+            newy = contact.edge + colbox.y + colbox.height;
+            p->state.client_server_state.jump_accel_y = 0.0f;
+            p->state.client_server_state.accel_y = 0.0f;
+            p->state.client_state.flags &= ~PlayerClientFlagFalling;
+        }
+    }
+
+    /* test if falling only */
+    TestType test_type;
+    if (move_down) {
+        p->last_falling_y_pos = Player::PlayerFallingTestMaxY;
+        test_type = TestTypeFallingThrough;
+    } else {
+        test_type = TestTypeFalling;
+    }
+    if (movy > 0.0f) {
+        if (sweep_tiles(test_type, p, p->last_falling_y_pos, left, top, left + colbox.width,
+            bottom, 0, 1, std::max(0.0, dy), contact, 0))
+        {
+            if (p->state.client_server_state.accel_y > YVeloLanding) {
+                p->state.client_state.flags |= PlayerClientFlagLanded;
+            }
+            newy = contact.edge + colbox.y;
+            p->state.client_server_state.jump_accel_y = 0.0f;
+            p->state.client_server_state.accel_y = 0.0f;
+            p->state.client_state.flags &= ~PlayerClientFlagFalling;
+            ground_friction = contact.friction;
+        }
+    }
+
+    /* save last falling y after y correction for falling tile collision tests */
+    if (static_cast<int>(newy) > p->last_falling_y_pos) {
+        p->last_falling_y_pos = static_cast<int>(newy);
+    }
+
+    /* if player was killed by tile, don't move him */
+    if (p->state.server_state.flags & PlayerServerFlagDead) {
+        return false;
+    }
+
+    /* if player is sliding -> more friction */
+    if (!move_left && !move_right && !(p->state.client_state.flags & PlayerClientFlagFalling)) {
+        if (p->state.client_server_state.accel_x > -Epsilon && p->state.client_server_state.accel_x < Epsilon) {
+            p->state.client_server_state.accel_x = 0.0f;
+        } else if (p->state.client_server_state.accel_x < -Epsilon) {
+            p->state.client_server_state.accel_x += (ground_friction * period_f);
+            if (p->state.client_server_state.accel_x > -Epsilon) {
+                p->state.client_server_state.accel_x = 0.0f;
+            }
+        } else if (p->state.client_server_state.accel_x > Epsilon) {
+            p->state.client_server_state.accel_x -= (ground_friction * period_f);
+            if (p->state.client_server_state.accel_x < Epsilon) {
+                p->state.client_server_state.accel_x = 0.0f;
+            }
+        }
+    }
+
+    /* update player position */
+    p->state.client_server_state.x = newx;
+    p->state.client_server_state.y = newy;
+
+    return true;
+}
+
 void Tournament::subintegrate(ns_t ns) { }
 
 void Tournament::players_post_actions() { }
@@ -816,37 +912,28 @@ void Tournament::players_post_actions() { }
 void Tournament::round_finished_set_time(Player *p, GTransportTime *race) { }
 
 bool Tournament::collide_with_tile(TestType type, Player *p,
-    int last_falling_y_pos, double x, double y, double *friction, bool *killing)
+    int last_falling_y_pos, int x, int y, double *friction, bool *killing)
 {
-    tilex = static_cast<int>(x) / tile_width;
-    tiley = static_cast<int>(y) / tile_height;
+    tilex = x;
+    tiley = y;
 
-    if (tilex < 0 || tiley < 0) {
+    unsigned char cell = collision_grid.get(tilex, tiley);
+    if (cell == CollisionCellEmpty) {
         return false;
     }
 
-    if (tilex > map_width - 1 || tiley > map_height - 1) {
-        return false;
-    }
-
-    int index = map_array[tiley][tilex];
-    if (index > -1) {
-        Tile *t = tileset->get_tile(index);
-        if (friction) {
-            *friction = t->get_friction();
-        }
-        return tile_collision(type, p, last_falling_y_pos, t, killing);
+    if (friction) {
+        *friction = collision_grid.get_friction(cell, tilex, tiley);
     }
 
-    return false;
+    return tile_collision(type, p, last_falling_y_pos, CollisionGrid::get_type(cell), killing);
 }
 
 bool Tournament::tile_collision(TestType type, Player *p,
-    int last_falling_y_pos, Tile *t, bool *killing)
+    int last_falling_y_pos, Tile::TileType tt, bool *killing)
 {
     if (killing) *killing = false;
 
-    Tile::TileType tt = t->get_tile_type();
     switch (tt) {
         case Tile::TileTypeBaseRed:
         case Tile::TileTypeBaseBlue:
@@ -878,17 +965,15 @@ bool Tournament::tile_collision(TestType type, Player *p,
 
                 case TestTypeFalling:
                 {
-                    bool test = (last_falling_y_pos <= tiley * tile_height);
-                    if (tiley > 0) {
-                        int index = map_array[tiley - 1][tilex];
-                        if (index == -1 || tileset->get_tile(index)->get_tile_type() == Tile::TileTypeNonblocking) {
-                            return test;
-                        } else {
-                            return false;
-                        }
+                    /* only the surface blocks */
+                    unsigned char above = collision_grid.get(tilex, tiley - 1);
+                    if (above == CollisionCellEmpty ||
+                        CollisionGrid::get_type(above) == Tile::TileTypeNonblocking)
+                    {
+                        return (last_falling_y_pos <= tiley * tile_height);
                     }
 
-                    return test;
+                    return false;
                 }
             }
             return true;
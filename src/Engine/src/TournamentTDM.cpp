@@ -2,11 +2,11 @@
 
 #include <cstdlib>
 
-TournamentTDM::TournamentTDM(Resources& resources, Subsystem& subsystem, Gui *gui,
+TournamentTDM::TournamentTDM(Resources& resources, StringTable& strings, Subsystem& subsystem, Gui *gui,
     ServerLogger *logger, const std::string& game_file, bool server,
     const std::string& map_name, Players& players, int duration, bool warmup)
     throw (TournamentException, ResourcesException)
-    : TournamentTeam(resources, subsystem, gui, logger, game_file, server, map_name,
+    : TournamentTeam(resources, strings, subsystem, gui, logger, game_file, server, map_name,
       players, duration, warmup)
 {
     /* setup tournament icon */
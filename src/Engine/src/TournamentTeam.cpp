@@ -5,11 +5,11 @@
 
 const int CheckUnbalancedInitialValue = 10000;
 
-TournamentTeam::TournamentTeam(Resources& resources, Subsystem& subsystem, Gui *gui,
+TournamentTeam::TournamentTeam(Resources& resources, StringTable& strings, Subsystem& subsystem, Gui *gui,
     ServerLogger *logger, const std::string& game_file, bool server,
     const std::string& map_name, Players& players, int duration, bool warmup)
     throw (TournamentException, ResourcesException)
-    : Tournament(resources, subsystem, gui, logger, game_file, server, map_name,
+    : Tournament(resources, strings, subsystem, gui, logger, game_file, server, map_name,
       players, duration, warmup),
       team_badge_red(resources.get_icon("team_badge_red")),
       team_badge_blue(resources.get_icon("team_badge_blue")),
@@ -63,6 +63,14 @@ void TournamentTeam::spawn_player(Player *p) {
     }
 }
 
+bool TournamentTeam::spawn_player_at(Player *p, size_t index) {
+    if (p->state.server_state.flags & PlayerServerFlagTeamRed) {
+        return spawn_player_at_base(p, spawn_points_red, index);
+    }
+
+    return spawn_player_at_base(p, spawn_points_blue, index);
+}
+
 void TournamentTeam::draw_team_colours() {
     for (Players::iterator it = players.begin(); it != players.end(); it++) {
         Player *p = *it;
@@ -490,7 +498,7 @@ void TournamentTeam::add_team_score_animation(Player *p, const std::string& text
 
     GTextAnimation *tani = new GTextAnimation;
     memset(tani, 0, sizeof(GTextAnimation));
-    strncpy(tani->font_name, font->get_name().c_str(), NameLength - 1);
+    tani->font_name_id = strings.get_id(StringTableFont, font->get_name());
     strncpy(tani->display_text, text.c_str(), TextLength - 1);
     tani->max_counter = 65;
     tani->x = p->state.client_server_state.x + p->get_characterset()->get_width() / 2 - tw / 2;
@@ -1,6 +1,7 @@
 #include "Tournament.hpp"
 
 #include <cstdlib>
+#include <algorithm>
 #include <cmath>
 
 void Tournament::check_attack(Player *p, const CollisionBox& colbox,
@@ -150,8 +151,8 @@ void Tournament::firing_animation(Player *p, int flag, const std::string& animat
 
     GAnimation *ani = new GAnimation;
     memset(ani, 0, sizeof(GAnimation));
-    strncpy(ani->animation_name, animation->get_name().c_str(), NameLength - 1);
-    strncpy(ani->sound_name, properties.get_value(start_sound).c_str(), NameLength - 1);
+    ani->animation_name_id = strings.get_id(StringTableAnimation, animation->get_name());
+    ani->sound_name_id = strings.get_id(StringTableSound, properties.get_value(start_sound));
     ani->id = ++animation_id;
     ani->duration = animation->get_duration();
     ani->owner = p->state.id;
@@ -186,8 +187,8 @@ void Tournament::firing_npc(Player *p, int flag, const std::string& npc_name,
     NPC *npc = resources.get_npc(npc_name);
     GSpawnNPC *snpc = new GSpawnNPC;
     memset(snpc, 0, sizeof(GSpawnNPC));
-    strncpy(snpc->npc_name, npc_name.c_str(), NameLength - 1);
-    strncpy(snpc->sound_name, properties.get_value(start_sound).c_str(), NameLength - 1);
+    snpc->npc_name_id = strings.get_id(StringTableNPC, npc_name);
+    snpc->sound_name_id = strings.get_id(StringTableSound, properties.get_value(start_sound));
     snpc->id = get_free_npc_id();
     snpc->owner = p->state.id;
     snpc->direction = direction;
@@ -206,6 +207,145 @@ void Tournament::firing_npc(Player *p, int flag, const std::string& npc_name,
     add_state_response(GPCSpawnNPC, sizeof(GSpawnNPC), snpc);
 }
 
+static CollisionBox join_boxes(const CollisionBox& a, const CollisionBox& b) {
+    CollisionBox box;
+    box.x = std::min(a.x, b.x);
+    box.y = std::min(a.y, b.y);
+    box.width = std::max(a.x + a.width, b.x + b.width) - box.x;
+    box.height = std::max(a.y + a.height, b.y + b.height) - box.y;
+
+    return box;
+}
+
+void Tournament::query_players(const CollisionBox& box, SpatialHash::Candidates& candidates) {
+    if (!player_hash_valid) {
+        player_hash.clear();
+        for (Players::iterator it = players.begin(); it != players.end(); it++) {
+            Player *p = *it;
+            if (p->is_alive_and_playing()) {
+                /* relative to the position, everything that can be hit */
+                Characterset *cs = p->get_characterset();
+                CollisionBox cb = cs->get_colbox();
+                cb.y = -cb.height - cb.y;
+                CollisionBox db = cs->get_damage_colbox();
+                db.y = -db.height - db.y;
+                CollisionBox p_colbox = join_boxes(cb, db);
+
+                /* and wherever a shot might rewind it to */
+                double x = p->state.client_server_state.x;
+                double y = p->state.client_server_state.y;
+                double min_x = x, min_y = y, max_x = x, max_y = y;
+                if (server && p->hitboxes.get_bounds(min_x, min_y, max_x, max_y)) {
+                    min_x = std::min(min_x, x);
+                    min_y = std::min(min_y, y);
+                    max_x = std::max(max_x, x);
+                    max_y = std::max(max_y, y);
+                }
+                p_colbox.x += static_cast<int>(min_x) - 1;
+                p_colbox.y += static_cast<int>(min_y) - 1;
+                p_colbox.width += static_cast<int>(max_x) - static_cast<int>(min_x) + 2;
+                p_colbox.height += static_cast<int>(max_y) - static_cast<int>(min_y) + 2;
+                player_hash.insert(p, p_colbox);
+            }
+        }
+        player_hash_valid = true;
+    }
+    player_hash.query(box, candidates);
+}
+
+void Tournament::query_npcs(const CollisionBox& box, SpatialHash::Candidates& candidates) {
+    if (!npc_hash_valid) {
+        npc_hash.clear();
+        for (SpawnableNPCs::iterator it = spawnable_npcs.begin();
+            it != spawnable_npcs.end(); it++)
+        {
+            SpawnableNPC *npc = *it;
+            CollisionBox cb = npc->npc->get_colbox();
+            cb.x += static_cast<int>(npc->state.x);
+            cb.y = static_cast<int>(npc->state.y) - cb.height - cb.y;
+            CollisionBox db = npc->npc->get_damage_colbox();
+            db.x += static_cast<int>(npc->state.x);
+            db.y = static_cast<int>(npc->state.y) - db.height - db.y;
+            npc_hash.insert(npc, join_boxes(cb, db), npc_pool.get_handle(npc));
+        }
+        npc_hash_valid = true;
+    }
+    npc_hash.query(box, candidates, &hash_handles);
+
+    /* drop npcs, whose slot was released or reused since the rebuild */
+    size_t n = 0;
+    for (size_t i = 0; i < candidates.size(); i++) {
+        if (npc_pool.get(hash_handles[i]) == candidates[i]) {
+            candidates[n++] = candidates[i];
+        }
+    }
+    candidates.resize(n);
+}
+
+void Tournament::query_objects(const CollisionBox& box, SpatialHash::Candidates& candidates) {
+    if (!object_hash_valid) {
+        object_hash.clear();
+        for (GameObjects::iterator it = game_objects.begin();
+            it != game_objects.end(); it++)
+        {
+            GameObject *obj = *it;
+            if (!obj->picked) {
+                CollisionBox obj_colbox = obj->object->get_colbox();
+                obj_colbox.x += static_cast<int>(obj->state.x);
+                obj_colbox.y = static_cast<int>(obj->state.y) + obj->height - obj_colbox.height - obj_colbox.y;
+                object_hash.insert(obj, obj_colbox, object_pool.get_handle(obj));
+            }
+        }
+        object_hash_valid = true;
+    }
+    object_hash.query(box, candidates, &hash_handles);
+
+    /* drop objects, whose slot was released or reused since the rebuild */
+    size_t n = 0;
+    for (size_t i = 0; i < candidates.size(); i++) {
+        if (object_pool.get(hash_handles[i]) == candidates[i]) {
+            candidates[n++] = candidates[i];
+        }
+    }
+    candidates.resize(n);
+}
+
+void Tournament::record_hitboxes() {
+    for (Players::iterator it = players.begin(); it != players.end(); it++) {
+        Player *p = *it;
+        if (p->is_alive_and_playing()) {
+            p->hitboxes.add(simulation_time, p->state.client_server_state.x,
+                p->state.client_server_state.y);
+        }
+    }
+}
+
+double Tournament::get_rewind(identifier_t owner) const {
+    /* the shooter saw the others half a ping late, behind its */
+    /* own interpolation delay, and the shot took the other half */
+    for (Players::const_iterator it = players.begin(); it != players.end(); it++) {
+        const Player *p = *it;
+        if (p->state.id == owner) {
+            const Connection *c = p->get_connection();
+            if (!c) {
+                break;
+            }
+            double rewind = c->ping_time * 1000000.0f + p->interpolation_delay;
+            return (rewind > HitboxHistoryDuration ? HitboxHistoryDuration : rewind);
+        }
+    }
+
+    return 0.0f;
+}
+
+void Tournament::get_rewound_position(const Player *p, double rewind, double& x, double& y) const {
+    x = p->state.client_server_state.x;
+    y = p->state.client_server_state.y;
+    if (rewind > 0.0f) {
+        p->hitboxes.get(simulation_time - rewind, x, y);
+    }
+}
+
 void Tournament::check_killing_animation(int x, int y, Animation *ani,
     identifier_t owner, bool preserve_npc, NPC *npc)
 {
@@ -219,11 +359,17 @@ void Tournament::check_killing_animation(int x, int y, Animation *ani,
             colbox.width = spread;
             colbox.height = spread;
 
-            for (Players::iterator it = players.begin(); it != players.end(); it++) {
-                Player *p = *it;
+            /* test against the positions the owner saw */
+            double rewind = get_rewind(owner);
+            SpatialHash::Candidates candidates;
+            query_players(colbox, candidates);
+            for (SpatialHash::Candidates::iterator it = candidates.begin(); it != candidates.end(); it++) {
+                Player *p = static_cast<Player *>(*it);
+                double px, py;
+                get_rewound_position(p, (p->state.id == owner ? 0.0f : rewind), px, py);
                 CollisionBox p_colbox = p->get_characterset()->get_colbox();
-                p_colbox.x += static_cast<int>(p->state.client_server_state.x);
-                p_colbox.y = static_cast<int>(p->state.client_server_state.y) - p_colbox.height - p_colbox.y;
+                p_colbox.x += static_cast<int>(px);
+                p_colbox.y = static_cast<int>(py) - p_colbox.height - p_colbox.y;
 
                 if (p->is_alive_and_playing()) {
                     if (colbox.intersects(p_colbox))
@@ -233,10 +379,9 @@ void Tournament::check_killing_animation(int x, int y, Animation *ani,
                 }
             }
 
-            for (SpawnableNPCs::iterator it = spawnable_npcs.begin();
-                it != spawnable_npcs.end(); it++)
-            {
-                SpawnableNPC *npc = *it;
+            query_npcs(colbox, candidates);
+            for (SpatialHash::Candidates::iterator it = candidates.begin(); it != candidates.end(); it++) {
+                SpawnableNPC *npc = static_cast<SpawnableNPC *>(*it);
                 CollisionBox n_colbox = npc->npc->get_damage_colbox();
                 n_colbox.x += static_cast<int>(npc->state.x);
                 n_colbox.y = static_cast<int>(npc->state.y) - n_colbox.height - n_colbox.y;
@@ -0,0 +1,42 @@
+#ifndef DEFLATER_HPP
+#define DEFLATER_HPP
+
+#include <vector>
+#include <cstddef>
+
+/* raw deflate (rfc 1951) of small buffers with fixed huffman codes.  */
+/* the preset dictionary is taken as preceding history, so the output */
+/* inflates with the same dictionary set by inflateSetDictionary().   */
+class Deflater {
+private:
+    Deflater(const Deflater&);
+    Deflater& operator=(const Deflater&);
+
+public:
+    Deflater(const void *dictionary, size_t dictionary_len);
+    virtual ~Deflater();
+
+    /* returns the compressed size or 0, if it does not fit into out */
+    size_t deflate(const void *in, size_t len, void *out, size_t max_len);
+
+private:
+    std::vector<unsigned char> window;
+    std::vector<int> head;
+    std::vector<int> prev;
+    size_t dictionary_len;
+
+    unsigned char *out;
+    size_t out_len;
+    size_t out_max;
+    unsigned int bit_buffer;
+    int bit_count;
+    bool overflow;
+
+    void insert(int pos);
+    void put_bits(unsigned int value, int bits);
+    void put_code(unsigned int code, int bits);
+    void put_literal(unsigned char c);
+    void put_match(int len, int dist);
+};
+
+#endif // DEFLATER_HPP
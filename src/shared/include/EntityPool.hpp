@@ -0,0 +1,180 @@
+#ifndef ENTITYPOOL_HPP
+#define ENTITYPOOL_HPP
+
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <cstddef>
+
+#ifdef _WIN32
+#include "Win.hpp"
+#else
+#include <stdint.h>
+#endif
+
+/* refers to a pooled entity, stale once the entity was released */
+struct EntityHandle {
+    EntityHandle() : index(0), generation(0) { }
+
+    bool operator==(const EntityHandle& rhs) const {
+        return (index == rhs.index && generation == rhs.generation);
+    }
+
+    uint32_t index;
+    uint32_t generation;        /* 0 is never handed out */
+};
+
+/* storage for short living entities. they live in fixed chunks, */
+/* so pointers stay valid until release, and released slots are  */
+/* recycled first, lowest first to keep the live ones packed in  */
+/* the front chunks, so spawning does not allocate in the game.  */
+/* a reused slot gets a new generation, so handles kept across a */
+/* release no longer resolve, while raw pointers would.          */
+template <class T> class EntityPool {
+private:
+    EntityPool(const EntityPool&);
+    EntityPool& operator=(const EntityPool&);
+
+public:
+    EntityPool() : count(0) { }
+
+    virtual ~EntityPool() {
+        for (typename Chunks::iterator it = chunks.begin(); it != chunks.end(); it++) {
+            delete *it;
+        }
+    }
+
+    /* a default constructed entity */
+    T *acquire() {
+        if (free_slots.empty()) {
+            add_chunk();
+        }
+        std::pop_heap(free_slots.begin(), free_slots.end(), std::greater<uint32_t>());
+        uint32_t index = free_slots.back();
+        free_slots.pop_back();
+
+        Chunk *chunk = chunks[index / ChunkSize];
+        size_t slot = index % ChunkSize;
+        chunk->used[slot] = true;
+        chunk->entities[slot] = T();
+        count++;
+
+        return &chunk->entities[slot];
+    }
+
+    void release(T *entity) {
+        uint32_t index;
+        if (find(entity, index)) {
+            Chunk *chunk = chunks[index / ChunkSize];
+            size_t slot = index % ChunkSize;
+            if (chunk->used[slot]) {
+                chunk->used[slot] = false;
+                if (!++chunk->generations[slot]) {
+                    chunk->generations[slot] = 1;
+                }
+                free_slots.push_back(index);
+                std::push_heap(free_slots.begin(), free_slots.end(), std::greater<uint32_t>());
+                count--;
+            }
+        }
+    }
+
+    /* removes and releases the entities marked with delete_me, */
+    /* the others keep their order. true, if any was removed.   */
+    bool release_marked(std::vector<T *>& entities) {
+        typename std::vector<T *>::iterator out = entities.begin();
+        for (typename std::vector<T *>::iterator it = entities.begin(); it != entities.end(); it++) {
+            if ((*it)->delete_me) {
+                release(*it);
+            } else {
+                *out++ = *it;
+            }
+        }
+        if (out == entities.end()) {
+            return false;
+        }
+        entities.erase(out, entities.end());
+
+        return true;
+    }
+
+    EntityHandle get_handle(const T *entity) const {
+        EntityHandle handle;
+        uint32_t index;
+        if (find(entity, index)) {
+            const Chunk *chunk = chunks[index / ChunkSize];
+            size_t slot = index % ChunkSize;
+            if (chunk->used[slot]) {
+                handle.index = index;
+                handle.generation = chunk->generations[slot];
+            }
+        }
+
+        return handle;
+    }
+
+    /* 0, if the entity of the handle was released meanwhile */
+    T *get(const EntityHandle& handle) const {
+        if (handle.index / ChunkSize >= chunks.size()) {
+            return 0;
+        }
+        Chunk *chunk = chunks[handle.index / ChunkSize];
+        size_t slot = handle.index % ChunkSize;
+        if (!chunk->used[slot] || chunk->generations[slot] != handle.generation) {
+            return 0;
+        }
+
+        return &chunk->entities[slot];
+    }
+
+    size_t get_count() const {
+        return count;
+    }
+
+private:
+    static const size_t ChunkSize = 64;
+
+    struct Chunk {
+        Chunk() {
+            for (size_t i = 0; i < ChunkSize; i++) {
+                generations[i] = 1;
+                used[i] = false;
+            }
+        }
+
+        T entities[ChunkSize];
+        uint32_t generations[ChunkSize];
+        bool used[ChunkSize];
+    };
+
+    typedef std::vector<Chunk *> Chunks;
+    typedef std::vector<uint32_t> FreeSlots;
+
+    Chunks chunks;
+    FreeSlots free_slots;       /* min heap of slot indices */
+    size_t count;
+
+    void add_chunk() {
+        uint32_t base = static_cast<uint32_t>(chunks.size() * ChunkSize);
+        chunks.push_back(new Chunk);
+
+        for (size_t i = 0; i < ChunkSize; i++) {
+            free_slots.push_back(base + static_cast<uint32_t>(i));
+            std::push_heap(free_slots.begin(), free_slots.end(), std::greater<uint32_t>());
+        }
+    }
+
+    bool find(const T *entity, uint32_t& index) const {
+        for (size_t i = 0; i < chunks.size(); i++) {
+            const T *first = chunks[i]->entities;
+            if (entity >= first && entity < first + ChunkSize) {
+                index = static_cast<uint32_t>(i * ChunkSize + (entity - first));
+                return true;
+            }
+        }
+
+        return false;
+    }
+};
+
+#endif // ENTITYPOOL_HPP
@@ -0,0 +1,36 @@
+#ifndef INFLATER_HPP
+#define INFLATER_HPP
+
+#include "Exception.hpp"
+
+#include "zlib.h"
+
+#include <string>
+
+class InflaterException : public Exception {
+public:
+    InflaterException(const char *msg) : Exception(msg) { }
+    InflaterException(const std::string& msg) : Exception(msg) { }
+};
+
+/* raw inflate of small buffers against a preset dictionary, */
+/* the counterpart of Deflater. the stream is reused.         */
+class Inflater {
+private:
+    Inflater(const Inflater&);
+    Inflater& operator=(const Inflater&);
+
+public:
+    Inflater(const void *dictionary, size_t dictionary_len) throw (InflaterException);
+    virtual ~Inflater();
+
+    /* false, if the data is malformed or does not fit into out */
+    bool inflate(const void *in, size_t len, void *out, size_t max_len, size_t& out_len);
+
+private:
+    z_stream z;
+    const Bytef *dictionary;
+    uInt dictionary_len;
+};
+
+#endif // INFLATER_HPP
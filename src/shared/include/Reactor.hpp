@@ -0,0 +1,49 @@
+#ifndef REACTOR_HPP
+#define REACTOR_HPP
+
+#include "Exception.hpp"
+#include "UDPSocket.hpp"
+#include "Timing.hpp"
+
+#include <vector>
+
+class ReactorException : public Exception {
+public:
+    ReactorException(const char *msg) : Exception(msg) { }
+    ReactorException(std::string msg) : Exception(msg) { }
+};
+
+/* puts a thread to sleep until one of its sockets gets readable, */
+/* a timeout expires or another thread calls wake(). linux uses   */
+/* epoll with a timerfd and an eventfd, elsewhere select() does   */
+/* the job, but can't be woken up before the timeout.             */
+class Reactor {
+private:
+    Reactor(const Reactor&);
+    Reactor& operator=(const Reactor&);
+
+public:
+    Reactor() throw (ReactorException);
+    virtual ~Reactor();
+
+    void add(UDPSocket& socket) throw (ReactorException);
+    void remove(UDPSocket& socket);
+
+    /* returns false, if the timeout expired */
+    bool wait(ns_t timeout) throw (ReactorException);
+    void wake();
+
+private:
+    typedef std::vector<UDPSocket *> Sockets;
+
+    Sockets sockets;
+#if defined(__linux__)
+    int epfd;
+    int tfd;
+    int efd;
+#endif
+
+    bool pending() const;
+};
+
+#endif // REACTOR_HPP
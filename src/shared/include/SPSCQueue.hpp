@@ -0,0 +1,79 @@
+#ifndef SPSCQUEUE_HPP
+#define SPSCQUEUE_HPP
+
+#include <vector>
+#include <cstddef>
+
+#ifdef _WIN32
+#include "Win.hpp"
+#define spsc_barrier() MemoryBarrier()
+#else
+#define spsc_barrier() __sync_synchronize()
+#endif
+
+/* lock-free ring for exactly one producer and one consumer thread. */
+/* the producer fills back() and publishes it with push(), the      */
+/* consumer reads front() and hands the slot back with pop().       */
+template <class T> class SPSCQueue {
+private:
+    SPSCQueue(const SPSCQueue&);
+    SPSCQueue& operator=(const SPSCQueue&);
+
+public:
+    SPSCQueue(size_t capacity) : ring(round_up(capacity)), mask(ring.size() - 1), head(0), tail(0) { }
+    virtual ~SPSCQueue() { }
+
+    /* producer */
+    T *back() {
+        if (tail - head > mask) {
+            return 0;
+        }
+        spsc_barrier();
+
+        return &ring[tail & mask];
+    }
+
+    void push() {
+        spsc_barrier();
+        tail = tail + 1;
+    }
+
+    /* consumer */
+    T *front() {
+        if (head == tail) {
+            return 0;
+        }
+        spsc_barrier();
+
+        return &ring[head & mask];
+    }
+
+    void pop() {
+        spsc_barrier();
+        head = head + 1;
+    }
+
+private:
+    typedef std::vector<T> Ring;
+
+    Ring ring;
+    size_t mask;
+
+    /* keep both ends on their own cache lines */
+    char pad0[64];
+    volatile size_t head;
+    char pad1[64];
+    volatile size_t tail;
+    char pad2[64];
+
+    static size_t round_up(size_t capacity) {
+        size_t sz = 1;
+        while (sz < capacity) {
+            sz <<= 1;
+        }
+
+        return sz;
+    }
+};
+
+#endif // SPSCQUEUE_HPP
@@ -0,0 +1,73 @@
+#ifndef TICKSCHEDULER_HPP
+#define TICKSCHEDULER_HPP
+
+#include "Timing.hpp"
+
+#include <string>
+
+/* bucket i counts ticks below 250us << i, the last one the rest */
+const int TickHistogramBuckets = 8;
+const ns_t TickHistogramBase = 250000;
+
+struct TickStatistics {
+    TickStatistics();
+
+    void clear();
+    std::string to_string() const;
+
+    uint32_t ticks;         /* simulated ticks */
+    uint32_t overruns;      /* ticks costing more than their period */
+    uint32_t late;          /* ticks started more than a period too late */
+    uint32_t dropped;       /* ticks given up by the catch-up limit */
+    ns_t max_cost;
+    int64_t total_cost;
+    uint32_t cost[TickHistogramBuckets];        /* time spent in a tick */
+    uint32_t lateness[TickHistogramBuckets];    /* start behind schedule */
+};
+
+/* runs fixed timesteps against the wall clock. the deadlines are */
+/* derived from the start time and the tick count, so they never  */
+/* drift. if the caller falls behind, it catches up with at most  */
+/* max_catch_up ticks in a row, older ones are dropped. each tick */
+/* reads the clock when it starts, so catching up ticks see the   */
+/* time spent in the previous ones.                               */
+/*                                                                */
+/*  while (scheduler.next_tick()) {                               */
+/*      simulate(scheduler.get_tick_ns());                        */
+/*      scheduler.tick_done();                                    */
+/*  }                                                             */
+class TickScheduler {
+public:
+    TickScheduler(int ticks_per_second, int max_catch_up);
+    virtual ~TickScheduler();
+
+    void reset();
+    void reset(const gametime_t& now);
+
+    bool next_tick();
+    void tick_done();
+    ns_t get_tick_ns() const;
+    const gametime_t& get_tick_start() const;
+    int64_t get_tick_no() const;
+    ns_t until_next_tick(const gametime_t& now) const;
+    double get_tick_fraction(const gametime_t& now) const;
+
+    const TickStatistics& get_statistics() const;
+    void clear_statistics();
+
+private:
+    int ticks_per_second;
+    int max_catch_up;
+    ns_t tick_ns;
+    gametime_t origin;
+    int64_t tick_no;
+    int catch_up;
+    gametime_t tick_start;
+    TickStatistics stats;
+
+    int64_t deadline() const;
+    static int64_t elapsed(const gametime_t& from, const gametime_t& to);
+    static void record(uint32_t *histogram, ns_t ns);
+};
+
+#endif // TICKSCHEDULER_HPP
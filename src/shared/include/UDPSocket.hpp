@@ -3,6 +3,8 @@
 
 #include "Exception.hpp"
 
+#include <vector>
+
 #ifdef __unix__
 #include <arpa/inet.h>
 #define closesocket(s) ::close(s)
@@ -16,7 +18,12 @@ public:
     UDPSocketException(std::string msg) : Exception(msg) { }
 };
 
+const size_t UDPDatagramMaxSize = 1024;
+const size_t UDPMaxBatchSize = 64;
+
 class UDPSocket {
+    friend class Reactor;
+
 private:
     UDPSocket(const UDPSocket&);
     UDPSocket& operator=(const UDPSocket&);
@@ -24,11 +31,25 @@ private:
 public:
     UDPSocket() throw (UDPSocketException);
     UDPSocket(unsigned short port) throw (UDPSocketException);
+    UDPSocket(unsigned short port, bool reuse_port) throw (UDPSocketException);
     virtual ~UDPSocket();
 
     ssize_t send(uint32_t host, uint16_t port, void *buffer, size_t length) throw (UDPSocketException);
     ssize_t recv(char *buffer, size_t length, uint32_t *host, uint16_t *port) throw (UDPSocketException);
 
+    /* batched mode: recv() drains up to count datagrams per syscall, */
+    /* send() queues until flush() or until the queue is full         */
+    void set_batch_size(size_t count) throw (UDPSocketException);
+    void flush() throw (UDPSocketException);
+
+    /* blocks until a datagram is ready or the timeout elapsed */
+    bool wait(int timeout_ms) throw (UDPSocketException);
+
+    /* sockets sharing a port via SO_REUSEPORT: route all incoming */
+    /* datagrams to the count sockets bound after the first skip   */
+    /* ones, chosen by flow hash. returns false if unsupported.    */
+    bool steer_reuse_port_group(unsigned int skip, unsigned int count);
+
 protected:
 #ifdef __unix__
     int socket;
@@ -38,7 +59,27 @@ protected:
     unsigned short port;
     struct sockaddr_in addr;
 
-    void create_socket(unsigned short port) throw (UDPSocketException);
+    void create_socket(unsigned short port, bool reuse_port) throw (UDPSocketException);
+
+private:
+    struct Datagram {
+        struct sockaddr_in addr;
+        size_t len;
+        char data[UDPDatagramMaxSize];
+    };
+
+    typedef std::vector<Datagram> Datagrams;
+
+    size_t batch_size;
+    Datagrams in_batch;
+    size_t in_count;
+    size_t in_pos;
+    Datagrams out_batch;
+    size_t out_count;
+
+    ssize_t send_now(const struct sockaddr_in *to, const void *buffer, size_t length) throw (UDPSocketException);
+    ssize_t recv_now(char *buffer, size_t length, struct sockaddr_in *from) throw (UDPSocketException);
+    void fill_batch() throw (UDPSocketException);
 };
 
 #endif // UDPSOCKET_HPP
@@ -67,6 +67,8 @@ Configuration::Configuration(const std::string& directory,
     cdef("deadzone_horizontal", "3200");
     cdef("deadzone_vertical", "3200");
 
+    cdef("interpolation_delay", "150");
+
     /* extract -> ready for quick access */
     extract();
 }
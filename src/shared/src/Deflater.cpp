@@ -0,0 +1,194 @@
+#include "Deflater.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+static const int HashBits = 12;
+static const int HashSize = 1 << HashBits;
+static const int MinMatch = 3;
+static const int MaxMatch = 258;
+static const int MaxDistance = 32768;
+static const int MaxChain = 32;
+
+/* rfc 1951, 3.2.5 */
+static const int LengthBase[] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const int LengthExtra[] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const int LengthCodes = sizeof(LengthBase) / sizeof(int);
+
+static const int DistanceBase[] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const int DistanceExtra[] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+static const int DistanceCodes = sizeof(DistanceBase) / sizeof(int);
+
+static inline int hash3(const unsigned char *p) {
+    unsigned int v = (p[0] << 16) | (p[1] << 8) | p[2];
+
+    return static_cast<int>((v * 2654435761U) >> (32 - HashBits));
+}
+
+Deflater::Deflater(const void *dictionary, size_t dictionary_len)
+    : head(HashSize), dictionary_len(dictionary_len), out(0), out_len(0), out_max(0),
+      bit_buffer(0), bit_count(0), overflow(false)
+{
+    if (dictionary_len > static_cast<size_t>(MaxDistance)) {
+        dictionary = static_cast<const unsigned char *>(dictionary) + dictionary_len - MaxDistance;
+        this->dictionary_len = dictionary_len = MaxDistance;
+    }
+    window.resize(dictionary_len);
+    if (dictionary_len) {
+        memcpy(&window[0], dictionary, dictionary_len);
+    }
+}
+
+Deflater::~Deflater() { }
+
+size_t Deflater::deflate(const void *in, size_t len, void *out, size_t max_len) {
+    size_t total = dictionary_len + len;
+    window.resize(total);
+    prev.resize(total);
+    if (len) {
+        memcpy(&window[dictionary_len], in, len);
+    }
+
+    this->out = static_cast<unsigned char *>(out);
+    out_len = 0;
+    out_max = max_len;
+    bit_buffer = 0;
+    bit_count = 0;
+    overflow = false;
+
+    /* the dictionary is history, feed it into the hash chains */
+    std::fill(head.begin(), head.end(), -1);
+    int end = static_cast<int>(total);
+    int pos = 0;
+    for (; pos < static_cast<int>(dictionary_len); pos++) {
+        insert(pos);
+    }
+
+    /* single final block, fixed codes */
+    put_bits(1, 1);
+    put_bits(1, 2);
+
+    while (pos < end && !overflow) {
+        int best_len = 0;
+        int best_dist = 0;
+        if (pos + MinMatch <= end) {
+            int max_len = end - pos;
+            if (max_len > MaxMatch) {
+                max_len = MaxMatch;
+            }
+            const unsigned char *cur = &window[pos];
+            int chain = MaxChain;
+            for (int cand = head[hash3(cur)]; cand >= 0 && chain--; cand = prev[cand]) {
+                if (pos - cand > MaxDistance) {
+                    break;
+                }
+                const unsigned char *p = &window[cand];
+                if (p[best_len] != cur[best_len]) {
+                    continue;
+                }
+                int l = 0;
+                while (l < max_len && p[l] == cur[l]) {
+                    l++;
+                }
+                if (l > best_len) {
+                    best_len = l;
+                    best_dist = pos - cand;
+                    if (l == max_len) {
+                        break;
+                    }
+                }
+            }
+        }
+
+        if (best_len >= MinMatch) {
+            put_match(best_len, best_dist);
+            for (int i = 0; i < best_len; i++) {
+                insert(pos++);
+            }
+        } else {
+            put_literal(window[pos]);
+            insert(pos++);
+        }
+    }
+
+    /* end of block, pad to a full byte */
+    put_code(0, 7);
+    if (bit_count) {
+        put_bits(0, 8 - bit_count);
+    }
+    window.resize(dictionary_len);
+
+    return (overflow ? 0 : out_len);
+}
+
+void Deflater::insert(int pos) {
+    if (pos + MinMatch <= static_cast<int>(window.size())) {
+        int h = hash3(&window[pos]);
+        prev[pos] = head[h];
+        head[h] = pos;
+    }
+}
+
+void Deflater::put_bits(unsigned int value, int bits) {
+    bit_buffer |= value << bit_count;
+    bit_count += bits;
+    while (bit_count >= 8) {
+        if (out_len < out_max) {
+            out[out_len++] = static_cast<unsigned char>(bit_buffer);
+        } else {
+            overflow = true;
+        }
+        bit_buffer >>= 8;
+        bit_count -= 8;
+    }
+}
+
+void Deflater::put_code(unsigned int code, int bits) {
+    /* huffman codes are packed starting with their most significant bit */
+    unsigned int reversed = 0;
+    for (int i = 0; i < bits; i++) {
+        reversed = (reversed << 1) | ((code >> i) & 1);
+    }
+    put_bits(reversed, bits);
+}
+
+void Deflater::put_literal(unsigned char c) {
+    if (c < 144) {
+        put_code(0x30 + c, 8);
+    } else {
+        put_code(0x190 + c - 144, 9);
+    }
+}
+
+void Deflater::put_match(int len, int dist) {
+    int lc = LengthCodes - 1;
+    while (LengthBase[lc] > len) {
+        lc--;
+    }
+    int sym = 257 + lc;
+    if (sym < 280) {
+        put_code(sym - 256, 7);
+    } else {
+        put_code(0xc0 + sym - 280, 8);
+    }
+    put_bits(len - LengthBase[lc], LengthExtra[lc]);
+
+    int dc = DistanceCodes - 1;
+    while (DistanceBase[dc] > dist) {
+        dc--;
+    }
+    put_code(dc, 5);
+    put_bits(dist - DistanceBase[dc], DistanceExtra[dc]);
+}
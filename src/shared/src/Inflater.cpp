@@ -0,0 +1,38 @@
+#include "Inflater.hpp"
+
+#include <cstring>
+
+Inflater::Inflater(const void *dictionary, size_t dictionary_len) throw (InflaterException)
+    : dictionary(static_cast<const Bytef *>(dictionary)),
+      dictionary_len(static_cast<uInt>(dictionary_len))
+{
+    memset(&z, 0, sizeof(z_stream));
+    if (inflateInit2(&z, -MAX_WBITS) != Z_OK) {
+        throw InflaterException("Cannot initialize inflater");
+    }
+}
+
+Inflater::~Inflater() {
+    inflateEnd(&z);
+}
+
+bool Inflater::inflate(const void *in, size_t len, void *out, size_t max_len, size_t& out_len) {
+    out_len = 0;
+    if (inflateReset(&z) != Z_OK) {
+        return false;
+    }
+    if (dictionary_len && inflateSetDictionary(&z, dictionary, dictionary_len) != Z_OK) {
+        return false;
+    }
+
+    z.next_in = const_cast<Bytef *>(static_cast<const Bytef *>(in));
+    z.avail_in = static_cast<uInt>(len);
+    z.next_out = static_cast<Bytef *>(out);
+    z.avail_out = static_cast<uInt>(max_len);
+    if (::inflate(&z, Z_FINISH) != Z_STREAM_END || z.avail_in) {
+        return false;
+    }
+    out_len = max_len - z.avail_out;
+
+    return true;
+}
@@ -0,0 +1,175 @@
+#include "Reactor.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#ifdef __unix__
+#include <unistd.h>
+#include <sys/select.h>
+#endif
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+#endif
+
+static const int MaxEvents = 16;
+
+Reactor::Reactor() throw (ReactorException) {
+#if defined(__linux__)
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epfd < 0 || tfd < 0 || efd < 0) {
+        std::string err(strerror(errno));
+        if (epfd >= 0) close(epfd);
+        if (tfd >= 0) close(tfd);
+        if (efd >= 0) close(efd);
+        throw ReactorException("Creating reactor failed: " + err);
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = tfd;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, tfd, &ev);
+    ev.data.fd = efd;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, efd, &ev);
+#endif
+}
+
+Reactor::~Reactor() {
+#if defined(__linux__)
+    close(efd);
+    close(tfd);
+    close(epfd);
+#endif
+}
+
+void Reactor::add(UDPSocket& socket) throw (ReactorException) {
+#if defined(__linux__)
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = socket.socket;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, socket.socket, &ev) < 0) {
+        throw ReactorException("Watching socket failed: " + std::string(strerror(errno)));
+    }
+#endif
+    sockets.push_back(&socket);
+}
+
+void Reactor::remove(UDPSocket& socket) {
+    Sockets::iterator it = std::find(sockets.begin(), sockets.end(), &socket);
+    if (it != sockets.end()) {
+#if defined(__linux__)
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        epoll_ctl(epfd, EPOLL_CTL_DEL, socket.socket, &ev);
+#endif
+        sockets.erase(it);
+    }
+}
+
+bool Reactor::wait(ns_t timeout) throw (ReactorException) {
+    /* batched sockets might hold datagrams already fetched from the kernel */
+    if (pending()) {
+        return true;
+    }
+    if (timeout < 0) {
+        timeout = 0;
+    }
+
+#if defined(__linux__)
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its));
+    its.it_value.tv_sec = timeout / 1000000000;
+    its.it_value.tv_nsec = timeout % 1000000000;
+    if (!timeout) {
+        its.it_value.tv_nsec = 1;   /* zero would disarm */
+    }
+    if (timerfd_settime(tfd, 0, &its, 0) < 0) {
+        throw ReactorException("Arming timer failed: " + std::string(strerror(errno)));
+    }
+
+    struct epoll_event events[MaxEvents];
+    int n = epoll_wait(epfd, events, MaxEvents, -1);
+    if (n < 0) {
+        if (errno == EINTR) {
+            return true;
+        }
+        throw ReactorException("Waiting for events failed: " + std::string(strerror(errno)));
+    }
+
+    bool activity = false;
+    for (int i = 0; i < n; i++) {
+        uint64_t value;
+        int fd = events[i].data.fd;
+        if (fd == tfd) {
+            if (read(tfd, &value, sizeof(value)) < 0) {
+                /* chuck it */
+            }
+        } else if (fd == efd) {
+            if (read(efd, &value, sizeof(value)) < 0) {
+                /* chuck it */
+            }
+            activity = true;
+        } else {
+            activity = true;
+        }
+    }
+
+    return activity;
+#else
+    fd_set rfds;
+    FD_ZERO(&rfds);
+    int maxfd = 0;
+    for (Sockets::iterator it = sockets.begin(); it != sockets.end(); it++) {
+        FD_SET((*it)->socket, &rfds);
+        if (static_cast<int>((*it)->socket) > maxfd) {
+            maxfd = static_cast<int>((*it)->socket);
+        }
+    }
+
+    struct timeval tv;
+    tv.tv_sec = timeout / 1000000000;
+    tv.tv_usec = (timeout % 1000000000) / 1000;
+
+    int rv;
+    if (sockets.size()) {
+        rv = select(maxfd + 1, &rfds, 0, 0, &tv);
+    } else {
+        wait_ns(timeout);
+        rv = 0;
+    }
+    if (rv < 0) {
+#ifdef __unix__
+        if (errno == EINTR) {
+            return true;
+        }
+#endif
+        throw ReactorException("Waiting for events failed: " + std::string(strerror(errno)));
+    }
+
+    return (rv > 0);
+#endif
+}
+
+void Reactor::wake() {
+#if defined(__linux__)
+    uint64_t value = 1;
+    if (write(efd, &value, sizeof(value)) < 0) {
+        /* counter overflow, it is awake anyway */
+    }
+#endif
+}
+
+bool Reactor::pending() const {
+    for (Sockets::const_iterator it = sockets.begin(); it != sockets.end(); it++) {
+        if ((*it)->in_pos < (*it)->in_count) {
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,169 @@
+#include "TickScheduler.hpp"
+
+#include <cstring>
+#include <cstdio>
+
+TickStatistics::TickStatistics() {
+    clear();
+}
+
+void TickStatistics::clear() {
+    ticks = 0;
+    overruns = 0;
+    late = 0;
+    dropped = 0;
+    max_cost = 0;
+    total_cost = 0;
+    memset(cost, 0, sizeof(cost));
+    memset(lateness, 0, sizeof(lateness));
+}
+
+std::string TickStatistics::to_string() const {
+    char buffer[128];
+    double avg = (ticks ? static_cast<double>(total_cost) / ticks / 1000.0 : 0.0);
+    sprintf(buffer, "ticks %u, overruns %u, late %u, dropped %u, avg %.0fus, max %ldus",
+        ticks, overruns, late, dropped, avg, static_cast<long>(max_cost / 1000));
+    std::string s(buffer);
+
+    s += ", cost";
+    for (int i = 0; i < TickHistogramBuckets; i++) {
+        sprintf(buffer, " %u", cost[i]);
+        s += buffer;
+    }
+    s += ", lateness";
+    for (int i = 0; i < TickHistogramBuckets; i++) {
+        sprintf(buffer, " %u", lateness[i]);
+        s += buffer;
+    }
+
+    return s;
+}
+
+TickScheduler::TickScheduler(int ticks_per_second, int max_catch_up)
+    : ticks_per_second(ticks_per_second > 0 ? ticks_per_second : 1),
+      max_catch_up(max_catch_up > 0 ? max_catch_up : 1),
+      tick_ns(1000000000 / this->ticks_per_second), tick_no(0), catch_up(0)
+{
+    reset();
+}
+
+TickScheduler::~TickScheduler() { }
+
+void TickScheduler::reset() {
+    gametime_t now;
+
+    get_now(now);
+    reset(now);
+}
+
+void TickScheduler::reset(const gametime_t& now) {
+    origin = now;
+    tick_start = now;
+    tick_no = 0;
+    catch_up = 0;
+}
+
+bool TickScheduler::next_tick() {
+    gametime_t now;
+
+    get_now(now);
+    int64_t behind = elapsed(origin, now) - deadline();
+    if (behind < 0) {
+        catch_up = 0;
+        return false;
+    }
+
+    /* too far behind or caught up long enough? skip to the present */
+    if (catch_up >= max_catch_up || behind >= static_cast<int64_t>(tick_ns) * max_catch_up) {
+        int64_t skip = behind / tick_ns;
+        if (skip) {
+            stats.dropped += static_cast<uint32_t>(skip);
+            tick_no += skip;
+            behind -= skip * tick_ns;
+        }
+        catch_up = 0;
+    }
+
+    if (behind >= tick_ns) {
+        stats.late++;
+    }
+    record(stats.lateness, static_cast<ns_t>(behind));
+
+    tick_no++;
+    catch_up++;
+    tick_start = now;
+
+    return true;
+}
+
+void TickScheduler::tick_done() {
+    gametime_t now;
+
+    get_now(now);
+    ns_t cost = static_cast<ns_t>(elapsed(tick_start, now));
+    stats.ticks++;
+    stats.total_cost += cost;
+    if (cost > stats.max_cost) {
+        stats.max_cost = cost;
+    }
+    if (cost > tick_ns) {
+        stats.overruns++;
+    }
+    record(stats.cost, cost);
+}
+
+ns_t TickScheduler::get_tick_ns() const {
+    return tick_ns;
+}
+
+const gametime_t& TickScheduler::get_tick_start() const {
+    return tick_start;
+}
+
+ns_t TickScheduler::until_next_tick(const gametime_t& now) const {
+    int64_t ns = deadline() - elapsed(origin, now);
+    if (ns < 0) {
+        return 0;
+    }
+    if (ns > tick_ns) {
+        return tick_ns;
+    }
+
+    return static_cast<ns_t>(ns);
+}
+
+/* how far the time has passed the last tick, 0..1 */
+double TickScheduler::get_tick_fraction(const gametime_t& now) const {
+    return 1.0f - static_cast<double>(until_next_tick(now)) / tick_ns;
+}
+
+int64_t TickScheduler::get_tick_no() const {
+    return tick_no;
+}
+
+const TickStatistics& TickScheduler::get_statistics() const {
+    return stats;
+}
+
+void TickScheduler::clear_statistics() {
+    stats.clear();
+}
+
+int64_t TickScheduler::deadline() const {
+    /* exact, no rounding error accumulates for odd rates */
+    return tick_no * 1000000000 / ticks_per_second;
+}
+
+int64_t TickScheduler::elapsed(const gametime_t& from, const gametime_t& to) {
+    return static_cast<int64_t>(to.tv_sec - from.tv_sec) * 1000000000 + (to.tv_nsec - from.tv_nsec);
+}
+
+void TickScheduler::record(uint32_t *histogram, ns_t ns) {
+    int i = 0;
+    ns_t limit = TickHistogramBase;
+    while (i < TickHistogramBuckets - 1 && ns >= limit) {
+        limit <<= 1;
+        i++;
+    }
+    histogram[i]++;
+}
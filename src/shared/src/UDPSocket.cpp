@@ -5,18 +5,37 @@
 #ifdef __unix__
 #include <unistd.h>
 #include <sys/socket.h>
+#include <sys/select.h>
 #include <fcntl.h>
 #endif
+#if defined(__linux__)
+#include <linux/filter.h>
+#endif
+
+UDPSocket::UDPSocket() throw (UDPSocketException)
+    : port(0), batch_size(0), in_count(0), in_pos(0), out_count(0)
+{
+    create_socket(0, false);
+}
 
-UDPSocket::UDPSocket() throw (UDPSocketException) : port(0) {
-    create_socket(0);
+UDPSocket::UDPSocket(unsigned short port) throw (UDPSocketException)
+    : port(port), batch_size(0), in_count(0), in_pos(0), out_count(0)
+{
+    create_socket(port, false);
 }
 
-UDPSocket::UDPSocket(unsigned short port) throw (UDPSocketException) : port(port) {
-    create_socket(port);
+UDPSocket::UDPSocket(unsigned short port, bool reuse_port) throw (UDPSocketException)
+    : port(port), batch_size(0), in_count(0), in_pos(0), out_count(0)
+{
+    create_socket(port, reuse_port);
 }
 
 UDPSocket::~UDPSocket() {
+    try {
+        flush();
+    } catch (const UDPSocketException&) {
+        /* chuck it */
+    }
     closesocket(socket);
 }
 
@@ -24,7 +43,165 @@ ssize_t UDPSocket::send(uint32_t host, uint16_t port, void *buffer, size_t lengt
     addr.sin_addr.s_addr = htonl(host);
     addr.sin_port = htons(port);
 
-    ssize_t sz = sendto(socket, static_cast<const char *>(buffer), length, 0, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr));
+    /* datagrams too large for a batch slot go out whole, in order */
+    if (batch_size && length > UDPDatagramMaxSize) {
+        flush();
+    } else if (batch_size) {
+        if (out_count >= batch_size) {
+            flush();
+        }
+        Datagram& dgram = out_batch[out_count++];
+        dgram.addr = addr;
+        dgram.len = length;
+        memcpy(dgram.data, buffer, length);
+
+        return static_cast<ssize_t>(length);
+    }
+
+    return send_now(&addr, buffer, length);
+}
+
+ssize_t UDPSocket::recv(char *buffer, size_t length, uint32_t *host, uint16_t *port) throw (UDPSocketException) {
+    struct sockaddr_in ao;
+    ssize_t sz;
+
+    if (batch_size) {
+        if (in_pos >= in_count) {
+            fill_batch();
+        }
+        if (in_pos >= in_count) {
+            return 0;
+        }
+        const Datagram& dgram = in_batch[in_pos++];
+        sz = static_cast<ssize_t>(dgram.len < length ? dgram.len : length);
+        memcpy(buffer, dgram.data, sz);
+        ao = dgram.addr;
+    } else {
+        sz = recv_now(buffer, length, &ao);
+        if (!sz) {
+            return 0;
+        }
+    }
+
+    if (host) *host = ntohl(ao.sin_addr.s_addr);
+    if (port) *port = ntohs(ao.sin_port);
+
+    return sz;
+}
+
+void UDPSocket::set_batch_size(size_t count) throw (UDPSocketException) {
+    flush();
+
+    if (count > UDPMaxBatchSize) {
+        count = UDPMaxBatchSize;
+    }
+    batch_size = (count > 1 ? count : 0);
+    in_batch.resize(batch_size);
+    out_batch.resize(batch_size);
+    in_count = in_pos = 0;
+}
+
+void UDPSocket::flush() throw (UDPSocketException) {
+    if (!out_count) {
+        return;
+    }
+
+    size_t count = out_count;
+    out_count = 0;
+
+#if defined(__linux__)
+    struct mmsghdr hdrs[UDPMaxBatchSize];
+    struct iovec iovs[UDPMaxBatchSize];
+    memset(hdrs, 0, sizeof(struct mmsghdr) * count);
+    for (size_t i = 0; i < count; i++) {
+        Datagram& dgram = out_batch[i];
+        iovs[i].iov_base = dgram.data;
+        iovs[i].iov_len = dgram.len;
+        hdrs[i].msg_hdr.msg_name = &dgram.addr;
+        hdrs[i].msg_hdr.msg_namelen = sizeof(dgram.addr);
+        hdrs[i].msg_hdr.msg_iov = &iovs[i];
+        hdrs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    size_t sent = 0;
+    while (sent < count) {
+        int rv = sendmmsg(socket, hdrs + sent, static_cast<unsigned int>(count - sent), 0);
+        if (rv < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) {
+                /* send buffer exhausted, drop the rest like the wire would */
+                break;
+            }
+            throw UDPSocketException("Error sending packet: " + std::string(strerror(errno)));
+        }
+        sent += rv;
+    }
+#else
+    for (size_t i = 0; i < count; i++) {
+        Datagram& dgram = out_batch[i];
+        send_now(&dgram.addr, dgram.data, dgram.len);
+    }
+#endif
+}
+
+bool UDPSocket::wait(int timeout_ms) throw (UDPSocketException) {
+    if (in_pos < in_count) {
+        return true;
+    }
+
+    fd_set rfds;
+    FD_ZERO(&rfds);
+    FD_SET(socket, &rfds);
+
+    struct timeval tv;
+    tv.tv_sec = timeout_ms / 1000;
+    tv.tv_usec = (timeout_ms % 1000) * 1000;
+
+    int rv = select(static_cast<int>(socket) + 1, &rfds, 0, 0, &tv);
+    if (rv < 0) {
+#ifdef __unix__
+        if (errno == EINTR) {
+            return false;
+        }
+#endif
+        throw UDPSocketException("Waiting for packets failed: " + std::string(strerror(errno)));
+    }
+
+    return (rv > 0);
+}
+
+bool UDPSocket::steer_reuse_port_group(unsigned int skip, unsigned int count) {
+#if defined(__linux__) && defined(SO_ATTACH_REUSEPORT_CBPF)
+    if (!count) {
+        return false;
+    }
+
+    /* index = skip + hash(source address, source port) % count. */
+    /* not the rxhash, that is 0 where the nic does not set one, */
+    /* like on loopback or virtio, and would pin every client.   */
+    struct sock_filter code[] = {
+        { BPF_LDX | BPF_B | BPF_MSH, 0, 0, static_cast<uint32_t>(SKF_NET_OFF) },
+        { BPF_LD | BPF_H | BPF_IND, 0, 0, static_cast<uint32_t>(SKF_NET_OFF) },
+        { BPF_MISC | BPF_TAX, 0, 0, 0 },
+        { BPF_LD | BPF_W | BPF_ABS, 0, 0, static_cast<uint32_t>(SKF_NET_OFF + 12) },
+        { BPF_ALU | BPF_XOR | BPF_X, 0, 0, 0 },
+        { BPF_ALU | BPF_MUL | BPF_K, 0, 0, 2654435761U },
+        { BPF_ALU | BPF_RSH | BPF_K, 0, 0, 16 },
+        { BPF_ALU | BPF_MOD | BPF_K, 0, 0, count },
+        { BPF_ALU | BPF_ADD | BPF_K, 0, 0, skip },
+        { BPF_RET | BPF_A, 0, 0, 0 }
+    };
+    struct sock_fprog prog;
+    prog.len = sizeof(code) / sizeof(code[0]);
+    prog.filter = code;
+
+    return (setsockopt(socket, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)) == 0);
+#else
+    return false;
+#endif
+}
+
+ssize_t UDPSocket::send_now(const struct sockaddr_in *to, const void *buffer, size_t length) throw (UDPSocketException) {
+    ssize_t sz = sendto(socket, static_cast<const char *>(buffer), length, 0, reinterpret_cast<const struct sockaddr *>(to), sizeof(*to));
 #ifdef __unix__
     if (sz < 0) {
         throw UDPSocketException("Error sending packet: " + std::string(strerror(errno)));
@@ -38,11 +215,10 @@ ssize_t UDPSocket::send(uint32_t host, uint16_t port, void *buffer, size_t lengt
     return sz;
 }
 
-ssize_t UDPSocket::recv(char *buffer, size_t length, uint32_t *host, uint16_t *port) throw (UDPSocketException) {
-    struct sockaddr_in ao;
-    socklen_t ao_len = sizeof(ao);
+ssize_t UDPSocket::recv_now(char *buffer, size_t length, struct sockaddr_in *from) throw (UDPSocketException) {
+    socklen_t ao_len = sizeof(*from);
 
-    ssize_t sz = recvfrom(socket, buffer, length, 0, reinterpret_cast<struct sockaddr *>(&ao), &ao_len);
+    ssize_t sz = recvfrom(socket, buffer, length, 0, reinterpret_cast<struct sockaddr *>(from), &ao_len);
 #ifdef __unix__
     if (sz < 0) {
         if (errno != EAGAIN) {
@@ -56,13 +232,51 @@ ssize_t UDPSocket::recv(char *buffer, size_t length, uint32_t *host, uint16_t *p
     }
 #endif
 
-    if (host) *host = ntohl(ao.sin_addr.s_addr);
-    if (port) *port = ntohs(ao.sin_port);
-
     return sz;
 }
 
-void UDPSocket::create_socket(unsigned short port) throw (UDPSocketException) {
+void UDPSocket::fill_batch() throw (UDPSocketException) {
+    in_count = in_pos = 0;
+
+#if defined(__linux__)
+    struct mmsghdr hdrs[UDPMaxBatchSize];
+    struct iovec iovs[UDPMaxBatchSize];
+    memset(hdrs, 0, sizeof(struct mmsghdr) * batch_size);
+    for (size_t i = 0; i < batch_size; i++) {
+        Datagram& dgram = in_batch[i];
+        iovs[i].iov_base = dgram.data;
+        iovs[i].iov_len = UDPDatagramMaxSize;
+        hdrs[i].msg_hdr.msg_name = &dgram.addr;
+        hdrs[i].msg_hdr.msg_namelen = sizeof(dgram.addr);
+        hdrs[i].msg_hdr.msg_iov = &iovs[i];
+        hdrs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    int rv = recvmmsg(socket, hdrs, static_cast<unsigned int>(batch_size), 0, 0);
+    if (rv < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            throw UDPSocketException("Error receiving packet: " + std::string(strerror(errno)));
+        }
+        return;
+    }
+    for (int i = 0; i < rv; i++) {
+        in_batch[i].len = hdrs[i].msg_len;
+    }
+    in_count = static_cast<size_t>(rv);
+#else
+    while (in_count < batch_size) {
+        Datagram& dgram = in_batch[in_count];
+        ssize_t sz = recv_now(dgram.data, UDPDatagramMaxSize, &dgram.addr);
+        if (sz <= 0) {
+            break;
+        }
+        dgram.len = static_cast<size_t>(sz);
+        in_count++;
+    }
+#endif
+}
+
+void UDPSocket::create_socket(unsigned short port, bool reuse_port) throw (UDPSocketException) {
     socket = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
     if (socket < 0) {
         throw UDPSocketException("Creating socket failed: " + std::string(strerror(errno)));
@@ -87,6 +301,19 @@ void UDPSocket::create_socket(unsigned short port) throw (UDPSocketException) {
         throw UDPSocketException("Could not set to broadcast: " + std::string(strerror(errno)));
     }
 
+    if (reuse_port) {
+#ifdef SO_REUSEPORT
+        int ru = 1;
+        if (setsockopt(socket, SOL_SOCKET, SO_REUSEPORT, &ru, sizeof ru) < 0) {
+            closesocket(socket);
+            throw UDPSocketException("Could not share port: " + std::string(strerror(errno)));
+        }
+#else
+        closesocket(socket);
+        throw UDPSocketException("Sharing ports is not supported on this platform");
+#endif
+    }
+
     memset(&addr, 0, sizeof(addr));
     addr.sin_family = AF_INET;
     addr.sin_port = htons(port);